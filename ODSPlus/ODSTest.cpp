@@ -6,61 +6,1491 @@
 
 	Only include ods.h inside of your project.
 
+	Every check that fails is printed, and the program returns the number of checks that failed.
+
 */
 
 #include "ods.h";
+#ifdef __linux__
+#include <sys/resource.h>
+#include <csignal>
+#endif
 
 using namespace ODS;
 
+static int failures = 0;
+
+static void check(bool passed, const char* what, int line)
+{
+	if (passed)
+		return;
+	std::cout << "FAILED (line " << line << "): " << what << std::endl;
+	failures++;
+}
+
+#define CHECK(condition) check((condition), #condition, __LINE__)
+#define CHECK_THROWS(statement) \
+	do { \
+		bool thrown = false; \
+		try { statement; } catch (ODSException&) { thrown = true; } \
+		check(thrown, #statement " throws an ODSException", __LINE__); \
+	} while (false)
+
+static const Format formats[] = { Format::STANDARD, Format::COMPACT, Format::NAMED };
+static const CompressionType compressions[] = { CompressionType::NONE, CompressionType::GZIP, CompressionType::ZLIB, CompressionType::FAST, CompressionType::ADAPTIVE };
+
+static const std::string testFile = "ods_test.ods";
+
+// The bytes of a tag in the standard format, so two tags can be compared.
+static std::string tagBytes(ITag* tag)
+{
+	if (tag == NULL)
+		return "NULL";
+	BinaryOutputStream bos = BinaryOutputStream();
+	tag->writeData(bos);
+	return std::string(bos.getArray(), bos.length());
+}
+
+static std::vector<byte> readFile(const std::string& file)
+{
+	std::ifstream in(file, std::ios::in | std::ios::binary);
+	return std::vector<byte>((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+}
+
+static void writeFile(const std::string& file, const std::vector<byte>& data)
+{
+	std::ofstream out(file, std::ios::out | std::ios::binary | std::ios::trunc);
+	out.write(data.data(), data.size());
+}
+
+// A new ObjectDataStructure for testFile with no file or journal left from an earlier test.
+static ObjectDataStructure freshFile(CompressionType compression, Format format)
+{
+	std::remove(testFile.c_str());
+	std::remove((testFile + ".journal").c_str());
+	ObjectDataStructure ods = ObjectDataStructure(testFile, compression);
+	ods.setFormat(format);
+	return ods;
+}
+
+#ifdef __linux__
+// Limit the size of the files that are written (0 removes the limit), so writes past it fail as if the disk was full.
+static void limitFileSize(long long size)
+{
+	signal(SIGXFSZ, SIG_IGN);
+	struct rlimit limit;
+	getrlimit(RLIMIT_FSIZE, &limit);
+	limit.rlim_cur = size == 0 ? limit.rlim_max : (rlim_t)size;
+	setrlimit(RLIMIT_FSIZE, &limit);
+}
+
+// The inode of a file, which stays the same while the file is changed in place and changes when it is replaced.
+static long long fileId(const std::string& file)
+{
+	struct stat info;
+	if (stat(file.c_str(), &info) != 0)
+		return -1;
+	return (long long)info.st_ino;
+}
+#endif
+
+// Free the children of the ObjectTags (and CompressedObjectTags) in tag, since an ObjectTag does not own them.
+// (The children are removed from their parent, so a tag is only freed once.)
+static void freeChildren(ITag* tag)
+{
+	if (VectorTag* vector = dynamic_cast<VectorTag*>(tag)) {
+		for (const std::shared_ptr<ITag>& element : vector->getValue())
+			freeChildren(element.get());
+		return;
+	}
+	std::vector<ITag*> children;
+	if (ObjectTag* object = dynamic_cast<ObjectTag*>(tag)) {
+		children = object->getValue();
+		object->removeAllTags();
+	}
+	else if (CompressedObjectTag* compressed = dynamic_cast<CompressedObjectTag*>(tag)) {
+		children = compressed->getValue();
+		compressed->removeAllTags();
+	}
+	for (ITag* child : children) {
+		freeChildren(child);
+		delete child;
+	}
+}
+
+// A new tag that frees its children with it.
+template <class T>
+static std::shared_ptr<T> makeOwned(T* tag)
+{
+	return std::shared_ptr<T>(tag, [](T* owner) {
+		freeChildren(owner);
+		delete owner;
+	});
+}
+
+// A tag that was read (by get(), getMany() or Document::toTags()) that frees its children once it is no longer used.
+static std::shared_ptr<ITag> owned(std::shared_ptr<ITag> tag)
+{
+	if (tag == NULL)
+		return tag;
+	return std::shared_ptr<ITag>(tag.get(), [tag](ITag* owner) { freeChildren(owner); });
+}
+
+// One tag of every type.
+static std::vector<std::shared_ptr<ITag>> sampleTags()
+{
+	std::vector<std::shared_ptr<ITag>> tags;
+	tags.push_back(std::make_shared<ByteTag>("byte", (byte)-7));
+	tags.push_back(std::make_shared<CharTag>("char", 'c'));
+	tags.push_back(std::make_shared<DoubleTag>("double", -90.564));
+	tags.push_back(std::make_shared<FloatTag>("float", 90.888888f));
+	tags.push_back(std::make_shared<IntTag>("int", -420));
+	tags.push_back(std::make_shared<LongTag>("long", 1234567890123L));
+	tags.push_back(std::make_shared<StringTag>("string", "This is a test"));
+
+	std::shared_ptr<VectorTag> vector = std::make_shared<VectorTag>("vector", std::vector<std::shared_ptr<ITag>>());
+	vector->addTag(std::make_shared<IntTag>("", 20));
+	vector->addTag(std::make_shared<IntTag>("", 30));
+	tags.push_back(vector);
+
+	std::shared_ptr<ObjectTag> object = makeOwned(new ObjectTag("object"));
+	ObjectTag* inner = new ObjectTag("inner");
+	inner->addTag(new LongTag("tst", 2890));
+	object->addTag(inner);
+	object->addTag(new StringTag("name", "inside"));
+	tags.push_back(object);
+
+	std::shared_ptr<CompressedObjectTag> compressed = makeOwned(new CompressedObjectTag("compressed", CompressionType::ZLIB));
+	compressed->addTag(new StringTag("text", std::string(200, 'z')));
+	compressed->addTag(new IntTag("number", 99));
+	tags.push_back(compressed);
+	return tags;
+}
+
+// The keys of every tag in sampleTags(), and the tags they point to.
+static std::vector<std::pair<std::string, std::shared_ptr<ITag>>> sampleKeys(std::vector<std::shared_ptr<ITag>>& tags)
+{
+	std::vector<std::pair<std::string, std::shared_ptr<ITag>>> keys;
+	for (std::shared_ptr<ITag>& tag : tags)
+		keys.push_back({ tag->getName(), tag });
+	keys.push_back({ "object.inner.tst", std::make_shared<LongTag>("tst", 2890) });
+	keys.push_back({ "object.name", std::make_shared<StringTag>("name", "inside") });
+	keys.push_back({ "compressed.number", std::make_shared<IntTag>("number", 99) });
+	return keys;
+}
+
+// Integers are zigzag varints in the compact format, so small values (and the lengths of short tags) take fewer bytes.
+static void testCompact()
+{
+	for (long long value : { 0LL, 1LL, -1LL, 63LL, -64LL, 64LL, std::numeric_limits<long long>::min(), std::numeric_limits<long long>::max() })
+		CHECK(zigzagDecode(zigzagEncode(value)) == value);
+	CHECK(zigzagEncode(-1) == 1);
+	CHECK(zigzagEncode(63) == 126);
+	CHECK(zigzagEncode(-64) == 127);
+
+	// (The buffer is larger than any varint, so varints of up to 8 bytes are decoded from a single load.)
+	byte buffer[16] = {};
+	for (unsigned long long value : { 0ULL, 127ULL, 128ULL, 16383ULL, 16384ULL, 1ULL << 55, 1ULL << 56, ~0ULL }) {
+		int size = encodeVarint(buffer, value);
+		CHECK(size == varintSize(value));
+		unsigned long long decoded = 0;
+		CHECK(decodeVarint(buffer, sizeof(buffer), decoded) == size && decoded == value);
+		CHECK(decodeVarint(buffer, size, decoded) == size && decoded == value);
+		CHECK(decodeVarint(buffer, size - 1, decoded) == 0);
+	}
+
+	// The same tags are smaller in the compact format, which starts with its header.
+	std::vector<std::vector<byte>> files;
+	for (Format format : { Format::STANDARD, Format::COMPACT }) {
+		ObjectDataStructure ods = freshFile(CompressionType::NONE, format);
+		ods.save(sampleTags());
+		files.push_back(readFile(testFile));
+	}
+	CHECK(files[1].size() < files[0].size());
+	Format format;
+	long dictionarySize;
+	CHECK(parseFileHeader(files[0].data(), (long)files[0].size(), format, dictionarySize) == 0 && format == Format::STANDARD);
+	CHECK(parseFileHeader(files[1].data(), (long)files[1].size(), format, dictionarySize) == compactHeaderSize && format == Format::COMPACT);
+	// A header from a newer version is rejected.
+	std::vector<byte> newer = files[1];
+	newer[3]++;
+	CHECK(parseFileHeader(newer.data(), (long)newer.size(), format, dictionarySize) == -1);
+
+	// A file is read in its own format, but cannot be changed in another one. (testFile is the compact file.)
+	ObjectDataStructure ods = ObjectDataStructure(testFile);
+	ods.setFormat(Format::STANDARD);
+	CHECK(static_cast<IntTag*>(ods.get("int").get())->getValue() == -420);
+	IntTag tag = IntTag("added", 5);
+	CHECK_THROWS(ods.append(&tag));
+}
+
+// Save the sample tags in every format with every compression, and read them back.
+static void testRoundTrip()
+{
+	for (Format format : formats) {
+		for (CompressionType compression : compressions) {
+			ObjectDataStructure ods = freshFile(compression, format);
+			std::vector<std::shared_ptr<ITag>> tags = sampleTags();
+			ods.save(tags);
+
+			std::vector<std::pair<std::string, std::shared_ptr<ITag>>> keys = sampleKeys(tags);
+			for (auto& key : keys)
+				CHECK(tagBytes(owned(ods.get(key.first)).get()) == tagBytes(key.second.get()));
+			CHECK(ods.get("missing") == NULL);
+			CHECK(ods.get("object.missing") == NULL);
+			std::vector<std::string> names;
+			for (auto& key : keys)
+				names.push_back(key.first);
+			names.push_back("missing");
+			names.push_back("object.missing");
+			std::vector<std::shared_ptr<ITag>> many = ods.getMany(names);
+			CHECK(many.size() == names.size());
+			for (std::shared_ptr<ITag>& tag : many)
+				tag = owned(tag);
+			for (size_t i = 0; i < keys.size() && i < many.size(); i++)
+				CHECK(tagBytes(many[i].get()) == tagBytes(keys[i].second.get()));
+			CHECK(many.size() == names.size() && many[keys.size()] == NULL && many[keys.size() + 1] == NULL);
+
+			BinaryInputStream bis = BinaryInputStream(testFile, compression);
+			std::vector<byte> data(bis.getPointer(), bis.getPointer() + bis.length());
+			bis.close();
+			CHECK(validate(data));
+			if (format == Format::STANDARD)
+				CHECK(data.empty() || data[0] != 'O');
+			else
+				CHECK(data.size() >= 5 && memcmp(data.data(), "ODS", 3) == 0);
+
+			// Changes keep the file readable in its own format.
+			if (compression == CompressionType::NONE)
+				CHECK(ods.set("long", 42L) && static_cast<LongTag*>(ods.get("long").get())->getValue() == 42);
+			StringTag appended = StringTag("appended", "end");
+			ods.append(&appended);
+			CHECK(static_cast<StringTag*>(ods.get("appended").get())->getValue() == "end");
+			IntTag replacement = IntTag("int", 123456789);
+			CHECK(ods.replace("int", &replacement));
+			CHECK(ods.remove("object.name"));
+			CHECK(static_cast<IntTag*>(ods.get("int").get())->getValue() == 123456789);
+			CHECK(ods.get("object.name") == NULL);
+			CHECK(tagBytes(ods.get("object.inner.tst").get()) == tagBytes(keys[10].second.get()));
+		}
+	}
+}
+
+// Names that are read from a file are interned like any other name, and leave the NameTable again with the last
+// tag that uses them.
+static void testNames()
+{
+	CHECK(sizeof(TagName) == sizeof(void*));
+	for (Format format : formats) {
+		ObjectDataStructure ods = freshFile(CompressionType::NONE, format);
+		std::shared_ptr<ObjectTag> object = makeOwned(new ObjectTag("names"));
+		for (int i = 0; i < 20; i++)
+			object->addTag(new IntTag("field" + std::to_string(i), i));
+		ods.save(std::vector<std::shared_ptr<ITag>>{ object });
+		std::vector<byte> data = readFile(testFile);
+		// Rename the fields in the file, so the names that are read are new.
+		for (size_t i = 0; i + 5 < data.size(); i++) {
+			if (memcmp(data.data() + i, "field", 5) == 0)
+				data[i] = 'F';
+		}
+		writeFile(testFile, data);
+		size_t before = NameTable::global().size();
+		std::shared_ptr<ITag> read = owned(ods.get("names"));
+		ITag* field = read == NULL ? NULL : static_cast<ObjectTag*>(read.get())->getTag("Field7");
+		CHECK(field != NULL && field->getTagName() == TagName::transient("Field7"));
+		CHECK(field != NULL && field->getTagName() != TagName("field7"));
+		CHECK(ods.get("names.Field19") != NULL);
+		CHECK(NameTable::global().size() == before + 20);
+		read = NULL;
+		CHECK(NameTable::global().size() == before);
+	}
+}
+
+// In Format::NAMED every distinct name is written once at the start of the file, and tags refer to it by index.
+static void testNameDictionary()
+{
+	std::vector<std::shared_ptr<ITag>> tags;
+	for (int i = 0; i < 100; i++) {
+		std::shared_ptr<ObjectTag> item = makeOwned(new ObjectTag("item" + std::to_string(i % 2)));
+		item->addTag(new IntTag("identifier", i));
+		item->addTag(new StringTag("description", "item " + std::to_string(i)));
+		tags.push_back(item);
+	}
+	std::vector<std::vector<byte>> files;
+	for (Format format : { Format::COMPACT, Format::NAMED }) {
+		ObjectDataStructure ods = freshFile(CompressionType::NONE, format);
+		ods.save(tags);
+		files.push_back(readFile(testFile));
+		CHECK(static_cast<IntTag*>(ods.get("item1.identifier").get())->getValue() == 1);
+	}
+	CHECK(files[1].size() < files[0].size());
+	const char name[] = "description";
+	size_t count = 0;
+	for (auto found = files[1].begin(); (found = std::search(found, files[1].end(), name, name + sizeof(name) - 1)) != files[1].end(); found++)
+		count++;
+	CHECK(count == 1);
+	Format format;
+	long dictionarySize;
+	long start = parseFileHeader(files[1].data(), (long)files[1].size(), format, dictionarySize);
+	CHECK(format == Format::NAMED && dictionarySize > 0 && start > dictionarySize);
+	// (The first tag with a name has the same name, so it comes after every item.)
+	CHECK(static_cast<StringTag*>(ObjectDataStructure(testFile).get("item0.description").get())->getValue() == "item 0");
+
+	// A NameDictionary gives every name one index.
+	NameDictionary dictionary;
+	unsigned int first = dictionary.add("first");
+	CHECK(dictionary.add("second") != first);
+	CHECK(dictionary.add("first") == first);
+}
+
+// A Document holds the same tags as the ITags it is made from, with the children of every container next to each other.
+static void testDocument()
+{
+	std::vector<std::shared_ptr<ITag>> tags = sampleTags();
+	Document document = Document(tags);
+	CHECK(document.rootCount() == tags.size());
+	std::vector<std::shared_ptr<ITag>> back = document.toTags();
+	CHECK(back.size() == tags.size());
+	for (std::shared_ptr<ITag>& tag : back)
+		tag = owned(tag);
+	for (size_t i = 0; i < tags.size() && i < back.size(); i++)
+		CHECK(tagBytes(back[i].get()) == tagBytes(tags[i].get()));
+
+	// The children of a container come after it, in one range.
+	for (unsigned int i = 0; i < document.size(); i++) {
+		const Node& node = document.getNode(i);
+		if (node.isContainer() && node.count > 0)
+			CHECK(document.children(node) == &document.getNode(node.first) && node.first > i && node.first + node.count <= document.size());
+	}
+	const Node* tst = document.find("object.inner.tst");
+	CHECK(tst != NULL && tst->id == 6 && tst->value.l == 2890);
+	CHECK(document.find("object.missing") == NULL);
+	CHECK(document.find("int.missing") == NULL);
+	const Node* string = document.find("string");
+	CHECK(string != NULL && document.string(*string) == "This is a test");
+	CHECK(string != NULL && document.name(*string) == TagName("string"));
+
+	// A document writes the same bytes as its tags, and reading them back gives the same tags.
+	BinaryOutputStream fromTags = BinaryOutputStream();
+	for (std::shared_ptr<ITag>& tag : tags)
+		tag->writeData(fromTags);
+	BinaryOutputStream fromDocument = BinaryOutputStream();
+	document.writeData(fromDocument);
+	std::vector<byte> data(fromDocument.getArray(), fromDocument.getArray() + fromDocument.length());
+	CHECK(std::string(fromTags.getArray(), fromTags.length()) == std::string(data.begin(), data.end()));
+	BinaryInputStream bis = BinaryInputStream(data.data(), (long)data.size());
+	Document read = Document::read(bis);
+	CHECK(read.size() == document.size());
+	CHECK(read.memorySize() >= read.size() * sizeof(Node));
+	back = read.toTags();
+	CHECK(back.size() == tags.size());
+	for (std::shared_ptr<ITag>& tag : back)
+		tag = owned(tag);
+	for (size_t i = 0; i < tags.size() && i < back.size(); i++)
+		CHECK(tagBytes(back[i].get()) == tagBytes(tags[i].get()));
+}
+
+struct Position {
+	double x;
+	double y;
+};
+ODS_SCHEMA(Position, ODS_FIELD(Position, x), ODS_FIELD(Position, y))
+
+struct Player {
+	int health;
+	byte level;
+	float speed;
+	long long score;
+	Position position;
+};
+ODS_SCHEMA(Player, ODS_FIELD(Player, health), ODS_FIELD(Player, level), ODS_FIELD(Player, speed), ODS_FIELD(Player, score), ODS_FIELD(Player, position))
+
+// Structs with an ODS_SCHEMA are saved as ObjectTags, and loaded back without building any tags.
+static void testSchema()
+{
+	for (Format format : formats) {
+		for (CompressionType compression : compressions) {
+			ObjectDataStructure ods = freshFile(compression, format);
+			Player player = { 20, 3, 1.5f, 1234567890123LL, { 2.5, -4 } };
+			ods.save("player", player);
+			Player loaded = {};
+			CHECK(ods.load("player", loaded));
+			CHECK(loaded.health == 20 && loaded.level == 3 && loaded.speed == 1.5f && loaded.score == 1234567890123LL);
+			CHECK(loaded.position.x == 2.5 && loaded.position.y == -4);
+			CHECK(!ods.load("missing", loaded));
+			// The struct is written as normal tags.
+			CHECK(static_cast<IntTag*>(ods.get("player.health").get())->getValue() == 20);
+			CHECK(static_cast<DoubleTag*>(ods.get("player.position.y").get())->getValue() == -4);
+		}
+	}
+
+	// Tags that do not match a field (by name and id) are skipped, and fields without a tag keep their value.
+	ObjectDataStructure ods = freshFile(CompressionType::NONE, Format::STANDARD);
+	std::shared_ptr<ObjectTag> object = makeOwned(new ObjectTag("player"));
+	object->addTag(new IntTag("health", 7));
+	object->addTag(new DoubleTag("level", 5));
+	object->addTag(new StringTag("unknown", "skipped"));
+	ods.save(std::vector<std::shared_ptr<ITag>>{ object });
+	Player partial = { 1, 2, 3, 4, { 5, 6 } };
+	CHECK(ods.load("player", partial));
+	CHECK(partial.health == 7 && partial.level == 2 && partial.speed == 3 && partial.score == 4 && partial.position.x == 5);
+}
+
+static constexpr char healthName[] = "health";
+static constexpr char noName[] = "";
+
+// A FixedTag writes the same bytes as a normal tag with the same name, from a header built at compile time.
+static void testFixedTag()
+{
+	typedef FixedTag<healthName, int> Health;
+	static_assert(Health::header.size() == 7 + 6, "The header is the id, length, name length and name.");
+	Health fixed = Health(20);
+	IntTag tag = IntTag("health", 20);
+	for (Format format : { Format::STANDARD, Format::COMPACT }) {
+		BinaryOutputStream fixedBytes = BinaryOutputStream();
+		BinaryOutputStream tagBytes = BinaryOutputStream();
+		fixedBytes.setFormat(format);
+		tagBytes.setFormat(format);
+		fixed.writeData(fixedBytes);
+		tag.writeData(tagBytes);
+		CHECK(std::string(fixedBytes.getArray(), fixedBytes.length()) == std::string(tagBytes.getArray(), tagBytes.length()));
+	}
+	CHECK(fixed.getTagName() == TagName("health"));
+	CHECK_THROWS(fixed.setName("other"));
+
+	// FixedTags can be stored in VectorTags (without a name) and Documents, and are read back as normal tags.
+	Document document = Document(std::vector<ITag*>{ &fixed });
+	CHECK(document.find("health") != NULL && document.find("health")->value.i == 20);
+	VectorTag vector = VectorTag("vector", std::vector<std::shared_ptr<ITag>>());
+	vector.addTag(std::make_shared<FixedTag<noName, int>>(5));
+	vector.addTag(std::make_shared<FixedTag<noName, int>>(6));
+	ObjectDataStructure ods = freshFile(CompressionType::NONE, Format::STANDARD);
+	ods.save(std::vector<ITag*>{ &fixed, &vector });
+	CHECK(static_cast<IntTag*>(ods.get("health").get())->getValue() == 20);
+	CHECK(tagBytes(ods.get("vector").get()) == tagBytes(&vector));
+}
+
+// VectorTags of ObjectTags with the same fields are written by column, and read back as normal VectorTags.
+static void testColumnar()
+{
+	for (Format format : formats) {
+		for (CompressionType compression : compressions) {
+			ObjectDataStructure ods = freshFile(compression, format);
+			ods.setColumnar(true);
+			std::shared_ptr<VectorTag> rows = std::make_shared<VectorTag>("rows", std::vector<std::shared_ptr<ITag>>());
+			for (int i = 0; i < 50; i++) {
+				std::shared_ptr<ObjectTag> row = makeOwned(new ObjectTag(""));
+				row->addTag(new IntTag("id", i));
+				row->addTag(new DoubleTag("x", i * 0.5));
+				row->addTag(new StringTag("label", "row " + std::to_string(i % 3)));
+				rows->addTag(row);
+			}
+			// Rows with other fields are written normally.
+			std::shared_ptr<VectorTag> mixed = std::make_shared<VectorTag>("mixed", std::vector<std::shared_ptr<ITag>>());
+			std::shared_ptr<ObjectTag> first = makeOwned(new ObjectTag(""));
+			first->addTag(new IntTag("a", 1));
+			std::shared_ptr<ObjectTag> second = makeOwned(new ObjectTag(""));
+			second->addTag(new FloatTag("b", 2));
+			mixed->addTag(first);
+			mixed->addTag(second);
+			ods.save(std::vector<std::shared_ptr<ITag>>{ rows, mixed });
+			CHECK(tagBytes(owned(ods.get("rows")).get()) == tagBytes(rows.get()));
+			CHECK(tagBytes(owned(ods.get("mixed")).get()) == tagBytes(mixed.get()));
+
+			BinaryInputStream bis = BinaryInputStream(testFile, compression);
+			std::vector<byte> data(bis.getPointer(), bis.getPointer() + bis.length());
+			bis.close();
+			CHECK(validate(data));
+
+			ods.setColumnar(false);
+			ods.save(std::vector<std::shared_ptr<ITag>>{ rows, mixed });
+			bis = BinaryInputStream(testFile, compression);
+			CHECK(bis.length() > (long)data.size());
+			bis.close();
+		}
+	}
+}
+
+// VectorTags of StringTags are written with every distinct string once.
+static void testStrings()
+{
+	for (Format format : formats) {
+		for (CompressionType compression : compressions) {
+			ObjectDataStructure ods = freshFile(compression, format);
+			ods.setSequenceEncoding(true);
+			std::shared_ptr<VectorTag> strings = std::make_shared<VectorTag>("strings", std::vector<std::shared_ptr<ITag>>());
+			const char* values[] = { "red", "green", "", "blue", "red", "red", "a much longer string than the others" };
+			for (int i = 0; i < 300; i++)
+				strings->addTag(std::make_shared<StringTag>("", values[(i * 5 + i / 7) % 7]));
+			std::shared_ptr<VectorTag> single = std::make_shared<VectorTag>("single", std::vector<std::shared_ptr<ITag>>());
+			single->addTag(std::make_shared<StringTag>("", "only"));
+			ods.save(std::vector<std::shared_ptr<ITag>>{ strings, single });
+			CHECK(tagBytes(ods.get("strings").get()) == tagBytes(strings.get()));
+			CHECK(tagBytes(ods.get("single").get()) == tagBytes(single.get()));
+
+			BinaryInputStream bis = BinaryInputStream(testFile, compression);
+			std::vector<byte> data(bis.getPointer(), bis.getPointer() + bis.length());
+			bis.close();
+			CHECK(validate(data));
+		}
+	}
+
+	std::vector<std::string_view> values = { "x", "yy", "x", "", "yy", "x" };
+	std::vector<byte> encoded;
+	encodeStrings(values, encoded);
+	std::vector<std::string_view> dictionary;
+	std::vector<unsigned int> indices(values.size());
+	CHECK(decodeStrings(encoded.data(), (long)encoded.size(), values.size(), &dictionary, indices.data()));
+	CHECK(dictionary.size() == 3);
+	for (size_t i = 0; i < values.size(); i++)
+		CHECK(indices[i] < dictionary.size() && dictionary[indices[i]] == values[i]);
+	for (size_t size = 0; size < encoded.size(); size++)
+		CHECK(!decodeStrings(encoded.data(), (long)size, values.size(), &dictionary, indices.data()));
+}
+
+// Changes in journaled mode are checked against the file and the journal, and only reach the file once compacted.
+static void testJournal()
+{
+	for (Format format : { Format::STANDARD, Format::COMPACT }) {
+		for (CompressionType compression : compressions) {
+			ObjectDataStructure ods = freshFile(compression, format);
+			ods.save(sampleTags());
+			ods.setJournaled(true, 1024 * 1024);
+			// (420 has the same size as -420 in the compact format too.)
+			IntTag changed = IntTag("int", 420);
+			IntTag missing = IntTag("missing", 5);
+			IntTag other = IntTag("other", 5);
+			IntTag one = IntTag("appended", 1);
+			StringTag text = StringTag("appended", "now a string");
+			CHECK(ods.set("int", &changed));
+			CHECK(ods.set("int", 6));
+			CHECK(!ods.set("missing", &missing));
+			CHECK_THROWS(ods.set("int", &other));
+			CHECK_THROWS(ods.set("int", 5.0));
+			CHECK_THROWS(ods.remove("compressed.number"));
+			ods.append(&one);
+			CHECK(ods.replace("appended", &text));
+			CHECK(ods.remove("object.name"));
+			CHECK(!ods.remove("object.name"));
+			// Changes are visible before the journal is compacted.
+			CHECK(static_cast<IntTag*>(ods.get("int").get())->getValue() == 6);
+			CHECK(static_cast<StringTag*>(ods.get("appended").get())->getValue() == "now a string");
+			CHECK(ods.get("object.name") == NULL);
+			std::vector<std::shared_ptr<ITag>> many = ods.getMany({ "object.inner.tst", "int", "string", "object.name" });
+			CHECK(many[0] != NULL && many[2] != NULL && many[3] == NULL);
+			CHECK(many[1] != NULL && static_cast<IntTag*>(many[1].get())->getValue() == 6);
+			CHECK(ods.remove("appended"));
+			CHECK(ods.get("appended") == NULL);
+			CHECK(!ods.remove("appended"));
+			IntTag two = IntTag("appended", 2);
+			IntTag three = IntTag("appended", 3);
+			ods.appendAll(std::vector<ITag*>{ &two, &three });
+			CHECK(ods.remove("appended"));
+			CHECK(static_cast<IntTag*>(ods.get("appended").get())->getValue() == 3);
+			CHECK(ods.replace("appended", &text));
+			// Another ObjectDataStructure compacts the journal when it opens the file, and the changes stay the same.
+			ObjectDataStructure opened = ObjectDataStructure(testFile, compression);
+			CHECK(!std::filesystem::exists(testFile + ".journal"));
+			CHECK(static_cast<IntTag*>(ods.get("int").get())->getValue() == 6);
+			CHECK(ods.set("int", 7));
+			CHECK(static_cast<IntTag*>(ods.get("int").get())->getValue() == 7);
+			ods.compact();
+			CHECK(static_cast<IntTag*>(ods.get("int").get())->getValue() == 7);
+			CHECK(static_cast<StringTag*>(ods.get("appended").get())->getValue() == "now a string");
+			CHECK(ods.get("object.name") == NULL);
+			CHECK(ods.get("object.inner.tst") != NULL);
+
+			// A journal left behind is compacted when the file is opened again.
+			CHECK(ods.remove("string"));
+			ObjectDataStructure reopened = ObjectDataStructure(testFile, compression);
+			CHECK(ods.get("string") == NULL);
+
+			// A record that was only partly written is ignored.
+			CHECK(ods.remove("char"));
+			CHECK(ods.remove("byte"));
+			std::vector<byte> journal = readFile(testFile + ".journal");
+			journal.pop_back();
+			writeFile(testFile + ".journal", journal);
+			ods.compact();
+			CHECK(ods.get("char") == NULL);
+			CHECK(ods.get("byte") != NULL);
+
+#ifdef __linux__
+			// A record that cannot be written throws, and the journal is cut back to the last record.
+			CHECK(ods.remove("float"));
+			journal = readFile(testFile + ".journal");
+			StringTag large = StringTag("large", std::string(5000, 'l'));
+			limitFileSize(std::max(journal.size(), readFile(testFile).size()) + 10);
+			CHECK_THROWS(ods.append(&large));
+			limitFileSize(0);
+			CHECK(readFile(testFile + ".journal") == journal);
+			CHECK(ods.remove("double"));
+			ods.compact();
+			CHECK(ods.get("float") == NULL);
+			CHECK(ods.get("double") == NULL);
+			CHECK(ods.get("large") == NULL);
+#endif
+			ods.setJournaled(false);
+		}
+	}
+	ObjectDataStructure named = freshFile(CompressionType::NONE, Format::NAMED);
+	CHECK_THROWS(named.setJournaled(true));
+}
+
+// Data that is cut off or changed must throw an ODSException when it is read, and must be found by validate().
+static void testCorruption()
+{
+	for (Format format : formats) {
+		BinaryOutputStream bos = BinaryOutputStream();
+		bos.setFormat(format);
+		if (format == Format::NAMED)
+			bos.setNameDictionary(std::make_shared<NameDictionary>());
+		bos.setColumnar(true);
+		bos.setSequenceEncoding(true);
+		std::shared_ptr<ObjectTag> object = makeOwned(new ObjectTag("object"));
+		object->addTag(new IntTag("int", -5));
+		object->addTag(new StringTag("string", "hello"));
+		VectorTag* rows = new VectorTag("rows", std::vector<std::shared_ptr<ITag>>());
+		for (int i = 0; i < 4; i++) {
+			std::shared_ptr<ObjectTag> row = makeOwned(new ObjectTag(""));
+			row->addTag(new IntTag("a", i));
+			row->addTag(new StringTag("b", "x"));
+			rows->addTag(row);
+		}
+		object->addTag(rows);
+		object->writeData(bos);
+		bos.writeHeader();
+		std::vector<byte> data(bos.getArray(), bos.getArray() + bos.length());
+		BinaryInputStream whole = BinaryInputStream(data.data(), (long)data.size());
+		CHECK(Document::read(whole).size() == 16);
+		CHECK(validate(data));
+
+		Format fileFormat;
+		long dictionarySize;
+		long start = parseFileHeader(data.data(), (long)data.size(), fileFormat, dictionarySize);
+		CHECK(fileFormat == format);
+		// Every cut inside of the tag leaves it broken.
+		for (size_t size = start + 1; size < data.size(); size++) {
+			std::vector<byte> cut(data.begin(), data.begin() + size);
+			CHECK(!validate(cut));
+			BinaryInputStream bis = BinaryInputStream(cut.data(), (long)cut.size());
+			CHECK_THROWS(Document::read(bis));
+		}
+		// A length that points past the end of the data.
+		std::vector<byte> bad = data;
+		bad[start + 1] = (byte)0x7F;
+		CHECK(!validate(bad));
+		BinaryInputStream bis = BinaryInputStream(bad.data(), (long)bad.size());
+		CHECK_THROWS(Document::read(bis));
+		// An unknown tag id.
+		bad = data;
+		bad[start] = (byte)99;
+		CHECK(!validate(bad));
+	}
+
+	// Compressed files that are cut off throw when they are read.
+	for (CompressionType compression : compressions) {
+		if (compression == CompressionType::NONE)
+			continue;
+		ObjectDataStructure ods = freshFile(compression, Format::STANDARD);
+		ods.save(sampleTags());
+		std::vector<byte> data = readFile(testFile);
+		data.resize(data.size() / 2);
+		writeFile(testFile, data);
+		CHECK_THROWS(ods.get("int"));
+	}
+}
+
+// Changed values are found by the checksums.
+static void testChecksums()
+{
+	for (Format format : formats) {
+		ObjectDataStructure ods = freshFile(CompressionType::NONE, format);
+		ods.setChecksummed(true);
+		ods.save(sampleTags());
+		CHECK(ods.verify());
+		CHECK(ods.verify("object.inner.tst"));
+		std::vector<byte> data = readFile(testFile);
+		const char text[] = "This is a test";
+		auto found = std::search(data.begin(), data.end(), text, text + sizeof(text) - 1);
+		CHECK(found != data.end());
+		*found = 't';
+		writeFile(testFile, data);
+		CHECK(!ods.verify());
+		CHECK(!ods.verify("string"));
+		CHECK(ods.verify("int"));
+	}
+	ObjectDataStructure plain = freshFile(CompressionType::NONE, Format::STANDARD);
+	plain.save(sampleTags());
+	CHECK_THROWS(plain.verify());
+}
+
+// A pseudo random number generator, so the tests do the same thing every time.
+static unsigned long long nextRandom(unsigned long long& state)
+{
+	state = state * 6364136223846793005ULL + 1442695040888963407ULL;
+	return state >> 16;
+}
+
+// Encode values, check that the plan is the expected encoding, and decode them again.
+static void checkSequenceCodec(const std::vector<long long>& values, SequenceEncoding expected)
+{
+	SequencePlan plan = planSequence(values);
+	CHECK(plan.encoding == expected);
+	BinaryOutputStream bos = BinaryOutputStream();
+	encodeSequence(bos, values, plan);
+	std::vector<byte> data(bos.getArray(), bos.getArray() + bos.length());
+	CHECK((long long)data.size() == plan.size);
+	CHECK(checkSequence(plan.encoding, data.data(), (long)data.size(), values.size()));
+	std::vector<long long> decoded(values.size());
+	decodeSequence(plan.encoding, data.data(), (long)data.size(), values.size(), decoded.data());
+	CHECK(decoded == values);
+	for (size_t size = 0; size < data.size(); size++)
+		CHECK(!checkSequence(plan.encoding, data.data(), (long)size, values.size()));
+}
+
+// VectorTags of IntTags and LongTags are written as packed, delta or run length encoded sequences.
+static void testSequences()
+{
+	unsigned long long state = 1;
+	std::vector<std::pair<std::vector<long long>, SequenceEncoding>> sequences;
+	// Small values are packed. (300 values cross the 128 value blocks, and leave some after the last block.)
+	std::vector<long long> small;
+	for (int i = 0; i < 300; i++)
+		small.push_back((long long)(nextRandom(state) % 1000) - 500);
+	sequences.push_back({ small, SequenceEncoding::PACKED });
+	for (size_t count : { 1, 127, 128, 129, 256 })
+		sequences.push_back({ std::vector<long long>(small.begin(), small.begin() + count), SequenceEncoding::PACKED });
+	// Values that use all 64 bits, so the differences wrap around.
+	std::vector<long long> wide;
+	for (int i = 0; i < 200; i++)
+		wide.push_back((long long)(nextRandom(state) << 20 ^ nextRandom(state)));
+	wide.push_back(std::numeric_limits<long long>::min());
+	wide.push_back(std::numeric_limits<long long>::max());
+	sequences.push_back({ wide, SequenceEncoding::PACKED });
+	// Timestamps are deltas.
+	std::vector<long long> timestamps;
+	for (int i = 0; i < 300; i++)
+		timestamps.push_back(1600000000000LL + i * 1000LL + (long long)(nextRandom(state) % 8));
+	sequences.push_back({ timestamps, SequenceEncoding::DELTA });
+	// Repeated values are runs.
+	std::vector<long long> runs;
+	for (int i = 0; i < 1000; i++)
+		runs.push_back(i < 400 ? 7 : i < 999 ? -3 : std::numeric_limits<long long>::max());
+	sequences.push_back({ runs, SequenceEncoding::RUNS });
+
+	for (auto& sequence : sequences)
+		checkSequenceCodec(sequence.first, sequence.second);
+
+	for (Format format : formats) {
+		for (CompressionType compression : { CompressionType::NONE, CompressionType::FAST }) {
+			ObjectDataStructure ods = freshFile(compression, format);
+			ods.setSequenceEncoding(true);
+			std::vector<std::shared_ptr<ITag>> tags;
+			for (size_t i = 0; i < sequences.size(); i++) {
+				std::shared_ptr<VectorTag> longs = std::make_shared<VectorTag>("longs" + std::to_string(i), std::vector<std::shared_ptr<ITag>>());
+				std::shared_ptr<VectorTag> ints = std::make_shared<VectorTag>("ints" + std::to_string(i), std::vector<std::shared_ptr<ITag>>());
+				for (long long value : sequences[i].first) {
+					longs->addTag(std::make_shared<LongTag>("", (long)value));
+					ints->addTag(std::make_shared<IntTag>("", (int)value));
+				}
+				tags.push_back(longs);
+				tags.push_back(ints);
+			}
+			ods.save(tags);
+			for (std::shared_ptr<ITag>& tag : tags)
+				CHECK(tagBytes(ods.get(tag->getName()).get()) == tagBytes(tag.get()));
+			BinaryInputStream bis = BinaryInputStream(testFile, compression);
+			std::vector<byte> data(bis.getPointer(), bis.getPointer() + bis.length());
+			bis.close();
+			CHECK(validate(data));
+
+			// The encoded file is smaller than the normal one.
+			ods.setSequenceEncoding(false);
+			ods.save(tags);
+			bis = BinaryInputStream(testFile, compression);
+			CHECK(bis.length() > (long)data.size());
+			bis.close();
+		}
+	}
+}
+
+// A sequence of equal values can claim any count in a few bytes, so the count is checked against the value limit
+// of the stream before anything is allocated for it.
+static void testValueLimit()
+{
+	BinaryOutputStream bos = BinaryOutputStream();
+	bos.setSequenceEncoding(true);
+	VectorTag same = VectorTag("same", std::vector<std::shared_ptr<ITag>>());
+	for (int i = 0; i < 10; i++)
+		same.addTag(std::make_shared<IntTag>("", 7));
+	same.writeData(bos);
+	std::vector<byte> data(bos.getArray(), bos.getArray() + bos.length());
+	BinaryInputStream bis = BinaryInputStream(data.data(), (long)data.size());
+	CHECK(Document::read(bis).size() == 11);
+	bis = BinaryInputStream(data.data(), (long)data.size());
+	bis.setValueLimit(10);
+	CHECK_THROWS(Document::read(bis));
+	const byte count[] = { 2, 0, 0, 0, 10 };
+	auto found = std::search(data.begin(), data.end(), count, count + sizeof(count));
+	CHECK(found != data.end());
+	found[1] = (byte)0x7F;
+	found[2] = found[3] = found[4] = (byte)0xFF;
+	CHECK(validate(data));
+	bis = BinaryInputStream(data.data(), (long)data.size());
+	CHECK_THROWS(Document::read(bis));
+
+	// A DELTA sequence of width 0 must be of equal values, so a few bytes cannot make a range of any length.
+	const byte range[] = { 0, 2, 0 };
+	CHECK(!checkSequence(SequenceEncoding::DELTA, range, sizeof(range), 0x7FFFFFFF));
+	const byte equal[] = { 0, 0, 0 };
+	CHECK(checkSequence(SequenceEncoding::DELTA, equal, sizeof(equal), 0x7FFFFFFF));
+}
+
+// Encode the bits of a series of floats (width 32) or doubles (width 64) and decode them again.
+static void checkSeriesCodec(const std::vector<unsigned long long>& values, int width)
+{
+	std::vector<byte> data;
+	long long size = encodeSeries(values, width, &data);
+	CHECK(size == (long long)data.size());
+	CHECK(encodeSeries(values, width, NULL) == size);
+	std::vector<unsigned long long> decoded(values.size());
+	CHECK(decodeSeries(data.data(), (long)data.size(), values.size(), width, decoded.data()));
+	CHECK(decoded == values);
+	for (size_t cut = 0; cut < data.size(); cut++)
+		CHECK(!decodeSeries(data.data(), (long)cut, values.size(), width, NULL));
+}
+
+// VectorTags of FloatTags and DoubleTags are written as XOR compressed series.
+static void testSeries()
+{
+	unsigned long long state = 2;
+	std::vector<std::vector<double>> series;
+	series.push_back(std::vector<double>(500, 21.5));
+	std::vector<double> smooth;
+	for (int i = 0; i < 500; i++)
+		smooth.push_back(20 + std::sin(i / 50.0) * 5);
+	series.push_back(smooth);
+	std::vector<double> noise;
+	for (int i = 0; i < 500; i++) {
+		unsigned long long bits = nextRandom(state) << 24 ^ nextRandom(state);
+		double value;
+		memcpy(&value, &bits, sizeof(value));
+		noise.push_back(std::isnan(value) ? 0 : value);
+	}
+	series.push_back(noise);
+	series.push_back({ 0.0, -0.0, std::numeric_limits<double>::infinity(), -std::numeric_limits<double>::infinity(),
+		std::numeric_limits<double>::quiet_NaN(), std::numeric_limits<double>::denorm_min(), std::numeric_limits<double>::max(), 1.0 });
+	series.push_back({ 3.25 });
+
+	for (std::vector<double>& values : series) {
+		std::vector<unsigned long long> doubles;
+		std::vector<unsigned long long> floats;
+		for (double value : values) {
+			unsigned long long bits;
+			memcpy(&bits, &value, sizeof(bits));
+			doubles.push_back(bits);
+			float single = (float)value;
+			unsigned int singleBits;
+			memcpy(&singleBits, &single, sizeof(singleBits));
+			floats.push_back(singleBits);
+		}
+		checkSeriesCodec(doubles, 64);
+		checkSeriesCodec(floats, 32);
+	}
+	// A constant series is a few bits per value.
+	std::vector<byte> data;
+	encodeSeries(std::vector<unsigned long long>(1000, 0x4035800000000000ULL), 64, &data);
+	CHECK(data.size() < 200);
+
+	for (Format format : formats) {
+		for (CompressionType compression : { CompressionType::NONE, CompressionType::ADAPTIVE }) {
+			ObjectDataStructure ods = freshFile(compression, format);
+			ods.setSequenceEncoding(true);
+			std::vector<std::shared_ptr<ITag>> tags;
+			for (size_t i = 0; i < series.size(); i++) {
+				std::shared_ptr<VectorTag> doubles = std::make_shared<VectorTag>("doubles" + std::to_string(i), std::vector<std::shared_ptr<ITag>>());
+				std::shared_ptr<VectorTag> floats = std::make_shared<VectorTag>("floats" + std::to_string(i), std::vector<std::shared_ptr<ITag>>());
+				for (double value : series[i]) {
+					doubles->addTag(std::make_shared<DoubleTag>("", value));
+					floats->addTag(std::make_shared<FloatTag>("", (float)value));
+				}
+				tags.push_back(doubles);
+				tags.push_back(floats);
+			}
+			ods.save(tags);
+			// (The bytes are compared, so NaN and -0.0 must come back with the same bits.)
+			for (std::shared_ptr<ITag>& tag : tags)
+				CHECK(tagBytes(ods.get(tag->getName()).get()) == tagBytes(tag.get()));
+			BinaryInputStream bis = BinaryInputStream(testFile, compression);
+			std::vector<byte> data(bis.getPointer(), bis.getPointer() + bis.length());
+			bis.close();
+			CHECK(validate(data));
+
+			// Every cut of the file in the middle of a series tag is rejected.
+			if (compression == CompressionType::NONE) {
+				std::vector<TagLocation> path;
+				BufferSource source = BufferSource(data.data(), (long)data.size());
+				CHECK(TagLocator::locate(source, "doubles1", path));
+				for (long size = path.back().start + 1; size < path.back().end; size++) {
+					std::vector<byte> cut(data.begin(), data.begin() + size);
+					CHECK(!validate(cut));
+					BinaryInputStream cutStream = BinaryInputStream(cut.data(), (long)cut.size());
+					CHECK_THROWS(Document::read(cutStream));
+				}
+			}
+		}
+	}
+}
+
+// Compress data as a FAST frame and decompress it again.
+static void checkFastRoundTrip(const std::vector<byte>& data)
+{
+	std::vector<byte> compressed = compressBytes(CompressionType::FAST, data.data(), data.size());
+	std::vector<byte> decompressed = decompressBytes(CompressionType::FAST, compressed.data(), compressed.size());
+	CHECK(decompressed == data);
+	// A frame that is cut off always throws. (No bytes at all is an empty file. Big frames are only cut at a few places.)
+	size_t step = compressed.size() > 4096 ? compressed.size() / 64 : 1;
+	for (size_t size = 1; size < compressed.size(); size += step)
+		CHECK_THROWS(decompressBytes(CompressionType::FAST, compressed.data(), size));
+}
+
+// The FAST codec at the edges of its format: tiny inputs, block boundaries, and matches that overlap themselves.
+static void testFast()
+{
+	unsigned long long state = 3;
+	const std::string text = "The quick brown fox jumps over the lazy dog. ";
+	auto textOf = [&](size_t size) {
+		std::vector<byte> data(size);
+		for (size_t i = 0; i < size; i++)
+			data[i] = text[(i + i / 1000) % text.size()];
+		return data;
+	};
+	auto randomOf = [&](size_t size) {
+		std::vector<byte> data(size);
+		for (size_t i = 0; i < size; i++)
+			data[i] = (byte)nextRandom(state);
+		return data;
+	};
+
+	// Empty input, and inputs too short for a match (the last match must start 12 bytes before the end).
+	for (size_t size = 0; size <= 13; size++) {
+		checkFastRoundTrip(textOf(size));
+		checkFastRoundTrip(std::vector<byte>(size, 'a'));
+	}
+
+	// Blocks are fastBlockSize (1 MiB) bytes.
+	for (size_t size : { fastBlockSize - 1, fastBlockSize, fastBlockSize + 1, 2 * fastBlockSize + 13 }) {
+		checkFastRoundTrip(textOf(size));
+		checkFastRoundTrip(randomOf(size));
+	}
+	std::vector<byte> data = textOf(3 * fastBlockSize);
+	CHECK(compressBytes(CompressionType::FAST, data.data(), data.size()).size() < data.size() / 10);
+	// Blocks that do not compress are stored as they are.
+	data = randomOf(fastBlockSize);
+	CHECK(compressBytes(CompressionType::FAST, data.data(), data.size()).size() <= data.size() + 16);
+
+	// A pattern that repeats every offset bytes is made of matches that copy bytes they wrote themselves.
+	for (size_t offset = 1; offset < 16; offset++) {
+		std::vector<byte> pattern = randomOf(offset);
+		data.clear();
+		for (size_t i = 0; i < 5000 + offset; i++)
+			data.push_back(pattern[i % offset]);
+		checkFastRoundTrip(data);
+		std::vector<unsigned int> table(1 << fastHashBits);
+		std::vector<byte> block(fastCompressBound(data.size()));
+		size_t size = fastCompressBlock(data.data(), data.size(), block.data(), table.data());
+		CHECK(size < 100);
+		std::vector<byte> out(data.size());
+		CHECK(fastDecompressBlock(block.data(), size, out.data(), out.size()));
+		CHECK(out == data);
+		// The block must fill exactly the size it was given.
+		CHECK(!fastDecompressBlock(block.data(), size, out.data(), out.size() - 1));
+		out.resize(data.size() + 1);
+		CHECK(!fastDecompressBlock(block.data(), size, out.data(), out.size()));
+	}
+
+	// A match that points before the start of the block.
+	const byte bad[] = { 0x10, 'a', 0x05, 0x00, 0x00 };
+	std::vector<byte> out(16);
+	CHECK(!fastDecompressBlock(bad, sizeof(bad), out.data(), 5));
+	// A frame that does not start with the magic.
+	data = textOf(100);
+	std::vector<byte> compressed = compressBytes(CompressionType::FAST, data.data(), data.size());
+	compressed[0] = 'X';
+	CHECK_THROWS(decompressBytes(CompressionType::FAST, compressed.data(), compressed.size()));
+}
+
+// ADAPTIVE compresses the blocks that are worth it, and stores the rest (such as random bytes) as they are.
+static void testAdaptive()
+{
+	unsigned long long state = 4;
+	std::vector<byte> random(3 * adaptiveBlockSize);
+	for (byte& b : random)
+		b = (byte)nextRandom(state);
+	std::vector<byte> text;
+	while (text.size() < 2 * adaptiveBlockSize) {
+		std::string line = "line " + std::to_string(text.size() % 977) + ": the same words again and again\n";
+		text.insert(text.end(), line.begin(), line.end());
+	}
+	CHECK(looksIncompressible(random.data(), random.size(), defaultCompressionThreshold));
+	CHECK(!looksIncompressible(text.data(), text.size(), defaultCompressionThreshold));
+
+	// Every block of random bytes is stored with only its 8 byte header, and the frame adds its magic and end.
+	std::vector<byte> compressed = compressBytes(CompressionType::ADAPTIVE, random.data(), random.size());
+	CHECK(compressed.size() == random.size() + 3 * 8 + 8);
+	CHECK(decompressBytes(CompressionType::ADAPTIVE, compressed.data(), compressed.size()) == random);
+
+	std::vector<byte> mixed = random;
+	mixed.insert(mixed.end(), text.begin(), text.end());
+	mixed.insert(mixed.end(), random.begin(), random.begin() + 1000);
+	compressed = compressBytes(CompressionType::ADAPTIVE, mixed.data(), mixed.size());
+	CHECK(compressed.size() < random.size() + 1000 + text.size() / 10);
+	CHECK(decompressBytes(CompressionType::ADAPTIVE, compressed.data(), compressed.size()) == mixed);
+	// With a threshold that no block can reach, everything is stored as it is.
+	compressed = compressBytes(CompressionType::ADAPTIVE, text.data(), text.size(), 0.99);
+	CHECK(compressed.size() == text.size() + (text.size() + adaptiveBlockSize - 1) / adaptiveBlockSize * 8 + 8);
+	for (size_t size = 1; size < compressed.size(); size += 997)
+		CHECK_THROWS(decompressBytes(CompressionType::ADAPTIVE, compressed.data(), size));
+
+	ObjectDataStructure ods = freshFile(CompressionType::ADAPTIVE, Format::STANDARD);
+	CHECK_THROWS(ods.setCompressionThreshold(1));
+	CHECK_THROWS(ods.setCompressionThreshold(-0.1));
+	ods.setCompressionThreshold(0.2);
+	StringTag noise = StringTag("noise", std::string(random.begin(), random.end()));
+	StringTag words = StringTag("words", std::string(text.begin(), text.end()));
+	ods.save(std::vector<ITag*>{ &noise, &words });
+	CHECK(tagBytes(ods.get("noise").get()) == tagBytes(&noise));
+	CHECK(tagBytes(ods.get("words").get()) == tagBytes(&words));
+	CHECK(readFile(testFile).size() < random.size() + text.size() / 10);
+}
+
+// A CompressedObjectTag compresses its children with its own type and level, and keeps them when it is read and saved again.
+static void testCompressedObject()
+{
+	std::string text;
+	for (int i = 0; i < 2000; i++)
+		text += "value " + std::to_string(i % 50) + " ";
+	for (CompressionType compression : { CompressionType::GZIP, CompressionType::ZLIB, CompressionType::ADAPTIVE }) {
+		std::vector<size_t> sizes;
+		for (int level : { 0, 1, 9 }) {
+			std::shared_ptr<CompressedObjectTag> cold = makeOwned(new CompressedObjectTag("cold", compression, level));
+			cold->addTag(new StringTag("text", text));
+			cold->addTag(new IntTag("count", 2000));
+			CHECK(cold->getCompression() == compression && cold->getLevel() == level);
+			sizes.push_back(tagBytes(cold.get()).size());
+			// A Document keeps the level.
+			BinaryOutputStream bos = BinaryOutputStream();
+			Document(std::vector<std::shared_ptr<ITag>>{ cold }).writeData(bos);
+			CHECK(std::string(bos.getArray(), bos.length()) == tagBytes(cold.get()));
+
+			ObjectDataStructure ods = freshFile(CompressionType::NONE, Format::COMPACT);
+			IntTag hot = IntTag("hot", 1);
+			ods.save(std::vector<std::shared_ptr<ITag>>{ std::make_shared<IntTag>("hot", 1), cold });
+			CHECK(static_cast<StringTag*>(ods.get("cold.text").get())->getValue() == text);
+			CHECK(ods.set("hot", 2));
+			CHECK(static_cast<IntTag*>(ods.get("hot").get())->getValue() == 2);
+			std::shared_ptr<ITag> read = owned(ods.get("cold"));
+			CHECK(read != NULL && read->getID() == 12);
+			CHECK(read != NULL && static_cast<CompressedObjectTag*>(read.get())->getCompression() == compression);
+			CHECK_THROWS(ods.remove("cold.count"));
+			CHECK_THROWS(ods.replace("cold.count", &hot));
+		}
+		// Level 0 only stores the data, and higher levels compress it more.
+		CHECK(sizes[0] > text.size() && sizes[1] < text.size() / 4 && sizes[2] <= sizes[1]);
+		CHECK_THROWS(CompressedObjectTag("cold", compression, 10));
+		CHECK_THROWS(CompressedObjectTag("cold", compression, -1));
+	}
+	CHECK_THROWS(CompressedObjectTag("cold", CompressionType::NONE));
+}
+
+// Every thread reuses its own CompressionContext for many small messages, and a context can move between threads.
+static void testCompressionContext()
+{
+	std::vector<std::vector<byte>> messages;
+	for (int i = 0; i < 40; i++) {
+		std::string message = "{\"id\":" + std::to_string(i) + ",\"name\":\"message " + std::to_string(i) + "\",\"values\":[";
+		for (int j = 0; j < i; j++)
+			message += std::to_string(j * i) + ",";
+		message += "0]}";
+		messages.push_back(std::vector<byte>(message.begin(), message.end()));
+	}
+	const CompressionType types[] = { CompressionType::GZIP, CompressionType::ZLIB, CompressionType::FAST, CompressionType::ADAPTIVE };
+
+	std::atomic<int> wrong(0);
+	std::vector<std::thread> threads;
+	for (int t = 0; t < 4; t++) {
+		threads.emplace_back([&, t]() {
+			CompressionContext context;
+			std::vector<byte> compressed;
+			std::vector<byte> decompressed;
+			for (int round = 0; round < 20; round++) {
+				for (CompressionType type : types) {
+					for (std::vector<byte>& message : messages) {
+						compressed.clear();
+						decompressed.clear();
+						// Half of the threads use the context of the thread instead.
+						if (t % 2 == 0) {
+							context.compress(type, message.data(), message.size(), compressed);
+							context.decompress(type, compressed.data(), compressed.size(), decompressed);
+						}
+						else {
+							compressed = compressBytes(type, message.data(), message.size());
+							decompressed = decompressBytes(type, compressed.data(), compressed.size());
+						}
+						if (decompressed != message)
+							wrong++;
+					}
+				}
+			}
+		});
+	}
+	for (std::thread& thread : threads)
+		thread.join();
+	CHECK(wrong == 0);
+
+	// One context that is used by one thread after another, and messages that are compressed onto the same vector.
+	CompressionContext shared;
+	for (CompressionType type : types) {
+		std::vector<byte> compressed;
+		for (std::vector<byte>& message : messages)
+			std::thread([&]() { shared.compress(type, message.data(), message.size(), compressed); }).join();
+		std::vector<byte> decompressed;
+		std::thread([&]() { shared.decompress(type, compressed.data(), compressed.size(), decompressed); }).join();
+		std::vector<byte> all;
+		for (std::vector<byte>& message : messages)
+			all.insert(all.end(), message.begin(), message.end());
+		CHECK(decompressed == all);
+	}
+}
+
+// The number of temporary files that an AtomicFile for file left behind.
+static int tempFiles(const std::string& file)
+{
+	int count = 0;
+	for (const std::filesystem::directory_entry& entry : std::filesystem::directory_iterator(".")) {
+		std::string name = entry.path().filename().string();
+		if (name.size() > file.size() + 4 && name.compare(0, file.size() + 1, file + ".") == 0
+			&& name.compare(name.size() - 4, 4, ".tmp") == 0)
+			count++;
+	}
+	return count;
+}
+
+// Files are replaced through a temporary file, which is never left behind.
+static void testAtomicFile()
+{
+	ObjectDataStructure ods = freshFile(CompressionType::NONE, Format::STANDARD);
+	ods.save(sampleTags());
+	IntTag replacement = IntTag("int", 1234567);
+	CHECK(ods.replace("int", &replacement));
+	CHECK(ods.remove("string"));
+	CHECK(static_cast<IntTag*>(ods.get("int").get())->getValue() == 1234567);
+	CHECK(tempFiles(testFile) == 0);
+
+	// A file that is not written is left as it was.
+	{
+		AtomicFile file = AtomicFile(testFile);
+		const byte data[] = { 1, 2, 3 };
+		file.write(data, sizeof(data));
+	}
+	CHECK(tempFiles(testFile) == 0);
+	CHECK(static_cast<IntTag*>(ods.get("int").get())->getValue() == 1234567);
+
+	// A file that cannot be replaced (here a directory that is not empty) throws an ODSException.
+	const std::string directory = "ods_test_directory.ods";
+	std::filesystem::remove_all(directory);
+	std::filesystem::create_directory(directory);
+	writeFile(directory + "/inside", std::vector<byte>(1, 'x'));
+	ObjectDataStructure blocked = ObjectDataStructure(directory);
+	CHECK_THROWS(blocked.save(sampleTags()));
+	CHECK(tempFiles(directory) == 0);
+	CHECK(std::filesystem::is_directory(directory));
+	std::filesystem::remove_all(directory);
+
+	// Every save and splice replaces the whole file (with a new inode), and keeps its permissions.
+	for (CompressionType compression : compressions) {
+		for (SyncPolicy policy : { SyncPolicy::NONE, SyncPolicy::FULL }) {
+			ObjectDataStructure file = freshFile(compression, Format::STANDARD);
+			file.setSyncPolicy(policy);
+			file.save(sampleTags());
+			std::filesystem::perms perms = std::filesystem::perms::owner_read | std::filesystem::perms::owner_write | std::filesystem::perms::group_read;
+			std::filesystem::permissions(testFile, perms);
+#ifdef __linux__
+			long long inode = fileId(testFile);
+#endif
+			CHECK(file.replace("int", &replacement));
+			CHECK(static_cast<IntTag*>(file.get("int").get())->getValue() == 1234567);
+			CHECK(tempFiles(testFile) == 0);
+			CHECK(std::filesystem::status(testFile).permissions() == perms);
+#ifdef __linux__
+			CHECK(fileId(testFile) != inode);
+#endif
+			file.save(sampleTags());
+			CHECK(tempFiles(testFile) == 0);
+			CHECK(std::filesystem::status(testFile).permissions() == perms);
+		}
+	}
+	std::filesystem::permissions(testFile, std::filesystem::perms::owner_read | std::filesystem::perms::owner_write);
+}
+
+// append() adds tags to the end of the file, and leaves the file as it was if they cannot be written.
+static void testAppend()
+{
+	for (Format format : { Format::STANDARD, Format::COMPACT }) {
+		for (CompressionType compression : { CompressionType::NONE, CompressionType::FAST }) {
+			for (bool checksummed : { false, true }) {
+				ObjectDataStructure ods = freshFile(compression, format);
+				ods.setChecksummed(checksummed);
+				StringTag first = StringTag("first", "appended to a file that does not exist");
+				ods.append(&first);
+				ods.appendAll(sampleTags());
+				ods.appendAll(std::vector<std::shared_ptr<ITag>>{ std::make_shared<IntTag>("last", 5), std::make_shared<IntTag>("after", 6) });
+				CHECK(tagBytes(ods.get("first").get()) == tagBytes(&first));
+				CHECK(static_cast<IntTag*>(ods.get("int").get())->getValue() == -420);
+				CHECK(static_cast<IntTag*>(ods.get("after").get())->getValue() == 6);
+				CHECK(ods.get("object.inner.tst") != NULL);
+				if (checksummed)
+					CHECK(ods.verify());
+#ifdef __linux__
+				std::vector<byte> before = readFile(testFile);
+				StringTag large = StringTag("large", std::string(5000, 'l'));
+				limitFileSize(before.size() + 10);
+				CHECK_THROWS(ods.append(&large));
+				limitFileSize(0);
+				CHECK(readFile(testFile) == before);
+				CHECK(ods.get("large") == NULL);
+				if (checksummed)
+					CHECK(ods.verify());
+#endif
+			}
+		}
+	}
+}
+
+// set() overwrites only the bytes of the value (or the tag), and keeps the checksums up to date.
+static void testSet()
+{
+	for (Format format : { Format::STANDARD, Format::COMPACT }) {
+		for (SyncPolicy policy : { SyncPolicy::NONE, SyncPolicy::DATA, SyncPolicy::FULL }) {
+			ObjectDataStructure ods = freshFile(CompressionType::NONE, format);
+			ods.setSyncPolicy(policy);
+			ods.setChecksummed(true);
+			ods.save(sampleTags());
+			std::vector<byte> before = readFile(testFile);
+#ifdef __linux__
+			long long inode = fileId(testFile);
+#endif
+
+			CHECK(ods.set("object.inner.tst", 2891L));
+			std::vector<byte> after = readFile(testFile);
+			CHECK(after.size() == before.size());
+#ifdef __linux__
+			// The file is changed in place, not replaced.
+			CHECK(fileId(testFile) == inode);
+#endif
+			std::vector<TagLocation> path;
+			BufferSource source = BufferSource(after.data(), (long)after.size());
+			CHECK(TagLocator::locate(source, "object.inner.tst", path));
+			// Only the value and the checksum of the top level tag changed.
+			std::vector<ChecksumEntry> entries;
+			long footer = Checksums::find(source, entries);
+			for (size_t i = 0; i < after.size(); i++) {
+				bool value = (long)i >= path.back().valueStart && (long)i < path.back().end;
+				if (!value && (long)i < footer)
+					CHECK(after[i] == before[i]);
+			}
+			CHECK(after != before);
+			// The value is written big endian in the standard format, and as a zigzag varint in the compact format.
+			if (format == Format::STANDARD) {
+				const byte value[] = { 0, 0, 0, 0, 0, 0, 0x0B, 0x4B };
+				CHECK(path.back().end - path.back().valueStart == 8);
+				CHECK(memcmp(after.data() + path.back().valueStart, value, sizeof(value)) == 0);
+			}
+			else {
+				byte value[10];
+				int size = encodeVarint(value, zigzagEncode(2891));
+				CHECK(path.back().end - path.back().valueStart == size);
+				CHECK(memcmp(after.data() + path.back().valueStart, value, size) == 0);
+			}
+			CHECK(static_cast<LongTag*>(ods.get("object.inner.tst").get())->getValue() == 2891);
+			CHECK(ods.verify());
+
+			// A whole tag of the same size is written over the old one.
+			IntTag tag = IntTag("int", 420);
+			CHECK(ods.set("int", &tag));
+			CHECK(readFile(testFile).size() == before.size());
+			CHECK(static_cast<IntTag*>(ods.get("int").get())->getValue() == 420);
+			CHECK(ods.verify());
+			IntTag renamed = IntTag("tni", 420);
+			CHECK_THROWS(ods.set("int", &renamed));
+			CHECK_THROWS(ods.set("int", 1.5));
+			CHECK(!ods.set("missing", 5));
+			CHECK_THROWS(ods.set("compressed.number", 5));
+		}
+	}
+	// Compressed files cannot be changed in place.
+	ObjectDataStructure compressed = freshFile(CompressionType::ZLIB, Format::STANDARD);
+	compressed.save(sampleTags());
+	CHECK_THROWS(compressed.set("int", 5));
+}
+
+// remove() and replace() copy the rest of the file into a new one, which is never committed if the copy is short.
+static void testSplice()
+{
+	writeFile(testFile, std::vector<byte>(100, 'x'));
+	{
+		std::ifstream in(testFile, std::ios::in | std::ios::binary);
+		AtomicFile file = AtomicFile(testFile);
+		// (As if the file shrank to 100 bytes after it was located.)
+		CHECK_THROWS(copyStreamRange(in, file, 0, 200));
+	}
+	CHECK(tempFiles(testFile) == 0);
+	CHECK(readFile(testFile) == std::vector<byte>(100, 'x'));
+}
+
+// Hits return the cached document, a changed file is loaded again, and documents that were used stay when others are evicted.
+static void testDocumentCache()
+{
+	std::vector<std::string> files = { "ods_cache_0.ods", "ods_cache_1.ods", "ods_cache_2.ods" };
+	for (const std::string& file : files)
+		ObjectDataStructure(file).save(sampleTags());
+
+	DocumentCache cache;
+	std::shared_ptr<const Document> first = cache.get(files[0]);
+	CHECK(cache.get(files[0]) == first);
+	cache.clear();
+	CHECK(cache.size() == 0);
+
+	// Room for two of the documents.
+	first = cache.get(files[0]);
+	size_t bytes = cache.size();
+	cache.setCapacity(bytes * 2 + bytes / 2);
+	std::shared_ptr<const Document> second = cache.get(files[1]);
+	CHECK(cache.get(files[0]) == first);
+	cache.get(files[2]);
+	CHECK(cache.size() <= bytes * 2 + bytes / 2);
+	// The first document was used since it was added, so the second one was evicted instead.
+	CHECK(cache.get(files[0]) == first);
+	CHECK(cache.get(files[1]) != second);
+
+	// Many threads hit the same document at once.
+	cache.setCapacity(bytes * 10);
+	std::shared_ptr<const Document> shared = cache.get(files[2]);
+	std::atomic<int> misses(0);
+	std::vector<std::thread> threads;
+	for (int i = 0; i < 8; i++)
+		threads.emplace_back([&]() {
+			for (int j = 0; j < 1000; j++)
+				if (cache.get(files[2]) != shared)
+					misses++;
+		});
+	for (std::thread& thread : threads)
+		thread.join();
+	CHECK(misses == 0);
+
+	// A file that changes is loaded again.
+	std::vector<std::shared_ptr<ITag>> tags = sampleTags();
+	tags.push_back(std::make_shared<IntTag>("extra", 1));
+	ObjectDataStructure(files[2]).save(tags);
+	std::shared_ptr<const Document> changed = cache.get(files[2]);
+	CHECK(changed != shared);
+	CHECK(cache.get(files[2]) == changed);
+
+	cache.setCapacity(0);
+	CHECK(cache.get(files[2]) == changed);
+	for (const std::string& file : files)
+		std::remove(file.c_str());
+	CHECK_THROWS(cache.get(files[0]));
+}
+
+// Many threads read the same bytes at once, each with its own cursor.
+static void testReaders()
+{
+	for (CompressionType compression : { CompressionType::NONE, CompressionType::ZLIB }) {
+		ObjectDataStructure ods = freshFile(compression, Format::STANDARD);
+		ods.save(sampleTags());
+		std::shared_ptr<const ByteSource> source = ByteSource::fromFile(testFile, compression);
+#ifndef _WIN32
+		CHECK(source->isMapped() == (compression == CompressionType::NONE));
+#endif
+		BinaryInputStream stream = BinaryInputStream(source);
+		CHECK(stream.getSource() == source);
+		size_t nodes = Document::read(stream).size();
+		CHECK(stream.remaining() == 0);
+
+		std::atomic<int> wrong(0);
+		std::vector<std::thread> threads;
+		for (int t = 0; t < 8; t++) {
+			threads.emplace_back([&]() {
+				BinaryInputStream cursor = stream.cursor();
+				for (int i = 0; i < 200; i++) {
+					cursor.setIndex(0);
+					Document document = Document::read(cursor);
+					const Node* tst = document.find("object.inner.tst");
+					if (document.size() != nodes || tst == NULL || tst->value.l != 2890)
+						wrong++;
+				}
+			});
+		}
+		for (std::thread& thread : threads)
+			thread.join();
+		CHECK(wrong == 0);
+
+		// The bytes stay alive while any stream uses them.
+		BinaryInputStream copy = stream;
+		std::weak_ptr<const ByteSource> weak = source;
+		source = NULL;
+		stream.close();
+		copy.setIndex(0);
+		CHECK(Document::read(copy).size() == nodes);
+		copy.close();
+		CHECK(weak.expired());
+	}
+}
+
+// Run a test, counting an exception that it did not expect as a failure.
+static void run(const char* name, void (*test)())
+{
+	try {
+		test();
+	}
+	catch (std::exception& e) {
+		std::cout << "FAILED: " << name << " threw: " << e.what() << std::endl;
+		failures++;
+	}
+}
 
 int main(void) {
-	/*
-	double d = 25.6;
-	std::cout << sizeof(reinterpret_cast<char*>(&d)) << std::endl;
-	ODS::BinaryOutputStream bos = ODS::BinaryOutputStream("example.ods");
-	bos.writeShort(20);
-	bos.writeInt(420);
-	bos.writeDouble(25.64);
-	bos.writeFloat(25.64);
-	bos.writeString("This is a test.png");
-	long l = 2030;
-	bos.writeLong(l);
-	bos.close();
-
-	std::string fws = "This is a test.png";
-
-	ODS::BinaryInputStream bis = ODS::BinaryInputStream("example.ods");
-	std::cout << bis.readShort() << std::endl;
-	std::cout << bis.readInt() << std::endl;
-	std::cout << bis.readDouble() << std::endl;
-	std::cout << bis.readFloat() << std::endl;
-	std::cout << bis.readString(18) + "\0" << std::endl;
-	std::cout << bis.readLong() << std::endl;
-	bis.close();
-	*/
-
-	ODS::ObjectDataStructure ods = ODS::ObjectDataStructure("example.ods", CompressionType::ZLIB);
-	ByteTag bt = ByteTag("yeet", 44);
-	std::vector<ITag*> tags = std::vector< ITag*>();
-	tags.push_back(new ByteTag("yeet", 44));
-	tags.push_back(new DoubleTag("yeetwef", 90.564));
-	tags.push_back(new FloatTag("mefloat", 90.888888));
-	tags.push_back( new IntTag("meInt", 420));
-
-	VectorTag* testVec = new VectorTag("Test", std::vector<std::shared_ptr <ITag>>());
-	testVec->addTag((std::shared_ptr <IntTag>) new IntTag("Test", 20));
-	testVec->addTag((std::shared_ptr <IntTag>) new IntTag("Test", 30));
-	testVec->addTag((std::shared_ptr <IntTag>) new IntTag("Test", 60));
-
-	tags.push_back( testVec);
-
-	ObjectTag objTag = ObjectTag("Test");
-	objTag.addTag(new LongTag("tst", 2890));
-	IntTag* intTag = new IntTag("woah", 25);
-	
-	tags.push_back( &objTag);
-
-	ods.save(tags);
-
-	return 0;
-}
\ No newline at end of file
+	run("testCompact", testCompact);
+	run("testRoundTrip", testRoundTrip);
+	run("testNames", testNames);
+	run("testNameDictionary", testNameDictionary);
+	run("testDocument", testDocument);
+	run("testSchema", testSchema);
+	run("testFixedTag", testFixedTag);
+	run("testColumnar", testColumnar);
+	run("testStrings", testStrings);
+	run("testSequences", testSequences);
+	run("testValueLimit", testValueLimit);
+	run("testSeries", testSeries);
+	run("testFast", testFast);
+	run("testAdaptive", testAdaptive);
+	run("testCompressedObject", testCompressedObject);
+	run("testCompressionContext", testCompressionContext);
+	run("testAtomicFile", testAtomicFile);
+	run("testAppend", testAppend);
+	run("testSet", testSet);
+	run("testSplice", testSplice);
+	run("testDocumentCache", testDocumentCache);
+	run("testReaders", testReaders);
+	run("testJournal", testJournal);
+	run("testCorruption", testCorruption);
+	run("testChecksums", testChecksums);
+
+	std::remove(testFile.c_str());
+	std::remove((testFile + ".journal").c_str());
+	if (failures == 0)
+		std::cout << "All tests passed." << std::endl;
+	return failures;
+}
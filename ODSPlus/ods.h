@@ -25,10 +25,56 @@ License: MIT (see LICENSE file).
 #include <vector>;
 #include <algorithm>;
 #include <any>;
+#include <cstdio>;
+#include <cerrno>;
+#include <filesystem>;
+#include <array>;
+#include <atomic>;
+#include <unordered_map>;
+#include <mutex>;
+#include <shared_mutex>;
+#include <thread>;
+#include <chrono>;
+#include <list>;
+#include <memory>;
+#include <string_view>;
+#include <tuple>;
+#include <type_traits>;
+#include <cmath>;
 
 // Include dependencies. 
 #include "depends.h";
 
+// Used to flush files to the disk, and to create temporary files that do not exist yet.
+#ifdef _WIN32
+#include <io.h>;
+#include <fcntl.h>;
+#include <sys/stat.h>;
+#else
+#include <unistd.h>;
+#include <fcntl.h>;
+#include <sys/mman.h>;
+#include <sys/stat.h>;
+#endif
+
+// Used for the hardware CRC32C of the checksum footer, for decoding varints, and for unpacking integer sequences.
+#ifdef _MSC_VER
+#include <intrin.h>;
+#endif
+#if defined(_M_X64) || defined(__x86_64__)
+#define ODS_HARDWARE_CRC32C
+// Every x64 CPU has SSE2, so it is used without checking the CPU.
+#define ODS_SSE2
+#include <emmintrin.h>;
+#ifdef _MSC_VER
+#define ODS_TARGET_SSE42
+#else
+#include <cpuid.h>;
+#include <nmmintrin.h>;
+#define ODS_TARGET_SSE42 __attribute__((target("sse4.2")))
+#endif
+#endif
+
 // The ODS Namespace
 namespace ODS {
 
@@ -41,7 +87,37 @@ namespace ODS {
 	enum class CompressionType {
 		NONE,
 		GZIP,
-		ZLIB
+		ZLIB,
+		// A fast LZ77 codec that is part of ODS (see fastCompress()). It compresses less than ZLIB,
+		// but is many times faster in both directions. Made for files that are saved very often.
+		FAST,
+		// Deflate that stores blocks which do not compress (already compressed data, random floats) as they are,
+		// instead of spending time on them (see adaptiveCompress()).
+		ADAPTIVE
+	};
+
+	// How long to wait for a file to reach the disk when it is saved.
+	enum class SyncPolicy {
+		// Do not wait. (The fastest, but the file can be lost if the system crashes.)
+		NONE,
+		// Wait for the data of the file to reach the disk. (fdatasync)
+		DATA,
+		// Wait for the data, the metadata, and the directory entry of the file. (fsync on the file and its directory)
+		FULL
+	};
+
+	// The format that tags are written in.
+	enum class Format {
+		// The format of the Java version. Tags have a 4 byte length and a 2 byte name length.
+		STANDARD,
+		// Lengths and name lengths are varints, and the values of IntTags and LongTags are zigzag varints.
+		// Files start with a 5 byte header ("ODS", the version 2, and a byte of flags). This format is only
+		// understood by ODSPlus.
+		COMPACT,
+		// The compact format with a name dictionary: the names of the tags are written once in the file header, and
+		// every tag stores the index of its name instead of the name (see NameDictionary). This makes files of
+		// schema-regular data (like a VectorTag of ObjectTags with the same fields) smaller and faster to read.
+		NAMED
 	};
 
 	/**
@@ -93,1289 +169,7964 @@ namespace ODS {
 		return dest.u;
 	}
 
-	/**
-	====================================
-
-		Input / Output streams
-
-	====================================
-	*/
-	// BinaryOutputStream is a custom stream that allows you to write primative data types
-	// in the big endian format.
-	// There are two types of BinaryOutputStream: The memory only version, and the file version.
-	// The memory only version will not write to a file. Do enable memory only just construct the class
-	// with no parameters.
-	//
-	// The file mode does NOT open the file until the close() method is called. This is to allow for the automatic
-	// compression of the file. (TODO: It might be a good idea to stream files when there is no compression)
-	class BinaryOutputStream {
-	public:
-		BinaryOutputStream(std::string file_name, CompressionType type);
-		BinaryOutputStream(std::string file_name);
-		BinaryOutputStream();
-		~BinaryOutputStream();
-
-		void writeByte(byte b);
-		void writeByte(const byte* b, int size);
-
-		void writeShort(short s);
-		void writeInt(int i);
-		void writeLong(__int64 l);
-		void writeDouble(double d);
-		void writeFloat(float f);
-
-		// these methods exist to be redundant.
-		void writeInt16(__int16 i);
-		void writeInt32(__int32 i);
-
-		void writeString(std::string string);
-
-		void close();
-		// Get the array of bytes (This works in both memory and file mode.)
-		byte* getArray();
-		int length();
-
-	private:
-		std::vector<byte> bytes;
-		std::string name;
-		CompressionType compressionType;
-	};
-
-	BinaryOutputStream::BinaryOutputStream(std::string file_name, CompressionType type)
+	inline int countTrailingZeros(unsigned long long value)
 	{
-		name = file_name;
-		compressionType = type;
-		bytes = std::vector<byte>();
+#ifdef _MSC_VER
+		unsigned long index;
+		_BitScanForward64(&index, value);
+		return (int)index;
+#else
+		return __builtin_ctzll(value);
+#endif
 	}
 
-	BinaryOutputStream::BinaryOutputStream(std::string file_name)
+	// (value must not be 0.)
+	inline int countLeadingZeros(unsigned long long value)
 	{
-		name = file_name;
-		compressionType = CompressionType::NONE;
-		bytes = std::vector<byte>();
+#ifdef _MSC_VER
+		unsigned long index;
+		_BitScanReverse64(&index, value);
+		return 63 - (int)index;
+#else
+		return __builtin_clzll(value);
+#endif
 	}
 
-	BinaryOutputStream::BinaryOutputStream()
+	// Varints are LEB128: 7 bits per byte starting with the lowest bits, with the high bit set on every byte but the last.
+	// Signed values are zigzag encoded first so that small negative numbers are small as well.
+	inline unsigned long long zigzagEncode(long long value)
 	{
-		compressionType = CompressionType::NONE;
-		bytes = std::vector<byte>();
+		return ((unsigned long long)value << 1) ^ (unsigned long long)(value >> 63);
 	}
 
-	BinaryOutputStream::~BinaryOutputStream() {}
-
-	void BinaryOutputStream::writeByte(byte b)
+	inline long long zigzagDecode(unsigned long long value)
 	{
-		bytes.push_back(b);
+		return (long long)(value >> 1) ^ -(long long)(value & 1);
 	}
 
-	void BinaryOutputStream::writeByte(const byte* b, int size)
+	inline int varintSize(unsigned long long value)
 	{
-		bytes.insert(bytes.end(), b, b + size);
+		int size = 1;
+		while (value >= 0x80) {
+			value >>= 7;
+			size++;
+		}
+		return size;
 	}
 
-	// Inline since vs wants it to be.
-	inline void BinaryOutputStream::writeShort(short s)
+	// Write the varint to out (which must have room for 10 bytes). Returns the number of bytes written.
+	inline int encodeVarint(byte* out, unsigned long long value)
 	{
-		bytes.push_back(s >> 8);
-		bytes.push_back(s);
+		int size = 0;
+		while (value >= 0x80) {
+			out[size++] = (byte)(value | 0x80);
+			value >>= 7;
+		}
+		out[size++] = (byte)value;
+		return size;
 	}
 
-	inline void BinaryOutputStream::writeInt(int i)
-	{
-		bytes.push_back(i >> 24);
-		bytes.push_back(i >> 16);
-		bytes.push_back(i >> 8);
-		bytes.push_back(i);
+	// Decode the varint at data without reading more than available bytes.
+	// Returns the number of bytes in the varint, or 0 if it is malformed or does not fit inside of available.
+	//
+	// When 8 bytes are available, varints of up to 8 bytes (56 bits) are decoded from a single load without a loop:
+	// the first byte without a high bit marks the end, and the 7 bit groups are packed together with shifts.
+	inline int decodeVarint(const byte* data, long available, unsigned long long& value)
+	{
+		if (available >= 8) {
+			unsigned long long word;
+			memcpy(&word, data, 8);
+			unsigned long long stops = ~word & 0x8080808080808080ULL;
+			if (stops != 0) {
+				int size = (countTrailingZeros(stops) >> 3) + 1;
+				if (size < 8)
+					word &= (1ULL << (size * 8)) - 1;
+				word &= 0x7F7F7F7F7F7F7F7FULL;
+				word = ((word & 0x7F007F007F007F00ULL) >> 1) | (word & 0x007F007F007F007FULL);
+				word = ((word & 0x3FFF00003FFF0000ULL) >> 2) | (word & 0x00003FFF00003FFFULL);
+				word = ((word & 0x0FFFFFFF00000000ULL) >> 4) | (word & 0x000000000FFFFFFFULL);
+				value = word;
+				return size;
+			}
+		}
+		const unsigned char* b = reinterpret_cast<const unsigned char*>(data);
+		value = 0;
+		for (int i = 0; i < 10 && i < available; i++) {
+			value |= (unsigned long long)(b[i] & 0x7F) << (7 * i);
+			if ((b[i] & 0x80) == 0)
+				return i + 1;
+		}
+		return 0;
 	}
 
-	inline void BinaryOutputStream::writeLong(__int64 l)
+	// The file header of the compact format. (The standard format does not have a header.)
+	const byte compactHeader[] = { 'O', 'D', 'S', 2, 0 };
+	const int compactHeaderSize = 5;
+	// The flags in the last byte of the header.
+	// The header is followed by the name dictionary (Format::NAMED): a varint with its size and then the dictionary.
+	const byte headerFlagNames = 1;
+
+	// Parse the file header at data. Returns the size of the header (0 for the standard format, which does not have one),
+	// or -1 if the header is malformed or from a newer version.
+	// For Format::NAMED the name dictionary is the last dictionarySize bytes of the header. The dictionary itself is not
+	// read, so the header can be larger than available.
+	inline long parseFileHeader(const byte* data, long available, Format& format, long& dictionarySize)
 	{
-		__int64 lon = swap_endian<__int64>(l);
-		byte* b = reinterpret_cast<byte*>(&lon);
-		writeByte(b, 8);
-	}
+		dictionarySize = 0;
+		if (available < compactHeaderSize || memcmp(data, compactHeader, 3) != 0) {
+			format = Format::STANDARD;
+			return 0;
+		}
+		if (data[3] != compactHeader[3] || (data[4] & ~headerFlagNames) != 0)
+			return -1;
+		if ((data[4] & headerFlagNames) == 0) {
+			format = Format::COMPACT;
+			return compactHeaderSize;
+		}
+		unsigned long long size;
+		int sizeSize = decodeVarint(data + compactHeaderSize, available - compactHeaderSize, size);
+		if (sizeSize == 0 || size > 0x7FFFFFFF - compactHeaderSize - 10)
+			return -1;
+		format = Format::NAMED;
+		dictionarySize = (long)size;
+		return compactHeaderSize + sizeSize + dictionarySize;
+	}
+
+	// The header of a tag. The positions are relative to the start of the tag.
+	struct TagHeader {
+		byte id;
+		// The position right after the length. (The length counts everything after it.)
+		long lengthEnd;
+		// The number of bytes in the name. (In Format::NAMED the name is the varint nameIndex.)
+		short nameLength;
+		// (0, the empty name, in the other formats.)
+		unsigned long long nameIndex;
+		// The position right after the name.
+		long valueStart;
+		// The position right after the tag.
+		long end;
+	};
 
-	inline void BinaryOutputStream::writeDouble(double d)
+	// Parse the header of the tag at data, reading no more than available bytes.
+	// Returns false if the header is malformed or the tag does not fit inside of available.
+	inline bool parseTagHeader(const byte* data, long available, Format format, TagHeader& header)
+	{
+		unsigned long long length;
+		unsigned long long nameLength;
+		long nameStart;
+		header.nameIndex = 0;
+		if (format != Format::STANDARD) {
+			if (available < 3)
+				return false;
+			int lengthSize = decodeVarint(data + 1, available - 1, length);
+			if (lengthSize == 0)
+				return false;
+			header.lengthEnd = 1 + lengthSize;
+			int nameSize = decodeVarint(data + header.lengthEnd, available - header.lengthEnd, nameLength);
+			if (nameSize == 0)
+				return false;
+			nameStart = header.lengthEnd + nameSize;
+			if (format == Format::NAMED) {
+				header.nameIndex = nameLength;
+				nameLength = nameSize;
+				nameStart = header.lengthEnd;
+			}
+		}
+		else {
+			if (available < 7)
+				return false;
+			const unsigned char* b = reinterpret_cast<const unsigned char*>(data);
+			length = ((unsigned int)b[1] << 24) | ((unsigned int)b[2] << 16) | ((unsigned int)b[3] << 8) | (unsigned int)b[4];
+			nameLength = ((unsigned int)b[5] << 8) | (unsigned int)b[6];
+			header.lengthEnd = 5;
+			nameStart = 7;
+		}
+		// (Negative lengths are larger than any available size once they are unsigned.)
+		if (nameLength > 0x7FFF || length > (unsigned long long)(available - header.lengthEnd)
+			|| (unsigned long long)(nameStart - header.lengthEnd) + nameLength > length)
+			return false;
+		header.id = data[0];
+		header.nameLength = (short)nameLength;
+		header.valueStart = nameStart + (long)nameLength;
+		header.end = header.lengthEnd + (long)length;
+		return true;
+	}
+
+	// The NameTable interns tag names so every tag with the same name shares a single copy of the string,
+	// and every distinct name has a small id. Tags store a TagName (which points into this table) instead of their
+	// own std::string.
+	//
+	// There is one process wide table (see NameTable::global()). Names that come from the API (tag constructors,
+	// setName(), and TagName(std::string)) are pinned, and stay in the table for good. Names that are read from files
+	// are counted instead (see TagName::transient()), and are removed once the last TagName of them is gone, so
+	// reading files never grows the table for good. The id of a removed name can be given to a new name.
+	// The table is safe to use from multiple threads.
+	class NameTable {
+	public:
+		// A name in the table. (TagNames point at it.)
+		struct Entry {
+			std::string text;
+			unsigned int id;
+			// Pinned entries are never removed, and their TagNames are not counted.
+			std::atomic<bool> pinned;
+			// The number of TagNames of an entry that is not pinned.
+			std::atomic<unsigned int> refs;
+		};
+
+		static NameTable& global();
+
+		// Find or add the name, and count a reference to it if it is not pinned.
+		// A name that is interned pinned is pinned from then on, even if it was added as a transient name.
+		Entry* intern(std::string_view name, bool pinned);
+		void acquire(Entry* entry);
+		// Drop a reference to an entry, and remove it if it was the last one.
+		void release(Entry* entry);
+		size_t size();
+
+	private:
+		NameTable();
+		~NameTable();
+
+		// The keys point into the text of the entries.
+		std::unordered_map<std::string_view, Entry*> entries;
+		// The ids of removed entries, which are used again before any new id.
+		std::vector<unsigned int> freeIds;
+		unsigned int nextId;
+		std::shared_mutex mutex;
+	};
+
+	inline NameTable::NameTable()
 	{
-		double bigD = swap_endian<double>(d);
-		byte* b = reinterpret_cast<byte*>(&bigD);
-		writeByte(b, 8);
+		nextId = 0;
+		// Id 0 is always the empty name.
+		intern("", true);
 	}
 
-	inline void BinaryOutputStream::writeFloat(float f)
+	inline NameTable::~NameTable()
 	{
-		float bigF = swap_endian<float>(f);
-		byte* b = reinterpret_cast<byte*>(&bigF);
-		writeByte(b, 4);
+		for (auto& entry : entries)
+			delete entry.second;
 	}
 
-	inline void BinaryOutputStream::writeInt16(__int16 i)
+	inline NameTable& NameTable::global()
 	{
-		__int16 lon = swap_endian<__int16>(i);
-		byte* b = reinterpret_cast<byte*>(&lon);
-		writeByte(b, 2);
+		static NameTable table;
+		return table;
 	}
 
-	inline void BinaryOutputStream::writeInt32(__int32 i)
+	inline NameTable::Entry* NameTable::intern(std::string_view name, bool pinned)
 	{
-		__int32 lon = swap_endian<__int32>(i);
-		byte* b = reinterpret_cast<byte*>(&lon);
-		writeByte(b, 4);
+		{
+			std::shared_lock<std::shared_mutex> lock(mutex);
+			auto it = entries.find(name);
+			if (it != entries.end() && (!pinned || it->second->pinned)) {
+				// (Entries are only removed with the lock held exclusively, so the count cannot be 0 here.)
+				acquire(it->second);
+				return it->second;
+			}
+		}
+		std::unique_lock<std::shared_mutex> lock(mutex);
+		auto it = entries.find(name);
+		if (it != entries.end()) {
+			if (pinned)
+				it->second->pinned = true;
+			acquire(it->second);
+			return it->second;
+		}
+		Entry* entry = new Entry();
+		entry->text = std::string(name);
+		if (freeIds.empty()) {
+			entry->id = nextId++;
+		}
+		else {
+			entry->id = freeIds.back();
+			freeIds.pop_back();
+		}
+		entry->pinned = pinned;
+		entry->refs = pinned ? 0 : 1;
+		entries.emplace(std::string_view(entry->text), entry);
+		return entry;
 	}
 
-	inline void BinaryOutputStream::writeString(std::string string)
+	inline void NameTable::acquire(Entry* entry)
 	{
-		writeByte(string.c_str(), string.length());
+		if (!entry->pinned.load(std::memory_order_relaxed))
+			entry->refs.fetch_add(1, std::memory_order_relaxed);
 	}
 
-	// Write the data from memory into the file.
-	// (There is no technical reason to do this when in memory mode; however, it is still
-	// good practice to do so.)
-	inline void BinaryOutputStream::close()
+	inline void NameTable::release(Entry* entry)
 	{
-		if (name.empty()) {
+		if (entry->pinned.load(std::memory_order_relaxed))
 			return;
-		}
-		if (compressionType == CompressionType::NONE) {
-			std::ofstream stream(name, std::ios::out | std::ios::binary | std::ios::ate);
-			std::ostream_iterator<byte> output_iterator(stream);
-			std::copy(bytes.begin(), bytes.end(), output_iterator);
-			stream.close();
-		}
-		else if (compressionType == CompressionType::ZLIB) {
-			uLong cmp_len = compressBound(bytes.size());
-			mz_uint8* pCmp;
-			pCmp = (mz_uint8*)malloc((size_t)cmp_len);
-			int cmp_status = compress(pCmp, &cmp_len, (const unsigned char*)getArray(), length());
-			if (cmp_status != Z_OK)
-			{
-				free(pCmp);
-				throw ODSException("Compression Failed");
+		// Dropping a reference that is not the last one does not lock. The last one is dropped with the lock held,
+		// so intern() cannot find the entry while it is being removed.
+		unsigned int refs = entry->refs.load(std::memory_order_relaxed);
+		while (refs > 1) {
+			if (entry->refs.compare_exchange_weak(refs, refs - 1, std::memory_order_acq_rel))
 				return;
-			}
-			std::ofstream stream(name, std::ios::out | std::ios::binary | std::ios::ate);
-			stream.write((const char*) pCmp, cmp_len);
-			free(pCmp);
 		}
+		std::unique_lock<std::shared_mutex> lock(mutex);
+		if (entry->refs.fetch_sub(1, std::memory_order_acq_rel) != 1 || entry->pinned)
+			return;
+		entries.erase(std::string_view(entry->text));
+		freeIds.push_back(entry->id);
+		delete entry;
 	}
 
-	inline byte* BinaryOutputStream::getArray()
-	{
-		return &bytes[0];
-	}
-
-	inline int BinaryOutputStream::length()
+	inline size_t NameTable::size()
 	{
-		return bytes.size();
+		std::shared_lock<std::shared_mutex> lock(mutex);
+		return entries.size();
 	}
 
-	/*
-		This is the input stream for binary files.
-	*/
-	// This class handles the reading of binary data from files and memory.
-	// Similar to the BinaryOutputStream it translates big endian primative to
-	// little endian automatically.
-	//
-	// To create the BinaryInputStream in memory only mode please construct the class
-	// with with your array of bytes. (You can decompress data. [TODO])
-	//
-	// Technical Note: The entire file is loaded into memory at the beging to deal with compression.
-	// (TODO: Maybe stream the file if there is not compression.)
-	class BinaryInputStream {
+	// A handle to a tag name: a pointer to its entry in the NameTable. str() never locks the NameTable, and names are
+	// compared and hashed by their entry, so it is O(1) no matter how long the names are.
+	class TagName {
 	public:
-		BinaryInputStream(std::string file_name, CompressionType type = CompressionType::NONE);
-		BinaryInputStream(byte data[], CompressionType type = CompressionType::NONE);
-		//BinaryInputStream(byte* data, CompressionType type = CompressionType::NONE);
-		~BinaryInputStream();
-
-		byte readByte();
-		void readBytes(byte* b, int size);
-		void readBytes(byte b[]);
-		template<size_t size> void readBytes(std::array<byte, size> s);
+		TagName();
+		explicit TagName(const std::string& name);
+		explicit TagName(const char* name);
+		TagName(const TagName& other);
+		TagName(TagName&& other) noexcept;
+		TagName& operator=(const TagName& other);
+		TagName& operator=(TagName&& other) noexcept;
+		~TagName();
+
+		// A name that is removed from the NameTable again once every TagName of it is gone. (Used for names read from files.)
+		static TagName transient(std::string_view name);
+
+		const std::string& str() const;
+		// The id of the name in the NameTable. (Ids are unique among the names that are alive.)
+		unsigned int index() const;
+		bool empty() const;
+
+		bool operator==(const TagName& other) const { return entry == other.entry; }
+		bool operator!=(const TagName& other) const { return entry != other.entry; }
 
-		short readShort();
-		int readInt();
-		__int64 readLong();
-		double readDouble();
-		float readFloat();
-
-		__int16 readInt16();
-		__int32 readInt32();
+	private:
+		explicit TagName(NameTable::Entry* entry);
+		static NameTable::Entry* emptyEntry();
 
-		std::string readString(int size);
+		NameTable::Entry* entry;
+	};
 
-		void close();
+	inline NameTable::Entry* TagName::emptyEntry()
+	{
+		static NameTable::Entry* empty = NameTable::global().intern("", true);
+		return empty;
+	}
 
-	private:
-		byte* bytes;
-		std::string name;
-		CompressionType compressionType;
-		long currentIndex;
-		long fileSize;
-	};
+	inline TagName::TagName()
+	{
+		entry = emptyEntry();
+	}
 
-	inline BinaryInputStream::BinaryInputStream(std::string file_name, CompressionType type)
+	inline TagName::TagName(NameTable::Entry* entry)
 	{
-		name = file_name;
-		compressionType = type;
-		currentIndex = 0;
-		if (compressionType == CompressionType::NONE) {
-			std::ifstream stream(name, std::ios::in | std::ios::binary | std::ios::ate);
-			if (stream.is_open()) {
-				stream.seekg(0, stream.end);
-				fileSize = stream.tellg();
-				stream.seekg(0, stream.beg);
-				bytes = new byte[fileSize];
-				stream.read(bytes, fileSize);
-			}
-			else {
-				throw ODS::ODSException("File stream not open! Does that file exist?");
-			}
-			stream.close();
-		}
+		this->entry = entry;
 	}
 
-	inline BinaryInputStream::BinaryInputStream(byte data[], CompressionType type)
+	inline TagName::TagName(const std::string& name)
 	{
-		// TODO DECOMPRESS DATA
-		name = "";
-		compressionType = type;
-		currentIndex = 0;
-		this->bytes = data;
+		entry = NameTable::global().intern(name, true);
 	}
 
-	/*inline BinaryInputStream::BinaryInputStream(byte* data, CompressionType type)
+	inline TagName::TagName(const char* name) : TagName(std::string(name))
 	{
-		// TODO DECOMPRESS DATA
-		name = "";
-		compressionType = type;
-		currentIndex = 0;
-		this->bytes = data;
-	}*/
+	}
 
-	inline BinaryInputStream::~BinaryInputStream()
+	inline TagName::TagName(const TagName& other)
 	{
-		//delete[] bytes;
+		entry = other.entry;
+		NameTable::global().acquire(entry);
 	}
 
-	inline byte BinaryInputStream::readByte()
+	inline TagName::TagName(TagName&& other) noexcept
 	{
-		return bytes[currentIndex++];
+		entry = other.entry;
+		other.entry = emptyEntry();
 	}
 
-	inline void BinaryInputStream::readBytes(byte* b, int size)
+	inline TagName& TagName::operator=(const TagName& other)
 	{
-		for (int i = 0; i < size; i++) {
-			b[i] = bytes[currentIndex];
-			currentIndex++;
+		if (entry != other.entry) {
+			NameTable::global().acquire(other.entry);
+			NameTable::global().release(entry);
+			entry = other.entry;
 		}
+		return *this;
 	}
 
-	inline void BinaryInputStream::readBytes(byte b[])
+	inline TagName& TagName::operator=(TagName&& other) noexcept
 	{
-		for (int i = 0; i < sizeof(b); i++) {
-			b[i] = bytes[currentIndex];
-			currentIndex++;
-		}
+		std::swap(entry, other.entry);
+		return *this;
 	}
 
-	template<size_t size>
-	inline void ODS::BinaryInputStream::readBytes(std::array<byte, size> s)
+	inline TagName::~TagName()
 	{
-		memcpy(s, bytes + currentIndex, size);
-		currentIndex += size;
+		NameTable::global().release(entry);
 	}
 
-	inline short BinaryInputStream::readShort()
+	inline TagName TagName::transient(std::string_view name)
 	{
-		byte* tempData = new byte[2];
-		readBytes(tempData, 2);
-		return swap_endian((short)((tempData[1] << 8) | tempData[0]));
+		return TagName(NameTable::global().intern(name, false));
 	}
 
-	inline int BinaryInputStream::readInt()
+	inline const std::string& TagName::str() const
 	{
-		byte* tempData = new byte[4];
-		readBytes(tempData, 4);
-		return swap_endian((int)(tempData[3] << 24) | (tempData[2] << 16) | (tempData[1] << 8) | (tempData[0]));
+		return entry->text;
 	}
 
-	inline __int64 BinaryInputStream::readLong()
+	inline unsigned int TagName::index() const
 	{
-		byte* tempData = new byte[8];
-		readBytes(tempData, 8);
-		__int64* d = reinterpret_cast<__int64*>(tempData);
-		return swap_endian(*d);
+		return entry->id;
 	}
 
-	inline double BinaryInputStream::readDouble()
+	inline bool TagName::empty() const
 	{
-		byte* tempData = new byte[8];
-		readBytes(tempData, 8);
-		double* d = reinterpret_cast<double*>(tempData);
-		return swap_endian(*d);
+		return entry->text.empty();
 	}
 
-	inline float BinaryInputStream::readFloat()
+	// Hash for TagName (std::hash is also specialized below).
+	struct TagNameHash {
+		size_t operator()(const TagName& name) const { return std::hash<unsigned int>()(name.index()); }
+	};
+}
+
+template<> struct std::hash<ODS::TagName> {
+	size_t operator()(const ODS::TagName& name) const { return ODS::TagNameHash()(name); }
+};
+
+namespace ODS {
+
+	// The name dictionary of a file in Format::NAMED. The names of the tags are written once in the file header,
+	// and every tag stores the index of its name in the dictionary.
+	// Index 0 is always the empty name (the name of the tags in a VectorTag), so it is not written.
+	// The names of a dictionary that is read from a file are transient (see TagName::transient()).
+	class NameDictionary {
+	public:
+		NameDictionary();
+
+		// The index of the name. Names that are not in the dictionary are added to the end of it.
+		unsigned int add(TagName name);
+		unsigned int add(std::string_view name);
+		// Throws an ODSException if the index is not in the dictionary.
+		TagName get(unsigned long long index) const;
+		size_t size() const;
+
+		// Write the dictionary: a varint with the number of names (after the empty name), then each name with a varint length.
+		void write(std::vector<byte>& out) const;
+		// Check a dictionary that is exactly size bytes without reading the names. Returns false if it is malformed.
+		static bool check(const byte* data, long size, unsigned long long& count);
+		// Read a dictionary that is exactly size bytes. Returns NULL if it is malformed.
+		static std::shared_ptr<NameDictionary> read(const byte* data, long size);
+
+	private:
+		std::vector<TagName> names;
+		// The dictionary index of every name by its NameTable id (-1 if it is not in the dictionary).
+		// (The names hold on to their ids, so an id cannot be given to another name while it is in here.)
+		std::vector<int> indices;
+	};
+
+	inline NameDictionary::NameDictionary()
 	{
-		byte* tempData = new byte[4];
-		readBytes(tempData, 4);
-		float* d = reinterpret_cast<float*>(tempData);
-		return swap_endian(*d);
+		add(TagName());
 	}
 
-	inline __int16 BinaryInputStream::readInt16()
+	inline unsigned int NameDictionary::add(TagName name)
 	{
-		byte* tempData = new byte[2];
-		readBytes(tempData, 2);
-		__int16* d = reinterpret_cast<__int16*>(tempData);
-		return swap_endian(*d);
+		unsigned int id = name.index();
+		if (id < indices.size() && indices[id] >= 0)
+			return (unsigned int)indices[id];
+		if (id >= indices.size())
+			indices.resize(id + 1, -1);
+		unsigned int index = (unsigned int)names.size();
+		names.push_back(name);
+		indices[id] = (int)index;
+		return index;
 	}
 
-	inline __int32 BinaryInputStream::readInt32()
+	inline unsigned int NameDictionary::add(std::string_view name)
 	{
-		byte* tempData = new byte[4];
-		readBytes(tempData, 2);
-		__int32* d = reinterpret_cast<__int32*>(tempData);
-		return swap_endian(*d);
+		return add(TagName::transient(name));
 	}
 
-	inline std::string BinaryInputStream::readString(int size)
+	inline TagName NameDictionary::get(unsigned long long index) const
 	{
-		byte* tempData = new byte[size + 1];
-		readBytes(tempData, size);
-		tempData[size] = '\0';
-		return std::string(tempData);
+		if (index >= names.size())
+			throw ODSException("Error: A tag name is not in the name dictionary!");
+		return names[(size_t)index];
 	}
 
-	inline void BinaryInputStream::close()
+	inline size_t NameDictionary::size() const
 	{
-		delete[] bytes;
+		return names.size();
 	}
 
-	/**
+	inline void NameDictionary::write(std::vector<byte>& out) const
+	{
+		byte varint[10];
+		out.insert(out.end(), varint, varint + encodeVarint(varint, names.size() - 1));
+		for (size_t i = 1; i < names.size(); i++) {
+			const std::string& name = names[i].str();
+			out.insert(out.end(), varint, varint + encodeVarint(varint, name.length()));
+			out.insert(out.end(), name.begin(), name.end());
+		}
+	}
+
+	inline bool NameDictionary::check(const byte* data, long size, unsigned long long& count)
+	{
+		int countSize = decodeVarint(data, size, count);
+		if (countSize == 0)
+			return false;
+		long position = countSize;
+		for (unsigned long long i = 0; i < count; i++) {
+			unsigned long long length;
+			int lengthSize = decodeVarint(data + position, size - position, length);
+			if (lengthSize == 0 || length > 0x7FFF || length > (unsigned long long)(size - position - lengthSize))
+				return false;
+			position += lengthSize + (long)length;
+		}
+		return position == size;
+	}
+
+	inline std::shared_ptr<NameDictionary> NameDictionary::read(const byte* data, long size)
+	{
+		unsigned long long count;
+		if (!check(data, size, count))
+			return NULL;
+		std::shared_ptr<NameDictionary> dictionary = std::make_shared<NameDictionary>();
+		dictionary->names.reserve((size_t)count + 1);
+		long position = varintSize(count);
+		for (unsigned long long i = 0; i < count; i++) {
+			unsigned long long length;
+			position += decodeVarint(data + position, size - position, length);
+			TagName name = TagName::transient(std::string_view(data + position, (size_t)length));
+			position += (long)length;
+			// (The indices of a name written twice still point to the first copy.)
+			dictionary->add(name);
+			if (dictionary->names.size() != i + 2)
+				dictionary->names.push_back(name);
+		}
+		return dictionary;
+	}
+
+	/**
 	====================================
-		ODS TAGS
-		These are the tags of ODS.
+
+		Compression
+
 	====================================
 	*/
-	// An ITag is used so that way you can have a vector of tags without knowing the primative type.
-	// Example: std::vector<ITag*> vec();
+	// The FAST codec stores data as frames: the 4 byte magic, then blocks of up to fastBlockSize bytes, and then
+	// a 4 byte 0. Every block starts with its uncompressed size and its stored size (4 bytes each, little endian).
+	// If the top bit of the stored size is set the block is stored as is, otherwise it is compressed.
 	//
-	// DO NOT construct this class as it is an abstract class. This class is only to be used to refrence and unknown tag type
-	// or to be extended.
+	// A compressed block is a list of sequences in the LZ4 block format: a token (the number of literals in the
+	// high 4 bits, the match length minus 4 in the low 4 bits, where 15 means more bytes of the length follow
+	// and every 255 byte adds 255), the literals, the 2 byte offset of the match (little endian), and then the rest
+	// of the match length. The last sequence only has literals. Matches are found with a single hash table lookup,
+	// so compression is fast, and decompression is only copies.
+	const byte fastMagic[] = { 'O', 'L', 'Z', 1 };
+	const size_t fastBlockSize = 1 << 20;
+	const int fastHashBits = 14;
+
+	inline unsigned int fastRead32(const byte* data)
+	{
+		unsigned int value;
+		memcpy(&value, data, 4);
+		return value;
+	}
+
+	inline unsigned int fastHash(const byte* data)
+	{
+		return (fastRead32(data) * 2654435761u) >> (32 - fastHashBits);
+	}
+
+	// The most bytes that a block of size bytes can compress to.
+	inline size_t fastCompressBound(size_t size)
+	{
+		return size + size / 255 + 16;
+	}
+
+	// Write the part of a length that does not fit in its 4 bits of the token.
+	inline byte* fastWriteLength(byte* out, size_t length)
+	{
+		for (; length >= 255; length -= 255)
+			*out++ = (byte)255;
+		*out++ = (byte)length;
+		return out;
+	}
+
+	// Compress one block into out, which must have room for fastCompressBound(size) bytes.
+	// table must have 1 << fastHashBits entries. Returns the compressed size.
+	inline size_t fastCompressBlock(const byte* data, size_t size, byte* out, unsigned int* table)
+	{
+		// The last match must start 12 bytes before the end, and the last 5 bytes are always literals.
+		const size_t matchStartLimit = size > 12 ? size - 12 : 0;
+		const size_t matchEndLimit = size > 5 ? size - 5 : 0;
+		byte* op = out;
+		size_t anchor = 0;
+		size_t ip = 1;
+		std::fill(table, table + (1 << fastHashBits), 0);
+		while (size > 12 && ip <= matchStartLimit) {
+			// Find a match. The step grows on data that does not match, so incompressible data is skipped quickly.
+			size_t match = 0;
+			bool found = false;
+			for (unsigned int attempts = 1 << 6; ip <= matchStartLimit; attempts++) {
+				unsigned int& entry = table[fastHash(data + ip)];
+				match = entry;
+				entry = (unsigned int)ip;
+				if (ip - match <= 0xFFFF && fastRead32(data + match) == fastRead32(data + ip)) {
+					found = true;
+					break;
+				}
+				ip += attempts >> 6;
+			}
+			if (!found)
+				break;
+			while (ip > anchor && match > 0 && data[ip - 1] == data[match - 1]) {
+				ip--;
+				match--;
+			}
+			// Extend the match 8 bytes at a time, the first different byte is the lowest set byte of the XOR.
+			size_t length = 4;
+			while (ip + length < matchEndLimit) {
+				if (ip + length + 8 <= matchEndLimit) {
+					unsigned long long a, b;
+					memcpy(&a, data + ip + length, 8);
+					memcpy(&b, data + match + length, 8);
+					if (a != b) {
+						length += countTrailingZeros(a ^ b) >> 3;
+						break;
+					}
+					length += 8;
+				}
+				else if (data[ip + length] == data[match + length]) {
+					length++;
+				}
+				else {
+					break;
+				}
+			}
+			size_t literals = ip - anchor;
+			byte* token = op++;
+			*token = (byte)((literals >= 15 ? 15 : literals) << 4);
+			if (literals >= 15)
+				op = fastWriteLength(op, literals - 15);
+			memcpy(op, data + anchor, literals);
+			op += literals;
+			size_t offset = ip - match;
+			*op++ = (byte)offset;
+			*op++ = (byte)(offset >> 8);
+			*token |= (byte)(length - 4 >= 15 ? 15 : length - 4);
+			if (length - 4 >= 15)
+				op = fastWriteLength(op, length - 4 - 15);
+			ip += length;
+			anchor = ip;
+			if (ip - 2 <= matchStartLimit)
+				table[fastHash(data + ip - 2)] = (unsigned int)(ip - 2);
+		}
+		size_t literals = size - anchor;
+		*op++ = (byte)((literals >= 15 ? 15 : literals) << 4);
+		if (literals >= 15)
+			op = fastWriteLength(op, literals - 15);
+		memcpy(op, data + anchor, literals);
+		op += literals;
+		return op - out;
+	}
+
+	// Decompress one block into out, which must be exactly outSize bytes. Returns false if the block is corrupt.
+	// Every length and offset is checked, so corrupt data can never read or write outside of the buffers.
+	inline bool fastDecompressBlock(const byte* data, size_t size, byte* out, size_t outSize)
+	{
+		const unsigned char* ip = reinterpret_cast<const unsigned char*>(data);
+		const unsigned char* inEnd = ip + size;
+		byte* op = out;
+		byte* outEnd = out + outSize;
+		auto readLength = [&](size_t& length) {
+			unsigned char b;
+			do {
+				if (ip == inEnd)
+					return false;
+				b = *ip++;
+				length += b;
+			} while (b == 255);
+			return true;
+		};
+		while (true) {
+			if (ip == inEnd)
+				return false;
+			unsigned char token = *ip++;
+			size_t literals = token >> 4;
+			if (literals == 15 && !readLength(literals))
+				return false;
+			if (literals > (size_t)(inEnd - ip) || literals > (size_t)(outEnd - op))
+				return false;
+			// Copy 16 bytes at a time when there is room after the literals in both buffers.
+			if (literals <= 16 && inEnd - ip >= 16 && outEnd - op >= 16)
+				memcpy(op, ip, 16);
+			else
+				memcpy(op, ip, literals);
+			ip += literals;
+			op += literals;
+			if (ip == inEnd)
+				return op == outEnd;
+			if (inEnd - ip < 2)
+				return false;
+			size_t offset = ip[0] | ((size_t)ip[1] << 8);
+			ip += 2;
+			size_t length = token & 15;
+			if (length == 15 && !readLength(length))
+				return false;
+			length += 4;
+			if (offset == 0 || offset > (size_t)(op - out) || length > (size_t)(outEnd - op))
+				return false;
+			const byte* match = op - offset;
+			if (offset >= 16 && length <= 32 && outEnd - op >= 32) {
+				memcpy(op, match, 16);
+				memcpy(op + 16, match + 16, 16);
+				op += length;
+				continue;
+			}
+			// The copied bytes double every time, so short offsets (runs of the same bytes) are copied quickly.
+			while (length > 0) {
+				size_t copy = std::min(length, (size_t)(op - match));
+				memcpy(op, match, copy);
+				op += copy;
+				length -= copy;
+			}
+		}
+	}
+
+	// Write data as one frame (the layout of the FAST codec above, with the given magic) onto the end of out.
+	// compressBlock(data, size, out, capacity) compresses a block into out, which has room for bound(size) bytes,
+	// and returns the compressed size. Blocks that do not get smaller are stored as they are.
+	template <class Compress>
+	inline void writeFrame(const byte* magic, size_t blockSize, size_t (*bound)(size_t), const byte* data, size_t size, std::vector<byte>& out, Compress compressBlock)
+	{
+		out.insert(out.end(), magic, magic + 4);
+		auto write32 = [&out](size_t position, unsigned int value) {
+			for (int i = 0; i < 4; i++)
+				out[position + i] = (byte)(value >> (8 * i));
+		};
+		for (size_t offset = 0; offset < size; offset += blockSize) {
+			size_t length = std::min(blockSize, size - offset);
+			size_t header = out.size();
+			size_t capacity = bound(length);
+			out.resize(header + 8 + std::max(capacity, length));
+			size_t stored = compressBlock(data + offset, length, out.data() + header + 8, capacity);
+			unsigned int flags = 0;
+			if (stored >= length) {
+				memcpy(out.data() + header + 8, data + offset, length);
+				stored = length;
+				flags = 0x80000000;
+			}
+			write32(header, (unsigned int)length);
+			write32(header + 4, (unsigned int)stored | flags);
+			out.resize(header + 8 + stored);
+		}
+		out.resize(out.size() + 4, 0);
+	}
+
+	// Read one frame written by writeFrame() onto the end of out. Returns the number of input bytes the frame used.
+	// decompressBlock(data, size, out, outSize) decompresses a block and returns false if it is corrupt.
+	template <class Decompress>
+	inline size_t readFrame(const byte* magic, size_t blockSize, const byte* data, size_t size, std::vector<byte>& out, Decompress decompressBlock)
+	{
+		const unsigned char* in = reinterpret_cast<const unsigned char*>(data);
+		auto read32 = [in](size_t position) {
+			return (unsigned int)in[position] | ((unsigned int)in[position + 1] << 8) | ((unsigned int)in[position + 2] << 16) | ((unsigned int)in[position + 3] << 24);
+		};
+		if (size < 8 || memcmp(data, magic, 4) != 0)
+			throw ODSException("Decompression Failed: Invalid frame header.");
+		size_t position = 4;
+		while (true) {
+			if (size - position < 4)
+				throw ODSException("Decompression Failed: The frame is cut off.");
+			unsigned int length = read32(position);
+			if (length == 0)
+				return position + 4;
+			if (size - position < 8)
+				throw ODSException("Decompression Failed: The frame is cut off.");
+			unsigned int stored = read32(position + 4);
+			bool raw = (stored & 0x80000000) != 0;
+			stored &= 0x7FFFFFFF;
+			position += 8;
+			if (length > blockSize || stored > size - position || (raw && stored != length))
+				throw ODSException("Decompression Failed: A block of the frame is corrupt.");
+			size_t start = out.size();
+			out.resize(start + length);
+			if (raw)
+				memcpy(out.data() + start, data + position, length);
+			else if (!decompressBlock(data + position, stored, out.data() + start, length))
+				throw ODSException("Decompression Failed: A block of the frame is corrupt.");
+			position += stored;
+		}
+	}
+
+	// Compress data as one FAST frame onto the end of out. table must have 1 << fastHashBits entries.
+	inline void fastCompress(const byte* data, size_t size, std::vector<byte>& out, unsigned int* table)
+	{
+		writeFrame(fastMagic, fastBlockSize, fastCompressBound, data, size, out, [table](const byte* block, size_t length, byte* to, size_t) {
+			return fastCompressBlock(block, length, to, table);
+		});
+	}
+
+	// Decompress one FAST frame onto the end of out. Returns the number of input bytes the frame used.
+	inline size_t fastDecompress(const byte* data, size_t size, std::vector<byte>& out)
+	{
+		return readFrame(fastMagic, fastBlockSize, data, size, out, fastDecompressBlock);
+	}
+
+	// The ADAPTIVE codec uses the frames of the FAST codec with smaller blocks, and every block is either
+	// raw deflate or stored as is. A block is stored as is if deflate does not save at least the compression
+	// threshold (a fraction of the block, 5% by default). Blocks whose bytes look random are stored without
+	// trying deflate at all, and deflate stops as soon as its output is too big to save enough, so parts of
+	// a file that do not compress cost little more than a copy.
+	const byte adaptiveMagic[] = { 'O', 'A', 'D', 1 };
+	const size_t adaptiveBlockSize = 1 << 16;
+	const double defaultCompressionThreshold = 0.05;
+
+	// Whether order 0 entropy coding of data (the least that deflate can do without matches) would save
+	// less than threshold of it. This is estimated from the counts of every byte, which is much faster than deflate.
+	// (Data that only repeats after more than a block, like a copy of a compressed blob, is not found by this.)
+	inline bool looksIncompressible(const byte* data, size_t size, double threshold)
+	{
+		// Four sets of counts, so updates to the same count do not wait on each other.
+		unsigned int counts[4][256] = {};
+		const unsigned char* in = reinterpret_cast<const unsigned char*>(data);
+		size_t i = 0;
+		for (; i + 4 <= size; i += 4) {
+			counts[0][in[i]]++;
+			counts[1][in[i + 1]]++;
+			counts[2][in[i + 2]]++;
+			counts[3][in[i + 3]]++;
+		}
+		for (; i < size; i++)
+			counts[0][in[i]]++;
+		double bits = 0;
+		for (int b = 0; b < 256; b++) {
+			unsigned int count = counts[0][b] + counts[1][b] + counts[2][b] + counts[3][b];
+			if (count != 0)
+				bits -= count * std::log2((double)count / size);
+		}
+		return bits / 8 > size * (1 - threshold);
+	}
+
+	// Compress data as one ADAPTIVE frame onto the end of out with compressor. A block is only stored compressed if that
+	// saves at least threshold of it (0 stores every block that gets smaller at all). level is the deflate level.
+	inline void adaptiveCompress(const byte* data, size_t size, std::vector<byte>& out, double threshold, int level, tdefl_compressor* compressor)
+	{
+		int flags = tdefl_create_comp_flags_from_zip_params(level, -MZ_DEFAULT_WINDOW_BITS, MZ_DEFAULT_STRATEGY);
+		// Blocks are never stored bigger than they are.
+		auto bound = [](size_t length) { return length; };
+		writeFrame(adaptiveMagic, adaptiveBlockSize, bound, data, size, out, [&](const byte* block, size_t length, byte* to, size_t) {
+			// The most the block can be compressed to and still be worth it.
+			size_t capacity = length - (size_t)std::ceil(length * threshold);
+			if (capacity == 0 || looksIncompressible(block, length, threshold))
+				return length;
+			tdefl_init(compressor, NULL, NULL, flags);
+			size_t inSize = length;
+			size_t outSize = capacity;
+			// Without room for all of the output deflate stops early, and the block is stored as is.
+			if (tdefl_compress(compressor, block, &inSize, to, &outSize, TDEFL_FINISH) != TDEFL_STATUS_DONE || outSize >= capacity)
+				return length;
+			return outSize;
+		});
+	}
+
+	// Decompress one ADAPTIVE frame onto the end of out with decomp. Returns the number of input bytes the frame used.
+	inline size_t adaptiveDecompress(const byte* data, size_t size, std::vector<byte>& out, tinfl_decompressor& decomp)
+	{
+		return readFrame(adaptiveMagic, adaptiveBlockSize, data, size, out, [&decomp](const byte* block, size_t length, byte* to, size_t outSize) {
+			tinfl_init(&decomp);
+			size_t written = outSize;
+			tinfl_status status = tinfl_decompress(&decomp, (const mz_uint8*)block, &length, (mz_uint8*)to, (mz_uint8*)to, &written, TINFL_FLAG_USING_NON_WRAPPING_OUTPUT_BUF);
+			return status == TINFL_STATUS_DONE && written == outSize;
+		});
+	}
+
+	// Find the type of compressed data from its first bytes. Returns false if it does not start like any of them.
+	// (ZLIB streams start with a deflate method and a header checksum, the rest start with a magic number.)
+	inline bool detectCompression(const byte* data, size_t size, CompressionType& type)
+	{
+		const unsigned char* in = reinterpret_cast<const unsigned char*>(data);
+		if (size >= 4 && memcmp(data, fastMagic, 4) == 0)
+			type = CompressionType::FAST;
+		else if (size >= 4 && memcmp(data, adaptiveMagic, 4) == 0)
+			type = CompressionType::ADAPTIVE;
+		else if (size >= 2 && in[0] == 0x1f && in[1] == 0x8b)
+			type = CompressionType::GZIP;
+		else if (size >= 2 && (in[0] & 0x0F) == 8 && (in[0] >> 4) <= 7 && ((in[0] << 8) | in[1]) % 31 == 0)
+			type = CompressionType::ZLIB;
+		else
+			return false;
+		return true;
+	}
+
+	// Inflate one deflate stream (with or without a ZLIB header) onto the end of out.
+	// Returns the number of input bytes the stream used.
+	inline size_t inflateStream(const byte* data, size_t size, std::vector<byte>& out, int flags, tinfl_decompressor& decomp)
+	{
+		tinfl_init(&decomp);
+		size_t inOffset = 0;
+		size_t outOffset = out.size();
+		if (out.size() < outOffset + size * 2 + 128)
+			out.resize(outOffset + size * 2 + 128);
+		while (true) {
+			size_t inSize = size - inOffset;
+			size_t outSize = out.size() - outOffset;
+			tinfl_status status = tinfl_decompress(&decomp, (const mz_uint8*)data + inOffset, &inSize, (mz_uint8*)out.data(),
+				(mz_uint8*)out.data() + outOffset, &outSize, flags | TINFL_FLAG_USING_NON_WRAPPING_OUTPUT_BUF);
+			inOffset += inSize;
+			outOffset += outSize;
+			if (status == TINFL_STATUS_DONE)
+				break;
+			if (status != TINFL_STATUS_HAS_MORE_OUTPUT)
+				throw ODSException("Decompression Failed");
+			out.resize(out.size() * 2);
+		}
+		out.resize(outOffset);
+		return inOffset;
+	}
+
+	// The state of the compressors and decompressors, which is kept between calls. Creating a deflate compressor
+	// allocates and clears about 300 KB, which costs more than compressing a small message, so code that compresses
+	// many small buffers (like messages that are sent instead of saved) should reuse a context and its output vector.
+	// compressBytes() and decompressBytes() use the context of the calling thread (see local()).
 	//
-	// Calling any of these methods directly will result in an ODSException.
-	class ITag {
+	// A context can only be used by one thread at a time.
+	class CompressionContext {
 	public:
-		virtual std::string getName() { throw ODSException("INVALID OPERATION"); };
-		virtual void setName(std::string name) { throw ODSException("INVALID OPERATION"); };
-		virtual void writeData(BinaryOutputStream& bos) { throw ODSException("INVALID OPERATION"); };
-		virtual byte getID() { throw ODSException("INVALID OPERATION"); };
+		CompressionContext();
+		CompressionContext(const CompressionContext&) = delete;
+		CompressionContext& operator=(const CompressionContext&) = delete;
+
+		// The context of the calling thread. It is created the first time it is used, and lives until the thread ends.
+		static CompressionContext& local();
+
+		// Compress data onto the end of out as one complete ZLIB stream, GZIP member, or FAST or ADAPTIVE frame.
+		// threshold is only used by CompressionType::ADAPTIVE (see adaptiveCompress()). level is the deflate level
+		// (0 to 9) of every type except FAST, which has no levels.
+		void compress(CompressionType type, const byte* data, size_t size, std::vector<byte>& out, double threshold = defaultCompressionThreshold, int level = MZ_DEFAULT_LEVEL);
+		// Decompress data onto the end of out. The data can contain several ZLIB streams, GZIP members, or FAST or ADAPTIVE
+		// frames one after another (ObjectDataStructure::append() adds a new one every time), which are decompressed into one buffer.
+		void decompress(CompressionType type, const byte* data, size_t size, std::vector<byte>& out);
+
+	private:
+		// Deflate data onto the end of out with the flags of tdefl_create_comp_flags_from_zip_params().
+		void deflate(const byte* data, size_t size, std::vector<byte>& out, int flags);
+		tdefl_compressor* getCompressor();
+
+		// (Only allocated once deflate is used.)
+		std::unique_ptr<tdefl_compressor, void (*)(tdefl_compressor*)> compressor;
+		tinfl_decompressor decompressor;
+		// The hash table of the FAST codec.
+		std::vector<unsigned int> fastTable;
 	};
 
-	// This is the abstract template class for the tag. Please do not construct this
-	// template class on its own.
-	//
-	// class T is the primative type the tag is based on. For Example: The StringTag is based upon
-	// the std::string class. 
-	//
-	// Calling any of these methods directly will result in an ODSException.
-	template <class T> class Tag : public ITag{
+	inline CompressionContext::CompressionContext() : compressor(NULL, tdefl_compressor_free)
+	{
+	}
+
+	inline CompressionContext& CompressionContext::local()
+	{
+		static thread_local CompressionContext context;
+		return context;
+	}
+
+	inline tdefl_compressor* CompressionContext::getCompressor()
+	{
+		if (compressor == NULL) {
+			compressor.reset(tdefl_compressor_alloc());
+			if (compressor == NULL)
+				throw ODSException("Compression Failed");
+		}
+		return compressor.get();
+	}
+
+	inline void CompressionContext::deflate(const byte* data, size_t size, std::vector<byte>& out, int flags)
+	{
+		tdefl_compressor* deflater = getCompressor();
+		tdefl_init(deflater, NULL, NULL, flags);
+		size_t start = out.size();
+		out.resize(start + mz_compressBound((mz_ulong)size));
+		size_t inSize = size;
+		size_t outSize = out.size() - start;
+		if (tdefl_compress(deflater, data, &inSize, out.data() + start, &outSize, TDEFL_FINISH) != TDEFL_STATUS_DONE)
+			throw ODSException("Compression Failed");
+		out.resize(start + outSize);
+	}
+
+	inline void CompressionContext::compress(CompressionType type, const byte* data, size_t size, std::vector<byte>& out, double threshold, int level)
+	{
+		if (type == CompressionType::NONE) {
+			out.insert(out.end(), data, data + size);
+		}
+		else if (type == CompressionType::FAST) {
+			fastTable.resize((size_t)1 << fastHashBits);
+			fastCompress(data, size, out, fastTable.data());
+		}
+		else if (type == CompressionType::ADAPTIVE) {
+			adaptiveCompress(data, size, out, threshold, level, getCompressor());
+		}
+		else if (type == CompressionType::ZLIB) {
+			// (Positive window bits add the ZLIB header and trailer.)
+			deflate(data, size, out, tdefl_create_comp_flags_from_zip_params(level, MZ_DEFAULT_WINDOW_BITS, MZ_DEFAULT_STRATEGY));
+		}
+		else if (type == CompressionType::GZIP) {
+			// Header: magic, deflate, no flags, no time, no extra flags, unknown OS.
+			const unsigned char header[10] = { 0x1f, 0x8b, 8, 0, 0, 0, 0, 0, 0, 255 };
+			out.insert(out.end(), header, header + 10);
+			deflate(data, size, out, tdefl_create_comp_flags_from_zip_params(level, -MZ_DEFAULT_WINDOW_BITS, MZ_DEFAULT_STRATEGY));
+			// Trailer: CRC32 and the uncompressed size, both little endian.
+			mz_ulong crc = mz_crc32(MZ_CRC32_INIT, (const unsigned char*)data, size);
+			for (int i = 0; i < 4; i++)
+				out.push_back((byte)(crc >> (8 * i)));
+			for (int i = 0; i < 4; i++)
+				out.push_back((byte)((mz_ulong)size >> (8 * i)));
+		}
+	}
+
+	inline void CompressionContext::decompress(CompressionType type, const byte* data, size_t size, std::vector<byte>& out)
+	{
+		if (type == CompressionType::NONE) {
+			out.insert(out.end(), data, data + size);
+			return;
+		}
+		const unsigned char* in = (const unsigned char*)data;
+		size_t offset = 0;
+		while (offset < size) {
+			if (type == CompressionType::ZLIB) {
+				offset += inflateStream(data + offset, size - offset, out, TINFL_FLAG_PARSE_ZLIB_HEADER, decompressor);
+				continue;
+			}
+			if (type == CompressionType::FAST) {
+				offset += fastDecompress(data + offset, size - offset, out);
+				continue;
+			}
+			if (type == CompressionType::ADAPTIVE) {
+				offset += adaptiveDecompress(data + offset, size - offset, out, decompressor);
+				continue;
+			}
+			// GZIP member header.
+			if (size - offset < 18 || in[offset] != 0x1f || in[offset + 1] != 0x8b || in[offset + 2] != 8)
+				throw ODSException("Decompression Failed: Invalid GZIP header.");
+			unsigned char flags = in[offset + 3];
+			size_t position = offset + 10;
+			if (flags & 4)
+				position += 2 + (in[position] | (in[position + 1] << 8));
+			if (flags & 8)
+				while (position < size && in[position++] != 0);
+			if (flags & 16)
+				while (position < size && in[position++] != 0);
+			if (flags & 2)
+				position += 2;
+			if (position > size)
+				throw ODSException("Decompression Failed: Invalid GZIP header.");
+			size_t start = out.size();
+			position += inflateStream(data + position, size - position, out, 0, decompressor);
+			if (position + 8 > size)
+				throw ODSException("Decompression Failed: Missing GZIP trailer.");
+			mz_ulong crc = in[position] | (in[position + 1] << 8) | (in[position + 2] << 16) | ((mz_ulong)in[position + 3] << 24);
+			if (crc != mz_crc32(MZ_CRC32_INIT, (const unsigned char*)out.data() + start, out.size() - start))
+				throw ODSException("Decompression Failed: GZIP checksum does not match.");
+			offset = position + 8;
+		}
+	}
+
+	// Compress data with the context of the calling thread (see CompressionContext::compress()).
+	inline std::vector<byte> compressBytes(CompressionType type, const byte* data, size_t size, double threshold = defaultCompressionThreshold, int level = MZ_DEFAULT_LEVEL)
+	{
+		std::vector<byte> out;
+		CompressionContext::local().compress(type, data, size, out, threshold, level);
+		return out;
+	}
+
+	// Decompress data with the context of the calling thread (see CompressionContext::decompress()).
+	inline std::vector<byte> decompressBytes(CompressionType type, const byte* data, size_t size)
+	{
+		std::vector<byte> out;
+		CompressionContext::local().decompress(type, data, size, out);
+		return out;
+	}
+
+	// The lookup table for the software version of the CRC32C.
+	inline const unsigned int* crc32cTable()
+	{
+		static const std::array<unsigned int, 256> table = [] {
+			std::array<unsigned int, 256> result = {};
+			for (unsigned int i = 0; i < 256; i++) {
+				unsigned int c = i;
+				for (int k = 0; k < 8; k++)
+					c = (c & 1) ? (c >> 1) ^ 0x82F63B78 : c >> 1;
+				result[i] = c;
+			}
+			return result;
+		}();
+		return table.data();
+	}
+
+	inline unsigned int crc32cSoftware(unsigned int crc, const unsigned char* data, size_t size)
+	{
+		const unsigned int* table = crc32cTable();
+		for (size_t i = 0; i < size; i++)
+			crc = table[(crc ^ data[i]) & 0xFF] ^ (crc >> 8);
+		return crc;
+	}
+
+#ifdef ODS_HARDWARE_CRC32C
+	// Uses the crc32 instruction of SSE4.2, 8 bytes at a time.
+	ODS_TARGET_SSE42 inline unsigned int crc32cHardware(unsigned int crc, const unsigned char* data, size_t size)
+	{
+		unsigned long long c = crc;
+		while (size >= 8) {
+			unsigned long long value;
+			memcpy(&value, data, 8);
+			c = _mm_crc32_u64(c, value);
+			data += 8;
+			size -= 8;
+		}
+		crc = (unsigned int)c;
+		while (size > 0) {
+			crc = _mm_crc32_u8(crc, *data);
+			data++;
+			size--;
+		}
+		return crc;
+	}
+
+	inline bool hasHardwareCrc32c()
+	{
+		static const bool supported = [] {
+#ifdef _MSC_VER
+			int info[4];
+			__cpuid(info, 1);
+			return (info[2] & (1 << 20)) != 0;
+#else
+			unsigned int a, b, c, d;
+			return __get_cpuid(1, &a, &b, &c, &d) != 0 && (c & bit_SSE4_2) != 0;
+#endif
+		}();
+		return supported;
+	}
+#endif
+
+	// Calculate the CRC32C (Castagnoli) of data. Pass in the result of a previous call as crc to continue a checksum.
+	// The crc32 instruction is used when the cpu supports SSE4.2.
+	inline unsigned int crc32c(unsigned int crc, const byte* data, size_t size)
+	{
+		const unsigned char* b = reinterpret_cast<const unsigned char*>(data);
+#ifdef ODS_HARDWARE_CRC32C
+		if (hasHardwareCrc32c())
+			return ~crc32cHardware(~crc, b, size);
+#endif
+		return ~crc32cSoftware(~crc, b, size);
+	}
+
+	// Flush the file and wait for it to reach the disk (depending on the policy).
+	// Returns false if the file could not be flushed or synced.
+	inline bool syncFile(FILE* file, SyncPolicy policy)
+	{
+		if (fflush(file) != 0)
+			return false;
+		if (policy == SyncPolicy::NONE)
+			return true;
+#ifdef _WIN32
+		return _commit(_fileno(file)) == 0;
+#elif defined(__linux__)
+		if (policy == SyncPolicy::DATA)
+			return fdatasync(fileno(file)) == 0;
+		return fsync(fileno(file)) == 0;
+#else
+		return fsync(fileno(file)) == 0;
+#endif
+	}
+
+	// Wait for the entries of the directory that contains file_name to reach the disk.
+	// (Windows does not support this, so it does nothing there.)
+	inline void syncDirectory(const std::string& file_name)
+	{
+#ifndef _WIN32
+		std::filesystem::path directory = std::filesystem::absolute(file_name).parent_path();
+		int fd = open(directory.c_str(), O_RDONLY);
+		if (fd >= 0) {
+			fsync(fd);
+			::close(fd);
+		}
+#endif
+	}
+
+	// The size and modification time of a file, read with a single call. Returns false if the file does not exist.
+	// (The time is only compared with other times from here, its unit depends on the system.)
+	inline bool fileStamp(const std::string& file_name, long long& size, long long& time)
+	{
+#ifdef _WIN32
+		// (A directory_entry reads the size and time together on Windows.)
+		std::error_code error;
+		std::filesystem::directory_entry entry(file_name, error);
+		if (!error)
+			size = (long long)entry.file_size(error);
+		if (!error)
+			time = (long long)entry.last_write_time(error).time_since_epoch().count();
+		return !error;
+#else
+		struct stat info;
+		if (stat(file_name.c_str(), &info) != 0)
+			return false;
+		size = (long long)info.st_size;
+#ifdef __APPLE__
+		time = (long long)info.st_mtimespec.tv_sec * 1000000000LL + info.st_mtimespec.tv_nsec;
+#else
+		time = (long long)info.st_mtim.tv_sec * 1000000000LL + info.st_mtim.tv_nsec;
+#endif
+		return true;
+#endif
+	}
+
+	// Create a file that must not exist yet and open it for writing. Returns NULL if it cannot be created
+	// (errno is EEXIST if the file already exists).
+	inline FILE* createExclusive(const std::string& name)
+	{
+#ifdef _WIN32
+		int fd = _open(name.c_str(), _O_CREAT | _O_EXCL | _O_WRONLY | _O_BINARY, _S_IREAD | _S_IWRITE);
+		FILE* file = fd < 0 ? NULL : _fdopen(fd, "wb");
+		if (fd >= 0 && file == NULL)
+			_close(fd);
+#else
+		int fd = ::open(name.c_str(), O_CREAT | O_EXCL | O_WRONLY, 0666);
+		FILE* file = fd < 0 ? NULL : fdopen(fd, "wb");
+		if (fd >= 0 && file == NULL)
+			::close(fd);
+#endif
+		return file;
+	}
+
+	// Append data to a file (which is created if it does not exist), and flush and sync it as the policy says.
+	// If any of it cannot be written the file is cut back to the size it had (or removed if it was created), so no part
+	// of the data is left behind, and an ODSException is thrown.
+	inline void appendFile(const std::string& file_name, const byte* data, size_t size, SyncPolicy policy)
+	{
+		std::error_code error;
+		bool existed = std::filesystem::exists(file_name, error);
+		std::uintmax_t before = existed ? std::filesystem::file_size(file_name, error) : 0;
+		bool sized = !error;
+		FILE* file = fopen(file_name.c_str(), "ab");
+		if (file == NULL)
+			throw ODSException("Error: Failed to write the file!");
+		bool failed = size > 0 && fwrite(data, 1, size, file) != size;
+		failed = !syncFile(file, policy) || failed;
+		failed = fclose(file) != 0 || failed;
+		if (failed) {
+			if (!existed)
+				std::filesystem::remove(file_name, error);
+			else if (sized)
+				std::filesystem::resize_file(file_name, before, error);
+			throw ODSException("Error: Failed to write the file!");
+		}
+	}
+
+	// AtomicFile writes a file by writing a temporary file next to it and then renaming it over the file.
+	// Other processes never see a half written file, and a crash leaves the old file untouched.
+	// If commit() is never called the temporary file is deleted. The file keeps its permissions.
+	class AtomicFile {
 	public:
-		virtual T getValue() { throw ODSException("INVALID OPERATION"); };
-		virtual void setValue(T t){ throw ODSException("INVALID OPERATION"); };
-		virtual std::string getName() { throw ODSException("INVALID OPERATION"); };
-		virtual void setName(std::string name) { throw ODSException("INVALID OPERATION"); };
+		AtomicFile(std::string file_name);
+		AtomicFile(const AtomicFile&) = delete;
+		AtomicFile& operator=(const AtomicFile&) = delete;
+		~AtomicFile();
 
-		virtual void writeData(BinaryOutputStream& bos) { throw ODSException("INVALID OPERATION"); };
-		virtual Tag<T> createFromData(byte value[], int length) { throw ODSException("INVALID OPERATION"); };
+		void write(const byte* data, size_t size);
+		// Sync the temporary file (depending on the policy) and move it over the file.
+		void commit(SyncPolicy policy);
 
-		virtual byte getID() { throw ODSException("INVALID OPERATION"); };
+	private:
+		std::string file_name;
+		std::string temp_name;
+		FILE* file;
+		bool failed;
 	};
 
-	/*
-	
-		Byte Tag
-	
+	inline AtomicFile::AtomicFile(std::string file_name)
+	{
+		this->file_name = file_name;
+		this->failed = false;
+		// Make the name unique so two writers never share a temporary file. The file is only created if it does not
+		// exist, so a name that is taken (by another writer, or a file left behind by a crash) is tried again.
+		static thread_local unsigned int counter = 0;
+		size_t seed = std::hash<std::thread::id>()(std::this_thread::get_id()) ^ (size_t)std::chrono::steady_clock::now().time_since_epoch().count();
+		file = NULL;
+		for (int attempt = 0; attempt < 100 && file == NULL; attempt++) {
+			size_t unique = seed ^ ((size_t)++counter * 0x9E3779B9u);
+			this->temp_name = file_name + "." + std::to_string(unique % 1000000007) + ".tmp";
+			file = createExclusive(temp_name);
+			if (file == NULL && errno != EEXIST)
+				break;
+		}
+		if (file == NULL)
+			throw ODSException("Error: Failed to write the file!");
+	}
+
+	inline AtomicFile::~AtomicFile()
+	{
+		if (file != NULL) {
+			fclose(file);
+			std::remove(temp_name.c_str());
+		}
+	}
+
+	inline void AtomicFile::write(const byte* data, size_t size)
+	{
+		if (size > 0 && fwrite(data, 1, size, file) != size)
+			failed = true;
+	}
+
+	inline void AtomicFile::commit(SyncPolicy policy)
+	{
+		failed = !syncFile(file, policy) || failed || ferror(file);
+		fclose(file);
+		file = NULL;
+		if (failed) {
+			std::remove(temp_name.c_str());
+			throw ODSException("Error: Failed to write the file!");
+		}
+		// The temporary file was created with the default permissions, so it gets the permissions of the file it replaces.
+		std::error_code error;
+		std::filesystem::file_status status = std::filesystem::status(file_name, error);
+		if (!error && std::filesystem::exists(status))
+			std::filesystem::permissions(temp_name, status.permissions(), error);
+		std::filesystem::rename(temp_name, file_name, error);
+		if (error) {
+			std::remove(temp_name.c_str());
+			throw ODSException("Error: Failed to replace the file!");
+		}
+		if (policy == SyncPolicy::FULL)
+			syncDirectory(file_name);
+	}
+
+	/**
+	====================================
+
+		Input / Output streams
+
+	====================================
 	*/
-	class ByteTag : public Tag<byte> {
+	// BinaryOutputStream is a custom stream that allows you to write primative data types
+	// in the big endian format.
+	// There are two types of BinaryOutputStream: The memory only version, and the file version.
+	// The memory only version will not write to a file. Do enable memory only just construct the class
+	// with no parameters.
+	//
+	// The file mode does NOT open the file until the close() method is called. This is to allow for the automatic
+	// compression of the file. (TODO: It might be a good idea to stream files when there is no compression)
+	class BinaryOutputStream {
+	public:
+		BinaryOutputStream(std::string file_name, CompressionType type);
+		BinaryOutputStream(std::string file_name);
+		BinaryOutputStream();
+		~BinaryOutputStream();
+
+		void writeByte(byte b);
+		void writeByte(const byte* b, int size);
+
+		void writeShort(short s);
+		void writeInt(int i);
+		void writeLong(__int64 l);
+		void writeDouble(double d);
+		void writeFloat(float f);
+
+		// these methods exist to be redundant.
+		void writeInt16(__int16 i);
+		void writeInt32(__int32 i);
+
+		void writeString(std::string string);
+
+		void writeVarint(unsigned long long value);
+		// The parts of a tag that depend on the format.
+		// The length of a tag. (An int, or a varint in the compact format.)
+		void writeLength(int length);
+		// The name of a tag after its length. (A short length, or a varint length in the compact format. In Format::NAMED
+		// the name is added to the name dictionary and its index is written instead.)
+		void writeName(const std::string& name);
+		void writeName(TagName name);
+		// The value of an IntTag or LongTag. (Big endian, or a zigzag varint in the compact format.)
+		void writeIntValue(int value);
+		void writeLongValue(long long value);
+		// The number of bytes that writeLength() and writeName() write.
+		int lengthSize(int length);
+		int nameSize(TagName name);
+		// Insert the file header of the format at the start of the stream. (There is no header in the standard format.)
+		// In Format::NAMED the header has the name dictionary, so it is added after the tags are written.
+		void writeHeader();
+
+		// The format is Format::STANDARD by default. Switching to Format::NAMED starts an empty name dictionary
+		// if the stream does not have one.
+		void setFormat(Format format);
+		Format getFormat();
+		void setNameDictionary(std::shared_ptr<NameDictionary> names);
+		std::shared_ptr<NameDictionary> getNameDictionary();
+		// Write VectorTags of ObjectTags that have the same fields by column (see Document::columnar()). Off by default.
+		void setColumnar(bool columnar);
+		bool isColumnar();
+		// Write VectorTags of IntTags or LongTags as integer sequences, VectorTags of FloatTags or DoubleTags as
+		// float series, and VectorTags of StringTags as string sequences (see Document::sequence(), Document::series()
+		// and Document::strings()). Off by default.
+		void setSequenceEncoding(bool sequenceEncoding);
+		bool isSequenceEncoding();
+		// A new memory only stream with the same format, name dictionary, and options. (Used to write the inside of a tag before its length is known.)
+		BinaryOutputStream child();
+
+		// Write the bytes to the file. The file is replaced atomically (see AtomicFile).
+		void close();
+		// Like close(), except the bytes are added to the end of the file instead of replacing it.
+		// With compression the bytes are written as a new ZLIB stream, GZIP member, or FAST or ADAPTIVE frame.
+		// If they cannot all be written the file is cut back to its old size and an ODSException is thrown (see appendFile()).
+		void appendToFile();
+		// Get the array of bytes (This works in both memory and file mode.)
+		byte* getArray();
+		int length();
+		// Compress the bytes onto the end of out, for bytes that are sent instead of saved. Reusing out (and the
+		// context) means nothing is allocated once out is big enough. (See CompressionContext.)
+		void compress(CompressionType type, std::vector<byte>& out, CompressionContext& context = CompressionContext::local());
+
+		// How long close() and appendToFile() wait for the file to reach the disk. (SyncPolicy::NONE by default.)
+		void setSyncPolicy(SyncPolicy policy);
+		// The fraction of a block that CompressionType::ADAPTIVE must save for the block to be stored compressed.
+		// (0.05 by default. Must be at least 0 and less than 1.)
+		void setCompressionThreshold(double threshold);
+
 	private:
+		std::vector<byte> bytes;
 		std::string name;
-		byte value;
+		CompressionType compressionType;
+		double compressionThreshold;
+		SyncPolicy syncPolicy;
+		Format format;
+		std::shared_ptr<NameDictionary> names;
+		bool columnar;
+		bool sequenceEncoding;
+	};
 
-	public:
-		ByteTag(std::string name, byte value);
-		~ByteTag();
+	BinaryOutputStream::BinaryOutputStream(std::string file_name, CompressionType type)
+	{
+		name = file_name;
+		compressionType = type;
+		compressionThreshold = defaultCompressionThreshold;
+		syncPolicy = SyncPolicy::NONE;
+		format = Format::STANDARD;
+		columnar = false;
+		sequenceEncoding = false;
+		bytes = std::vector<byte>();
+	}
+
+	BinaryOutputStream::BinaryOutputStream(std::string file_name)
+	{
+		name = file_name;
+		compressionType = CompressionType::NONE;
+		compressionThreshold = defaultCompressionThreshold;
+		syncPolicy = SyncPolicy::NONE;
+		format = Format::STANDARD;
+		columnar = false;
+		sequenceEncoding = false;
+		bytes = std::vector<byte>();
+	}
+
+	BinaryOutputStream::BinaryOutputStream()
+	{
+		compressionType = CompressionType::NONE;
+		compressionThreshold = defaultCompressionThreshold;
+		syncPolicy = SyncPolicy::NONE;
+		format = Format::STANDARD;
+		columnar = false;
+		sequenceEncoding = false;
+		bytes = std::vector<byte>();
+	}
+
+	BinaryOutputStream::~BinaryOutputStream() {}
+
+	void BinaryOutputStream::writeByte(byte b)
+	{
+		bytes.push_back(b);
+	}
+
+	void BinaryOutputStream::writeByte(const byte* b, int size)
+	{
+		bytes.insert(bytes.end(), b, b + size);
+	}
+
+	// Inline since vs wants it to be.
+	inline void BinaryOutputStream::writeShort(short s)
+	{
+		bytes.push_back(s >> 8);
+		bytes.push_back(s);
+	}
+
+	inline void BinaryOutputStream::writeInt(int i)
+	{
+		bytes.push_back(i >> 24);
+		bytes.push_back(i >> 16);
+		bytes.push_back(i >> 8);
+		bytes.push_back(i);
+	}
+
+	inline void BinaryOutputStream::writeLong(__int64 l)
+	{
+		__int64 lon = swap_endian<__int64>(l);
+		byte* b = reinterpret_cast<byte*>(&lon);
+		writeByte(b, 8);
+	}
+
+	inline void BinaryOutputStream::writeDouble(double d)
+	{
+		double bigD = swap_endian<double>(d);
+		byte* b = reinterpret_cast<byte*>(&bigD);
+		writeByte(b, 8);
+	}
+
+	inline void BinaryOutputStream::writeFloat(float f)
+	{
+		float bigF = swap_endian<float>(f);
+		byte* b = reinterpret_cast<byte*>(&bigF);
+		writeByte(b, 4);
+	}
+
+	inline void BinaryOutputStream::writeInt16(__int16 i)
+	{
+		__int16 lon = swap_endian<__int16>(i);
+		byte* b = reinterpret_cast<byte*>(&lon);
+		writeByte(b, 2);
+	}
+
+	inline void BinaryOutputStream::writeInt32(__int32 i)
+	{
+		__int32 lon = swap_endian<__int32>(i);
+		byte* b = reinterpret_cast<byte*>(&lon);
+		writeByte(b, 4);
+	}
+
+	inline void BinaryOutputStream::writeString(std::string string)
+	{
+		writeByte(string.c_str(), string.length());
+	}
+
+	inline void BinaryOutputStream::writeVarint(unsigned long long value)
+	{
+		byte b[10];
+		writeByte(b, encodeVarint(b, value));
+	}
+
+	inline void BinaryOutputStream::writeLength(int length)
+	{
+		if (format != Format::STANDARD)
+			writeVarint((unsigned int)length);
+		else
+			writeInt(length);
+	}
+
+	inline void BinaryOutputStream::writeName(const std::string& name)
+	{
+		if (format == Format::NAMED) {
+			writeVarint(names->add(std::string_view(name)));
+			return;
+		}
+		if (format == Format::COMPACT)
+			writeVarint(name.length());
+		else
+			writeShort((short)name.length());
+		writeByte(name.c_str(), (int)name.length());
+	}
+
+	inline void BinaryOutputStream::writeName(TagName name)
+	{
+		if (format == Format::NAMED)
+			writeVarint(names->add(name));
+		else
+			writeName(name.str());
+	}
+
+	inline void BinaryOutputStream::writeIntValue(int value)
+	{
+		if (format != Format::STANDARD)
+			writeVarint(zigzagEncode(value));
+		else
+			writeInt(value);
+	}
+
+	inline void BinaryOutputStream::writeLongValue(long long value)
+	{
+		if (format != Format::STANDARD)
+			writeVarint(zigzagEncode(value));
+		else
+			writeLong(value);
+	}
+
+	inline int BinaryOutputStream::lengthSize(int length)
+	{
+		return format != Format::STANDARD ? varintSize((unsigned int)length) : 4;
+	}
+
+	inline int BinaryOutputStream::nameSize(TagName name)
+	{
+		if (format == Format::NAMED)
+			return varintSize(names->add(name));
+		int length = (int)name.str().length();
+		return (format == Format::COMPACT ? varintSize(length) : 2) + length;
+	}
+
+	inline void BinaryOutputStream::writeHeader()
+	{
+		if (format == Format::STANDARD)
+			return;
+		std::vector<byte> header(compactHeader, compactHeader + compactHeaderSize);
+		if (format == Format::NAMED) {
+			header[4] |= headerFlagNames;
+			std::vector<byte> dictionary;
+			names->write(dictionary);
+			byte size[10];
+			header.insert(header.end(), size, size + encodeVarint(size, dictionary.size()));
+			header.insert(header.end(), dictionary.begin(), dictionary.end());
+		}
+		bytes.insert(bytes.begin(), header.begin(), header.end());
+	}
+
+	inline void BinaryOutputStream::setFormat(Format format)
+	{
+		this->format = format;
+		if (format == Format::NAMED && names == NULL)
+			names = std::make_shared<NameDictionary>();
+	}
+
+	inline Format BinaryOutputStream::getFormat()
+	{
+		return format;
+	}
+
+	inline void BinaryOutputStream::setNameDictionary(std::shared_ptr<NameDictionary> names)
+	{
+		this->names = names;
+	}
+
+	inline std::shared_ptr<NameDictionary> BinaryOutputStream::getNameDictionary()
+	{
+		return names;
+	}
+
+	inline void BinaryOutputStream::setColumnar(bool columnar)
+	{
+		this->columnar = columnar;
+	}
+
+	inline bool BinaryOutputStream::isColumnar()
+	{
+		return columnar;
+	}
+
+	inline void BinaryOutputStream::setSequenceEncoding(bool sequenceEncoding)
+	{
+		this->sequenceEncoding = sequenceEncoding;
+	}
+
+	inline bool BinaryOutputStream::isSequenceEncoding()
+	{
+		return sequenceEncoding;
+	}
+
+	inline BinaryOutputStream BinaryOutputStream::child()
+	{
+		BinaryOutputStream stream = BinaryOutputStream();
+		stream.format = format;
+		stream.names = names;
+		stream.columnar = columnar;
+		stream.sequenceEncoding = sequenceEncoding;
+		return stream;
+	}
+
+	// Write the data from memory into the file.
+	// (There is no technical reason to do this when in memory mode; however, it is still
+	// good practice to do so.)
+	inline void BinaryOutputStream::close()
+	{
+		if (name.empty()) {
+			return;
+		}
+		AtomicFile file = AtomicFile(name);
+		if (compressionType == CompressionType::NONE) {
+			file.write(getArray(), bytes.size());
+		}
+		else {
+			std::vector<byte> compressed = compressBytes(compressionType, getArray(), bytes.size(), compressionThreshold);
+			file.write(compressed.data(), compressed.size());
+		}
+		file.commit(syncPolicy);
+	}
+
+	inline void BinaryOutputStream::appendToFile()
+	{
+		if (name.empty()) {
+			return;
+		}
+		if (compressionType == CompressionType::NONE) {
+			appendFile(name, getArray(), bytes.size(), syncPolicy);
+		}
+		else {
+			std::vector<byte> compressed = compressBytes(compressionType, getArray(), bytes.size(), compressionThreshold);
+			appendFile(name, compressed.data(), compressed.size(), syncPolicy);
+		}
+	}
+
+	inline void BinaryOutputStream::setSyncPolicy(SyncPolicy policy)
+	{
+		syncPolicy = policy;
+	}
+
+	inline void BinaryOutputStream::setCompressionThreshold(double threshold)
+	{
+		if (!(threshold >= 0 && threshold < 1))
+			throw ODSException("Error: The compression threshold must be at least 0 and less than 1!");
+		compressionThreshold = threshold;
+	}
+
+	inline byte* BinaryOutputStream::getArray()
+	{
+		return bytes.data();
+	}
+
+	inline int BinaryOutputStream::length()
+	{
+		return bytes.size();
+	}
+
+	inline void BinaryOutputStream::compress(CompressionType type, std::vector<byte>& out, CompressionContext& context)
+	{
+		context.compress(type, getArray(), bytes.size(), out, compressionThreshold);
+	}
+
+	// A ByteSource is an immutable block of bytes that can be shared by many BinaryInputStreams.
+	// Each thread reads with its own BinaryInputStream (which only holds a position), so many threads can
+	// read the same loaded file at the same time without copying it or locking.
+	//
+	// Uncompressed files are memory mapped where it is supported (not on Windows), compressed files are
+	// decompressed onto the heap. The source is freed when the last stream using it is closed or destroyed.
+	// Note: A mapped file shows changes made in place by ObjectDataStructure::set(). (Files that are saved
+	// normally are replaced, so mapped sources keep the old contents.)
+	class ByteSource {
+	public:
+		static std::shared_ptr<const ByteSource> fromFile(std::string file_name, CompressionType type = CompressionType::NONE);
+		static std::shared_ptr<const ByteSource> fromBytes(std::vector<byte> bytes);
+		ByteSource(const ByteSource&) = delete;
+		ByteSource& operator=(const ByteSource&) = delete;
+		~ByteSource();
+
+		const byte* data() const;
+		long length() const;
+		bool isMapped() const;
+
+	private:
+		ByteSource();
+
+		std::vector<byte> bytes;
+		const byte* mapped;
+		size_t mappedSize;
+	};
+
+	inline ByteSource::ByteSource()
+	{
+		mapped = NULL;
+		mappedSize = 0;
+	}
+
+	inline ByteSource::~ByteSource()
+	{
+#ifndef _WIN32
+		if (mapped != NULL)
+			munmap(const_cast<byte*>(mapped), mappedSize);
+#endif
+	}
+
+	inline std::shared_ptr<const ByteSource> ByteSource::fromFile(std::string file_name, CompressionType type)
+	{
+		std::shared_ptr<ByteSource> source = std::shared_ptr<ByteSource>(new ByteSource());
+#ifndef _WIN32
+		if (type == CompressionType::NONE) {
+			int fd = open(file_name.c_str(), O_RDONLY);
+			if (fd < 0)
+				throw ODS::ODSException("File stream not open! Does that file exist?");
+			struct stat info;
+			if (fstat(fd, &info) == 0 && info.st_size > 0) {
+				void* view = mmap(NULL, (size_t)info.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+				if (view != MAP_FAILED) {
+					source->mapped = (const byte*)view;
+					source->mappedSize = (size_t)info.st_size;
+				}
+			}
+			::close(fd);
+			if (source->mapped != NULL)
+				return source;
+		}
+#endif
+		std::ifstream stream(file_name, std::ios::in | std::ios::binary | std::ios::ate);
+		if (!stream.is_open())
+			throw ODS::ODSException("File stream not open! Does that file exist?");
+		std::vector<byte> raw((size_t)stream.tellg());
+		stream.seekg(0, stream.beg);
+		stream.read(raw.data(), raw.size());
+		stream.close();
+		if (type == CompressionType::NONE)
+			source->bytes.swap(raw);
+		else
+			source->bytes = decompressBytes(type, raw.data(), raw.size());
+		return source;
+	}
+
+	inline std::shared_ptr<const ByteSource> ByteSource::fromBytes(std::vector<byte> bytes)
+	{
+		std::shared_ptr<ByteSource> source = std::shared_ptr<ByteSource>(new ByteSource());
+		source->bytes.swap(bytes);
+		return source;
+	}
+
+	inline const byte* ByteSource::data() const
+	{
+		return mapped != NULL ? mapped : bytes.data();
+	}
+
+	inline long ByteSource::length() const
+	{
+		return mapped != NULL ? (long)mappedSize : (long)bytes.size();
+	}
+
+	inline bool ByteSource::isMapped() const
+	{
+		return mapped != NULL;
+	}
+
+	// The default of BinaryInputStream::setValueLimit(). (About 400 MB of nodes.)
+	const size_t defaultValueLimit = 1 << 24;
+
+	/*
+		This is the input stream for binary files.
+	*/
+	// This class handles the reading of binary data from files and memory.
+	// Similar to the BinaryOutputStream it translates big endian primative to
+	// little endian automatically.
+	//
+	// To create the BinaryInputStream in memory only mode please construct the class
+	// with with your array of bytes. Compressed bytes must be given with their size; they are decompressed (with the
+	// CompressionContext of the thread) into memory that the stream owns.
+	//
+	// Technical Note: The entire file is loaded into memory at the beging to deal with compression.
+	// (Uncompressed files are memory mapped where possible, see ByteSource.)
+	//
+	// A BinaryInputStream only holds a position into its bytes. Streams created from a file or a ByteSource
+	// can be copied (or made with cursor()) to read the same bytes from many threads at once.
+	class BinaryInputStream {
+	public:
+		BinaryInputStream(std::string file_name, CompressionType type = CompressionType::NONE);
+		BinaryInputStream(std::shared_ptr<const ByteSource> source);
+		BinaryInputStream(byte data[], CompressionType type = CompressionType::NONE);
+		BinaryInputStream(byte data[], long size, CompressionType type = CompressionType::NONE);
+		//BinaryInputStream(byte* data, CompressionType type = CompressionType::NONE);
+		~BinaryInputStream();
+
+		// The position of the next byte to be read.
+		long getIndex();
+		void setIndex(long index);
+		// The number of bytes in the stream. (-1 if the stream was created from a byte array without a size.)
+		long length();
+		// The number of bytes left after the current index.
+		long remaining();
+		// A pointer to the next byte to be read.
+		const byte* getPointer();
+		// The shared bytes of the stream (NULL for streams created from a byte array).
+		std::shared_ptr<const ByteSource> getSource();
+		// A new stream at the start of the same bytes. (Only for streams created from a file or a ByteSource.)
+		BinaryInputStream cursor();
+
+		byte readByte();
+		void readBytes(byte* b, int size);
+		void readBytes(byte b[]);
+		template<size_t size> void readBytes(std::array<byte, size> s);
+
+		short readShort();
+		int readInt();
+		__int64 readLong();
+		double readDouble();
+		float readFloat();
+
+		__int16 readInt16();
+		__int32 readInt32();
+
+		std::string readString(int size);
+
+		// Read a varint that must end before end. Throws an ODSException if it does not.
+		unsigned long long readVarint(long end);
+		// The value of an IntTag or LongTag that ends at end (see BinaryOutputStream::writeIntValue()).
+		int readIntValue(long end);
+		long long readLongValue(long end);
+		// The counterparts of BinaryOutputStream::writeLength() and writeName(), which must end before end.
+		// Throws an ODSException if they do not.
+		int readLength(long end);
+		TagName readName(long end);
+
+		// Read the id, length and name length of the tag at the current index and check that the whole tag
+		// fits before end (and the end of the stream). Returns the index where the tag ends.
+		// Throws an ODSException if the tag is corrupt. Once the header is checked the rest of the tag can be
+		// read with the normal (unchecked) read methods.
+		long readTagHeader(long end, byte& id, short& nameLength);
+		// Read the name of the tag after readTagHeader() (nameLength is the length it returned).
+		// In Format::NAMED the name is looked up in the name dictionary. Other names are transient (see TagName::transient()).
+		TagName readTagName(short nameLength);
+		// The same as readTagName() without copying the name. The view is valid until the stream is closed.
+		std::string_view readTagNameView(short nameLength);
+
+		// The format is Format::STANDARD by default.
+		void setFormat(Format format);
+		Format getFormat();
+		// The name dictionary of Format::NAMED (set by readFormat()).
+		void setNameDictionary(std::shared_ptr<const NameDictionary> names);
+		std::shared_ptr<const NameDictionary> getNameDictionary();
+		// The most nodes that Document::read() may create from the stream. Encoded vectors (such as a run of the same
+		// integer) can hold many values in a few bytes, so a corrupt count could ask for far more memory than the file
+		// is. Reading a vector that would go over the limit throws an ODSException. (defaultValueLimit by default.)
+		void setValueLimit(size_t limit);
+		size_t getValueLimit();
+		// If the stream is at a file header, read it and switch to the format of the file.
+		// Throws an ODSException if the header is corrupt or from a newer version.
+		Format readFormat();
+
+		void close();
+
+	private:
+		std::shared_ptr<const ByteSource> source;
+		byte* bytes;
+		std::string name;
+		CompressionType compressionType;
+		Format format;
+		std::shared_ptr<const NameDictionary> names;
+		size_t valueLimit;
+		long currentIndex;
+		long fileSize;
+	};
+
+	inline BinaryInputStream::BinaryInputStream(std::string file_name, CompressionType type)
+	{
+		name = file_name;
+		compressionType = type;
+		format = Format::STANDARD;
+		valueLimit = defaultValueLimit;
+		currentIndex = 0;
+		source = ByteSource::fromFile(file_name, type);
+		bytes = const_cast<byte*>(source->data());
+		fileSize = source->length();
+	}
+
+	inline BinaryInputStream::BinaryInputStream(std::shared_ptr<const ByteSource> source)
+	{
+		name = "";
+		compressionType = CompressionType::NONE;
+		format = Format::STANDARD;
+		valueLimit = defaultValueLimit;
+		currentIndex = 0;
+		this->source = source;
+		bytes = const_cast<byte*>(source->data());
+		fileSize = source->length();
+	}
+
+	inline BinaryInputStream::BinaryInputStream(byte data[], CompressionType type)
+	{
+		// TODO DECOMPRESS DATA
+		name = "";
+		compressionType = type;
+		format = Format::STANDARD;
+		valueLimit = defaultValueLimit;
+		currentIndex = 0;
+		// The size is not known, so only the ranges passed in to readTagHeader() can be checked.
+		fileSize = -1;
+		this->bytes = data;
+	}
+
+	inline BinaryInputStream::BinaryInputStream(byte data[], long size, CompressionType type)
+	{
+		name = "";
+		compressionType = type;
+		format = Format::STANDARD;
+		valueLimit = defaultValueLimit;
+		currentIndex = 0;
+		fileSize = size;
+		this->bytes = data;
+		if (type != CompressionType::NONE) {
+			source = ByteSource::fromBytes(decompressBytes(type, data, size));
+			bytes = const_cast<byte*>(source->data());
+			fileSize = source->length();
+		}
+	}
+
+	/*inline BinaryInputStream::BinaryInputStream(byte* data, CompressionType type)
+	{
+		// TODO DECOMPRESS DATA
+		name = "";
+		compressionType = type;
+		format = Format::STANDARD;
+		valueLimit = defaultValueLimit;
+		currentIndex = 0;
+		this->bytes = data;
+	}*/
+
+	inline BinaryInputStream::~BinaryInputStream()
+	{
+		//delete[] bytes;
+	}
+
+	inline long BinaryInputStream::getIndex()
+	{
+		return currentIndex;
+	}
+
+	inline void BinaryInputStream::setIndex(long index)
+	{
+		currentIndex = index;
+	}
+
+	inline long BinaryInputStream::length()
+	{
+		return fileSize;
+	}
+
+	inline long BinaryInputStream::remaining()
+	{
+		return fileSize - currentIndex;
+	}
+
+	inline const byte* BinaryInputStream::getPointer()
+	{
+		return bytes + currentIndex;
+	}
+
+	inline std::shared_ptr<const ByteSource> BinaryInputStream::getSource()
+	{
+		return source;
+	}
+
+	inline BinaryInputStream BinaryInputStream::cursor()
+	{
+		if (source == NULL)
+			throw ODSException("Error: Only streams created from a file or a ByteSource have cursors!");
+		return BinaryInputStream(source);
+	}
+
+	inline byte BinaryInputStream::readByte()
+	{
+		return bytes[currentIndex++];
+	}
+
+	inline void BinaryInputStream::readBytes(byte* b, int size)
+	{
+		memcpy(b, bytes + currentIndex, size);
+		currentIndex += size;
+	}
+
+	inline void BinaryInputStream::readBytes(byte b[])
+	{
+		for (int i = 0; i < sizeof(b); i++) {
+			b[i] = bytes[currentIndex];
+			currentIndex++;
+		}
+	}
+
+	template<size_t size>
+	inline void ODS::BinaryInputStream::readBytes(std::array<byte, size> s)
+	{
+		memcpy(s, bytes + currentIndex, size);
+		currentIndex += size;
+	}
+
+	// The bytes are read as unsigned so they are not sign extended when they are combined.
+	inline short BinaryInputStream::readShort()
+	{
+		const unsigned char* b = reinterpret_cast<const unsigned char*>(bytes + currentIndex);
+		currentIndex += 2;
+		return (short)((b[0] << 8) | b[1]);
+	}
+
+	inline int BinaryInputStream::readInt()
+	{
+		const unsigned char* b = reinterpret_cast<const unsigned char*>(bytes + currentIndex);
+		currentIndex += 4;
+		return (int)(((unsigned int)b[0] << 24) | ((unsigned int)b[1] << 16) | ((unsigned int)b[2] << 8) | (unsigned int)b[3]);
+	}
+
+	inline __int64 BinaryInputStream::readLong()
+	{
+		__int64 d;
+		memcpy(&d, bytes + currentIndex, 8);
+		currentIndex += 8;
+		return swap_endian(d);
+	}
+
+	inline double BinaryInputStream::readDouble()
+	{
+		double d;
+		memcpy(&d, bytes + currentIndex, 8);
+		currentIndex += 8;
+		return swap_endian(d);
+	}
+
+	inline float BinaryInputStream::readFloat()
+	{
+		float d;
+		memcpy(&d, bytes + currentIndex, 4);
+		currentIndex += 4;
+		return swap_endian(d);
+	}
+
+	inline __int16 BinaryInputStream::readInt16()
+	{
+		return readShort();
+	}
+
+	inline __int32 BinaryInputStream::readInt32()
+	{
+		return readInt();
+	}
+
+	inline std::string BinaryInputStream::readString(int size)
+	{
+		std::string str(bytes + currentIndex, size);
+		currentIndex += size;
+		return str;
+	}
+
+	inline unsigned long long BinaryInputStream::readVarint(long end)
+	{
+		unsigned long long value;
+		int size = decodeVarint(bytes + currentIndex, end - currentIndex, value);
+		if (size == 0)
+			throw ODSException("Error: A varint is past the end of the data!");
+		currentIndex += size;
+		return value;
+	}
+
+	inline int BinaryInputStream::readIntValue(long end)
+	{
+		if (format != Format::STANDARD)
+			return (int)zigzagDecode(readVarint(end));
+		return readInt();
+	}
+
+	inline long long BinaryInputStream::readLongValue(long end)
+	{
+		if (format != Format::STANDARD)
+			return zigzagDecode(readVarint(end));
+		return readLong();
+	}
+
+	inline int BinaryInputStream::readLength(long end)
+	{
+		if (format != Format::STANDARD) {
+			unsigned long long length = readVarint(end);
+			if (length > 0x7FFFFFFF)
+				throw ODSException("Error: A length is past the end of the data!");
+			return (int)length;
+		}
+		if (end - currentIndex < 4)
+			throw ODSException("Error: A length is past the end of the data!");
+		return readInt();
+	}
+
+	inline TagName BinaryInputStream::readName(long end)
+	{
+		if (format == Format::NAMED)
+			return names->get(readVarint(end));
+		unsigned long long length;
+		if (format == Format::COMPACT)
+			length = readVarint(end);
+		else if (end - currentIndex >= 2)
+			length = (unsigned short)readShort();
+		else
+			length = 0x8000;
+		if (length > 0x7FFF || (long)length > end - currentIndex)
+			throw ODSException("Error: A name is past the end of the data!");
+		TagName name = TagName::transient(std::string_view(bytes + currentIndex, (size_t)length));
+		currentIndex += (long)length;
+		return name;
+	}
+
+	inline long BinaryInputStream::readTagHeader(long end, byte& id, short& nameLength)
+	{
+		if (fileSize >= 0 && end > fileSize)
+			end = fileSize;
+		TagHeader header;
+		if (!parseTagHeader(bytes + currentIndex, end - currentIndex, format, header))
+			throw ODSException("Error: The tag header is corrupt or past the end of the data!");
+		id = header.id;
+		nameLength = header.nameLength;
+		long tagStart = currentIndex;
+		currentIndex += header.valueStart - header.nameLength;
+		return tagStart + header.end;
+	}
+
+	inline TagName BinaryInputStream::readTagName(short nameLength)
+	{
+		if (format == Format::NAMED)
+			return names->get(readVarint(currentIndex + nameLength));
+		TagName name = TagName::transient(std::string_view(bytes + currentIndex, nameLength));
+		currentIndex += nameLength;
+		return name;
+	}
+
+	inline std::string_view BinaryInputStream::readTagNameView(short nameLength)
+	{
+		if (format == Format::NAMED)
+			return names->get(readVarint(currentIndex + nameLength)).str();
+		std::string_view name(bytes + currentIndex, nameLength);
+		currentIndex += nameLength;
+		return name;
+	}
+
+	inline void BinaryInputStream::setFormat(Format format)
+	{
+		this->format = format;
+	}
+
+	inline Format BinaryInputStream::getFormat()
+	{
+		return format;
+	}
+
+	inline void BinaryInputStream::setNameDictionary(std::shared_ptr<const NameDictionary> names)
+	{
+		this->names = names;
+	}
+
+	inline std::shared_ptr<const NameDictionary> BinaryInputStream::getNameDictionary()
+	{
+		return names;
+	}
+
+	inline void BinaryInputStream::setValueLimit(size_t limit)
+	{
+		valueLimit = limit;
+	}
+
+	inline size_t BinaryInputStream::getValueLimit()
+	{
+		return valueLimit;
+	}
+
+	inline Format BinaryInputStream::readFormat()
+	{
+		// (Without a size only the fixed part of the header is known to be there.)
+		long available = fileSize < 0 ? compactHeaderSize + 10 : fileSize - currentIndex;
+		Format fileFormat;
+		long dictionarySize;
+		long size = parseFileHeader(bytes + currentIndex, available, fileFormat, dictionarySize);
+		if (size < 0 || (fileSize >= 0 && size > available))
+			throw ODSException("Error: The file header is corrupt or from a newer version of ODS!");
+		if (size == 0)
+			return format;
+		if (fileFormat == Format::NAMED) {
+			names = NameDictionary::read(bytes + currentIndex + size - dictionarySize, dictionarySize);
+			if (names == NULL)
+				throw ODSException("Error: The name dictionary is corrupt!");
+		}
+		format = fileFormat;
+		currentIndex += size;
+		return format;
+	}
+
+	// The size of the value of a tag. (-1 for tags that do not have a fixed size, like the ObjectTag.)
+	inline int tagValueSize(byte id, Format format = Format::STANDARD)
+	{
+		switch (id) {
+		case 2: return format != Format::STANDARD ? -1 : 4;
+		case 3: return 4;
+		case 4: return 8;
+		case 6: return format != Format::STANDARD ? -1 : 8;
+		case 7: return 1;
+		case 8: return 1;
+		default: return -1;
+		}
+	}
+
+	inline void BinaryInputStream::close()
+	{
+		// Shared bytes are freed by the last stream that uses them.
+		if (source != NULL) {
+			source.reset();
+			bytes = NULL;
+			return;
+		}
+		delete[] bytes;
+	}
+
+	/**
+	====================================
+		ODS TAGS
+		These are the tags of ODS.
+	====================================
+	*/
+	// An ITag is used so that way you can have a vector of tags without knowing the primative type.
+	// Example: std::vector<ITag*> vec();
+	//
+	// DO NOT construct this class as it is an abstract class. This class is only to be used to refrence and unknown tag type
+	// or to be extended.
+	//
+	// Calling any of these methods directly will result in an ODSException.
+	class ITag {
+	public:
+		virtual ~ITag() {};
+		virtual std::string getName() { throw ODSException("INVALID OPERATION"); };
+		virtual TagName getTagName() { throw ODSException("INVALID OPERATION"); };
+		virtual void setName(std::string name) { throw ODSException("INVALID OPERATION"); };
+		virtual void writeData(BinaryOutputStream& bos) { throw ODSException("INVALID OPERATION"); };
+		virtual byte getID() { throw ODSException("INVALID OPERATION"); };
+	};
+
+	// This is the abstract template class for the tag. Please do not construct this
+	// template class on its own.
+	//
+	// class T is the primative type the tag is based on. For Example: The StringTag is based upon
+	// the std::string class. 
+	//
+	// Calling any of these methods directly will result in an ODSException.
+	template <class T> class Tag : public ITag{
+	public:
+		virtual T getValue() { throw ODSException("INVALID OPERATION"); };
+		virtual void setValue(T t){ throw ODSException("INVALID OPERATION"); };
+		virtual std::string getName() { throw ODSException("INVALID OPERATION"); };
+		virtual TagName getTagName() { throw ODSException("INVALID OPERATION"); };
+		virtual void setName(std::string name) { throw ODSException("INVALID OPERATION"); };
+
+		virtual void writeData(BinaryOutputStream& bos) { throw ODSException("INVALID OPERATION"); };
+		virtual Tag<T> createFromData(byte value[], int length) { throw ODSException("INVALID OPERATION"); };
+
+		virtual byte getID() { throw ODSException("INVALID OPERATION"); };
+	};
+
+	/*
+	
+		Byte Tag
+	
+	*/
+	class ByteTag : public Tag<byte> {
+	private:
+		TagName name;
+		byte value;
+
+	public:
+		ByteTag(std::string name, byte value);
+		ByteTag(TagName name, byte value);
+		~ByteTag();
+
+		void setValue(byte b);
+		byte getValue();
+		void setName(std::string);
+		std::string getName();
+		TagName getTagName();
+
+		void writeData(BinaryOutputStream& bos);
+		Tag<byte> createFromData(byte value[], int length);
+		byte getID();
+	};
+
+	inline ByteTag::ByteTag(std::string name, byte value)
+	{
+		this->name = TagName(name);
+		this->value = value;
+	}
+
+	inline ByteTag::ByteTag(TagName name, byte value)
+	{
+		this->name = name;
+		this->value = value;
+	}
+
+	inline ByteTag::~ByteTag()
+	{
+	}
+
+	inline void ByteTag::setValue(byte b)
+	{
+		this->value = b;
+	}
+
+	inline byte ByteTag::getValue()
+	{
+		return value;
+	}
+
+	inline void ByteTag::setName(std::string name)
+	{
+		this->name = TagName(name);
+	}
+
+	inline std::string ByteTag::getName()
+	{
+		return name.str();
+	}
+
+	inline TagName ByteTag::getTagName()
+	{
+		return name;
+	}
+
+	inline void ByteTag::writeData(BinaryOutputStream& bos)
+	{
+		bos.writeByte(getID());
+		// Memory only stream
+		BinaryOutputStream tempBOS = bos.child();
+		tempBOS.writeName(name);
+		tempBOS.writeByte(value);
+
+		bos.writeLength(tempBOS.length());
+		bos.writeByte(tempBOS.getArray(), tempBOS.length());
+		tempBOS.close();
+	}
+
+	
+	inline Tag<byte> ByteTag::createFromData(byte value[], int length)
+	{
+		this->value = value[0];
+		return *this;
+	}
+	
+
+	inline byte ByteTag::getID()
+	{
+		return 8;
+	}
+
+	/******************************
+
+		Char Tag
+		(Doesn't have much purpose in c++, exists only to be compatible with other ODS versions.)
+
+	*******************************
+	*/
+	class CharTag : public Tag<char> {
+	private:
+		TagName name;
+		char value;
+
+	public:
+		CharTag(std::string name, byte value);
+		CharTag(TagName name, byte value);
+		~CharTag();
+
+		void setValue(char b);
+		char getValue();
+		void setName(std::string);
+		std::string getName();
+		TagName getTagName();
+
+		void writeData(BinaryOutputStream& bos);
+		Tag<char> createFromData(byte value[], int length);
+		byte getID();
+	};
+
+	inline CharTag::CharTag(std::string name, char value)
+	{
+		this->name = TagName(name);
+		this->value = value;
+	}
+
+	inline CharTag::CharTag(TagName name, char value)
+	{
+		this->name = name;
+		this->value = value;
+	}
+
+	inline CharTag::~CharTag()
+	{
+	}
+
+	inline void CharTag::setValue(char b)
+	{
+		this->value = b;
+	}
+
+	inline byte CharTag::getValue()
+	{
+		return value;
+	}
+
+	inline void CharTag::setName(std::string name)
+	{
+		this->name = TagName(name);
+	}
+
+	inline std::string CharTag::getName()
+	{
+		return name.str();
+	}
+
+	inline TagName CharTag::getTagName()
+	{
+		return name;
+	}
+
+	inline void CharTag::writeData(BinaryOutputStream& bos)
+	{
+		bos.writeByte(getID());
+		// Memory only stream
+		BinaryOutputStream tempBOS = bos.child();
+		tempBOS.writeName(name);
+		tempBOS.writeByte(value);
+
+		bos.writeLength(tempBOS.length());
+		bos.writeByte(tempBOS.getArray(), tempBOS.length());
+		tempBOS.close();
+	}
+
+
+	inline Tag<char> CharTag::createFromData(byte value[], int length)
+	{
+		this->value = value[0];
+		return *this;
+	}
+
+
+	inline byte CharTag::getID()
+	{
+		return 7;
+	}
+
+	/******************************
+
+		Double Tag
+
+	*******************************
+	*/
+	class DoubleTag : public Tag<double> {
+	private:
+		TagName name;
+		double value;
+
+	public:
+		DoubleTag(std::string name, double value);
+		DoubleTag(TagName name, double value);
+		~DoubleTag();
+
+		void setValue(double b);
+		double getValue();
+		void setName(std::string);
+		std::string getName();
+		TagName getTagName();
+
+		void writeData(BinaryOutputStream& bos);
+		Tag<double> createFromData(byte value[], int length);
+		byte getID();
+	};
+
+	inline DoubleTag::DoubleTag(std::string name, double value)
+	{
+		this->name = TagName(name);
+		this->value = value;
+	}
+
+	inline DoubleTag::DoubleTag(TagName name, double value)
+	{
+		this->name = name;
+		this->value = value;
+	}
+
+	inline DoubleTag::~DoubleTag()
+	{
+	}
+
+	inline void DoubleTag::setValue(double b)
+	{
+		this->value = b;
+	}
+
+	inline double DoubleTag::getValue()
+	{
+		return value;
+	}
+
+	inline void DoubleTag::setName(std::string name)
+	{
+		this->name = TagName(name);
+	}
+
+	inline std::string DoubleTag::getName()
+	{
+		return name.str();
+	}
+
+	inline TagName DoubleTag::getTagName()
+	{
+		return name;
+	}
+
+	inline void DoubleTag::writeData(BinaryOutputStream& bos)
+	{
+		bos.writeByte(getID());
+		// Memory only stream
+		BinaryOutputStream tempBOS = bos.child();
+		tempBOS.writeName(name);
+		tempBOS.writeDouble(value);
+
+		bos.writeLength(tempBOS.length());
+		bos.writeByte(tempBOS.getArray(), tempBOS.length());
+		tempBOS.close();
+	}
+
+
+	inline Tag<double> DoubleTag::createFromData(byte value[], int length)
+	{
+		this->value = *reinterpret_cast<double*>(*value);
+		return *this;
+	}
+
+
+	inline byte DoubleTag::getID()
+	{
+		return 4;
+	}
+
+	/******************************
+
+		Float Tag
+
+	*******************************
+	*/
+	class FloatTag : public Tag<float> {
+	private:
+		TagName name;
+		float value;
+
+	public:
+		FloatTag(std::string name, float value);
+		FloatTag(TagName name, float value);
+		~FloatTag();
+
+		void setValue(float b);
+		float getValue();
+		void setName(std::string);
+		std::string getName();
+		TagName getTagName();
+
+		void writeData(BinaryOutputStream& bos);
+		Tag<float> createFromData(byte value[], int length);
+		byte getID();
+	};
+
+	inline FloatTag::FloatTag(std::string name, float value)
+	{
+		this->name = TagName(name);
+		this->value = value;
+	}
+
+	inline FloatTag::FloatTag(TagName name, float value)
+	{
+		this->name = name;
+		this->value = value;
+	}
+
+	inline FloatTag::~FloatTag()
+	{
+	}
+
+	inline void FloatTag::setValue(float b)
+	{
+		this->value = b;
+	}
+
+	inline float FloatTag::getValue()
+	{
+		return value;
+	}
+
+	inline void FloatTag::setName(std::string name)
+	{
+		this->name = TagName(name);
+	}
+
+	inline std::string FloatTag::getName()
+	{
+		return name.str();
+	}
+
+	inline TagName FloatTag::getTagName()
+	{
+		return name;
+	}
+
+	inline void FloatTag::writeData(BinaryOutputStream& bos)
+	{
+		bos.writeByte(getID());
+		// Memory only stream
+		BinaryOutputStream tempBOS = bos.child();
+		tempBOS.writeName(name);
+		tempBOS.writeFloat(value);
+
+		bos.writeLength(tempBOS.length());
+		bos.writeByte(tempBOS.getArray(), tempBOS.length());
+		tempBOS.close();
+	}
+
+
+	inline Tag<float> FloatTag::createFromData(byte value[], int length)
+	{
+		this->value = *reinterpret_cast<float*>(*value);
+		return *this;
+	}
+
+
+	inline byte FloatTag::getID()
+	{
+		return 3;
+	}
+
+	/******************************
+
+		Int Tag
+
+	*******************************
+	*/
+	class IntTag : public Tag<int> {
+	private:
+		TagName name;
+		int value;
+
+	public:
+		IntTag(std::string name, int value);
+		IntTag(TagName name, int value);
+		~IntTag();
+
+		void setValue(int b);
+		int getValue();
+		void setName(std::string);
+		std::string getName();
+		TagName getTagName();
+
+		void writeData(BinaryOutputStream& bos);
+		Tag<int> createFromData(byte value[], int length);
+		byte getID();
+	};
+
+	inline IntTag::IntTag(std::string name, int value)
+	{
+		this->name = TagName(name);
+		this->value = value;
+	}
+
+	inline IntTag::IntTag(TagName name, int value)
+	{
+		this->name = name;
+		this->value = value;
+	}
+
+	inline IntTag::~IntTag()
+	{
+	}
+
+	inline void IntTag::setValue(int b)
+	{
+		this->value = b;
+	}
+
+	inline int IntTag::getValue()
+	{
+		return value;
+	}
+
+	inline void IntTag::setName(std::string name)
+	{
+		this->name = TagName(name);
+	}
+
+	inline std::string IntTag::getName()
+	{
+		return name.str();
+	}
+
+	inline TagName IntTag::getTagName()
+	{
+		return name;
+	}
+
+	inline void IntTag::writeData(BinaryOutputStream& bos)
+	{
+		bos.writeByte(getID());
+		// Memory only stream
+		BinaryOutputStream tempBOS = bos.child();
+		tempBOS.writeName(name);
+		tempBOS.writeIntValue(value);
+
+		bos.writeLength(tempBOS.length());
+		bos.writeByte(tempBOS.getArray(), tempBOS.length());
+		tempBOS.close();
+	}
+
+
+	inline Tag<int> IntTag::createFromData(byte value[], int length)
+	{
+		this->value = *reinterpret_cast<int*>(*value);
+		return *this;
+	}
+
+
+	inline byte IntTag::getID()
+	{
+		return 2;
+	}
+
+	/******************************
+
+		Invalid Tag
+
+	*******************************
+	*/
+	class InvalidTag : public Tag<byte*> {
+	private:
+		TagName name;
+		byte* value;
+
+	public:
+		InvalidTag(std::string name, byte* value);
+		~InvalidTag();
+
+		void setValue(byte* b);
+		byte* getValue();
+		void setName(std::string);
+		std::string getName();
+		TagName getTagName();
+
+		void writeData(BinaryOutputStream& bos);
+		Tag<byte*> createFromData(byte value[], int length);
+		byte getID();
+	};
+
+	inline InvalidTag::InvalidTag(std::string name, byte* value)
+	{
+		this->name = TagName(name);
+		this->value = value;
+	}
+
+	inline InvalidTag::~InvalidTag()
+	{
+	}
+
+	inline void InvalidTag::setValue(byte* b)
+	{
+		this->value = b;
+	}
+
+	inline byte* InvalidTag::getValue()
+	{
+		return value;
+	}
+
+	inline void InvalidTag::setName(std::string name)
+	{
+		this->name = TagName(name);
+	}
+
+	inline std::string InvalidTag::getName()
+	{
+		return name.str();
+	}
+
+	inline TagName InvalidTag::getTagName()
+	{
+		return name;
+	}
+
+	inline void InvalidTag::writeData(BinaryOutputStream& bos)
+	{
+		throw ODSException("Error: Cannot write an Invalid Tag!");
+	}
+
+
+	inline Tag<byte*> InvalidTag::createFromData(byte value[], int length)
+	{
+		this->value = reinterpret_cast<byte*>(value);
+		return *this;
+	}
+
+
+	inline byte InvalidTag::getID()
+	{
+		return 0;
+	}
+
+	/******************************
+
+		Vector Tag
+		(Replaces this ListTag of the C# and Java versions).
+
+	*******************************
+	*/
+	class VectorTag : public Tag<std::vector<std::shared_ptr <ITag>>> {
+	private:
+		TagName name;
+		std::vector<std::shared_ptr <ITag>> value;
+
+	public:
+		VectorTag(std::string name, std::vector<std::shared_ptr <ITag>> value);
+		VectorTag(TagName name, std::vector<std::shared_ptr <ITag>> value);
+		~VectorTag();
+
+		void setValue(std::vector<std::shared_ptr <ITag>> b);
+		std::vector<std::shared_ptr <ITag>> getValue();
+		void setName(std::string);
+		std::string getName();
+		TagName getTagName();
+
+		void addTag(std::shared_ptr <ITag> tag);
+		void removeTag(std::shared_ptr <ITag> tag);
+		std::shared_ptr <ITag> getTag(int i);
+		void removeAllTags();
+		int indexOf(std::shared_ptr <ITag> tag);
+
+		void writeData(BinaryOutputStream& bos);
+		Tag<std::vector<std::shared_ptr <ITag>>> createFromData(byte value[], int length);
+		byte getID();
+
+		VectorTag& operator+=(ITag* tag) {
+			value.push_back((std::shared_ptr <ITag>) tag);
+			return *this;
+		}
+
+	private:
+		// Write the vector by column or as an integer sequence if the stream allows it and the vector can be
+		// (see Document::columnar() and Document::sequence()). Returns false if it cannot be.
+		bool writeEncoded(BinaryOutputStream& bos);
+	};
+
+	inline VectorTag::VectorTag(std::string name, std::vector<std::shared_ptr <ITag>> value)
+	{
+		this->name = TagName(name);
+		this->value = value;
+	}
+
+	inline VectorTag::VectorTag(TagName name, std::vector<std::shared_ptr <ITag>> value)
+	{
+		this->name = name;
+		this->value = value;
+	}
+
+	inline VectorTag::~VectorTag()
+	{
+		value.clear();
+	}
+
+	inline void VectorTag::setValue(std::vector<std::shared_ptr <ITag>> b)
+	{
+		this->value = b;
+	}
+
+	inline std::vector<std::shared_ptr <ITag>> VectorTag::getValue()
+	{
+		return value;
+	}
+
+	inline void VectorTag::setName(std::string name)
+	{
+		this->name = TagName(name);
+	}
+
+	inline std::string VectorTag::getName()
+	{
+		return name.str();
+	}
+
+	inline TagName VectorTag::getTagName()
+	{
+		return name;
+	}
+
+	inline void VectorTag::addTag(std::shared_ptr <ITag> tag)
+	{
+		value.push_back(tag);
+	}
+
+	inline void VectorTag::removeTag(std::shared_ptr <ITag> tag)
+	{
+		int i = 0;
+		for (std::shared_ptr <ITag> t : value) {
+			if (t == tag)
+				break;
+			i++;
+		}
+		value.erase(value.begin() + i);
+	}
+
+	inline std::shared_ptr <ITag> VectorTag::getTag(int i)
+	{
+		return value[i];
+	}
+
+	inline void VectorTag::removeAllTags()
+	{
+		value.clear();
+	}
+
+	inline int VectorTag::indexOf(std::shared_ptr <ITag> tag)
+	{
+		int i = 0;
+		for (std::shared_ptr <ITag> t : value) {
+			if (t == tag)
+				break;
+			i++;
+		}
+		return i;
+	}
+
+	inline void VectorTag::writeData(BinaryOutputStream& bos)
+	{
+		// (Tags that cannot be renamed, such as a FixedTag, are fine as long as they have no name.)
+		for (std::shared_ptr <ITag> tag : this->value) {
+			if (!tag->getTagName().empty())
+				tag->setName("");
+		}
+		if ((bos.isColumnar() || bos.isSequenceEncoding()) && writeEncoded(bos))
+			return;
+
+		bos.writeByte(getID());
+		// Memory only stream
+		BinaryOutputStream tempBOS = bos.child();
+		tempBOS.writeName(name);
+
+		for (std::shared_ptr <ITag> tag : this->value) {
+			tag->writeData(tempBOS);
+		}
+
+		bos.writeLength(tempBOS.length());
+		bos.writeByte(tempBOS.getArray(), tempBOS.length());
+		tempBOS.close();
+	}
+
+
+	inline Tag<std::vector<std::shared_ptr <ITag>>> VectorTag::createFromData(byte value[], int length)
+	{
+		// TODO Implement this when I make ObjectDataStructure.getListData(value, length);
+		throw ODSException("NOT IMPLEMENTED");
+	}
+
+
+	inline byte VectorTag::getID()
+	{
+		return 9;
+	}
+
+	/******************************
+
+		Long Tag
+
+	*******************************
+	*/
+	class LongTag : public Tag<long> {
+	private:
+		TagName name;
+		long value;
+
+	public:
+		LongTag(std::string name, long value);
+		LongTag(TagName name, long value);
+		~LongTag();
+
+		void setValue(long b);
+		long getValue();
+		void setName(std::string);
+		std::string getName();
+		TagName getTagName();
+
+		void writeData(BinaryOutputStream& bos);
+		Tag<long> createFromData(byte value[], int length);
+		byte getID();
+	};
+
+	inline LongTag::LongTag(std::string name, long value)
+	{
+		this->name = TagName(name);
+		this->value = value;
+	}
+
+	inline LongTag::LongTag(TagName name, long value)
+	{
+		this->name = name;
+		this->value = value;
+	}
+
+	inline LongTag::~LongTag()
+	{
+	}
+
+	inline void LongTag::setValue(long b)
+	{
+		this->value = b;
+	}
+
+	inline long LongTag::getValue()
+	{
+		return value;
+	}
+
+	inline void LongTag::setName(std::string name)
+	{
+		this->name = TagName(name);
+	}
+
+	inline std::string LongTag::getName()
+	{
+		return name.str();
+	}
+
+	inline TagName LongTag::getTagName()
+	{
+		return name;
+	}
+
+	inline void LongTag::writeData(BinaryOutputStream& bos)
+	{
+		bos.writeByte(getID());
+		// Memory only stream
+		BinaryOutputStream tempBOS = bos.child();
+		tempBOS.writeName(name);
+		tempBOS.writeLongValue(value);
+
+		bos.writeLength(tempBOS.length());
+		bos.writeByte(tempBOS.getArray(), tempBOS.length());
+		tempBOS.close();
+	}
+
+
+	inline Tag<long> LongTag::createFromData(byte value[], int length)
+	{
+		this->value = reinterpret_cast<long>(value);
+		return *this;
+	}
+
+
+	inline byte LongTag::getID()
+	{
+		return 6;
+	}
+
+	/******************************
+
+		String Tag
+		(The value is the UTF-8 bytes of the string, which fill the rest of the tag.)
+
+	*******************************
+	*/
+	class StringTag : public Tag<std::string> {
+	private:
+		TagName name;
+		std::string value;
+
+	public:
+		StringTag(std::string name, std::string value);
+		StringTag(TagName name, std::string value);
+		~StringTag();
+
+		void setValue(std::string b);
+		std::string getValue();
+		void setName(std::string);
+		std::string getName();
+		TagName getTagName();
+
+		void writeData(BinaryOutputStream& bos);
+		Tag<std::string> createFromData(byte value[], int length);
+		byte getID();
+	};
+
+	inline StringTag::StringTag(std::string name, std::string value)
+	{
+		this->name = TagName(name);
+		this->value = value;
+	}
+
+	inline StringTag::StringTag(TagName name, std::string value)
+	{
+		this->name = name;
+		this->value = value;
+	}
+
+	inline StringTag::~StringTag()
+	{
+	}
+
+	inline void StringTag::setValue(std::string b)
+	{
+		this->value = b;
+	}
+
+	inline std::string StringTag::getValue()
+	{
+		return value;
+	}
+
+	inline void StringTag::setName(std::string name)
+	{
+		this->name = TagName(name);
+	}
+
+	inline std::string StringTag::getName()
+	{
+		return name.str();
+	}
+
+	inline TagName StringTag::getTagName()
+	{
+		return name;
+	}
+
+	inline void StringTag::writeData(BinaryOutputStream& bos)
+	{
+		bos.writeByte(getID());
+		// Memory only stream
+		BinaryOutputStream tempBOS = bos.child();
+		tempBOS.writeName(name);
+		tempBOS.writeString(value);
+
+		bos.writeLength(tempBOS.length());
+		bos.writeByte(tempBOS.getArray(), tempBOS.length());
+		tempBOS.close();
+	}
+
+
+	inline Tag<std::string> StringTag::createFromData(byte value[], int length)
+	{
+		this->value = std::string(value, length);
+		return *this;
+	}
+
+
+	inline byte StringTag::getID()
+	{
+		return 1;
+	}
+
+	/******************************
+
+		Object Tag
+
+	*******************************
+	*/
+	class ObjectTag : public Tag<std::vector<ITag*>> {
+	private:
+		TagName name;
+		std::vector<ITag*> value;
+
+	public:
+		ObjectTag(std::string name, std::vector<ITag*> value);
+		ObjectTag(std::string name);
+		ObjectTag(TagName name);
+		~ObjectTag();
+
+		void setValue(std::vector<ITag*> b);
+		std::vector<ITag*> getValue();
+		void setName(std::string);
+		std::string getName();
+		TagName getTagName();
+
+		void addTag(ITag* tag);
+		void removeTag(ITag* tag);
+		ITag* getTag(std::string name);
+		ITag* getTag(TagName name);
+		void removeAllTags();
+
+		void writeData(BinaryOutputStream& bos);
+		Tag<std::vector<ITag*>> createFromData(byte value[], int length);
+		byte getID();
+	};
+
+	inline ObjectTag::ObjectTag(std::string name, std::vector<ITag*> value)
+	{
+		this->name = TagName(name);
+		this->value = value;
+	}
+
+	inline ObjectTag::ObjectTag(std::string name) {
+		this->name = TagName(name);
+		this->value = std::vector<ITag*>();
+	}
+
+	inline ObjectTag::ObjectTag(TagName name) {
+		this->name = name;
+		this->value = std::vector<ITag*>();
+	}
+
+	inline ObjectTag::~ObjectTag()
+	{
+		value.clear();
+	}
+
+	inline void ObjectTag::setValue(std::vector<ITag*> b)
+	{
+		this->value = b;
+	}
+
+	inline std::vector<ITag*> ObjectTag::getValue()
+	{
+		return value;
+	}
+
+	inline void ObjectTag::setName(std::string name)
+	{
+		this->name = TagName(name);
+	}
+
+	inline std::string ObjectTag::getName()
+	{
+		return name.str();
+	}
+
+	inline TagName ObjectTag::getTagName()
+	{
+		return name;
+	}
+
+	inline void ObjectTag::addTag(ITag* tag)
+	{
+		value.push_back(std::move(tag));
+	}
+
+	inline void ObjectTag::removeTag(ITag* tag)
+	{
+		int i = 0;
+		for (ITag* t : value) {
+			if (t == tag)
+				break;
+			i++;
+		}
+		value.erase(value.begin() + i);
+	}
+
+	// The lookup does not add name to the NameTable.
+	inline ITag* ObjectTag::getTag(std::string name)
+	{
+		for (ITag* tag : value) {
+			if (tag->getTagName().str() == name)
+				return tag;
+		}
+		return NULL;
+	}
+
+	inline ITag* ObjectTag::getTag(TagName name)
+	{
+		for (ITag* tag : value) {
+			if (tag->getTagName() == name)
+				return tag;
+		}
+		return NULL;
+	}
+
+	inline void ObjectTag::removeAllTags()
+	{
+		value.clear();
+	}
+
+	inline void ObjectTag::writeData(BinaryOutputStream& bos)
+	{
+		bos.writeByte(getID());
+		// Memory only stream
+		BinaryOutputStream tempBOS = bos.child();
+		tempBOS.writeName(name);
+
+		for (ITag* tag : this->value) {
+			tag->writeData(tempBOS);
+		}
+
+		bos.writeLength(tempBOS.length());
+		bos.writeByte(tempBOS.getArray(), tempBOS.length());
+		tempBOS.close();
+	}
+
+
+	inline Tag<std::vector<ITag*>> ObjectTag::createFromData(byte value[], int length)
+	{
+		// TODO Implement this when I make ObjectDataStructure.getListData(value, length);
+		throw ODSException("NOT IMPLEMENTED");
+	}
+
+
+	inline byte ObjectTag::getID()
+	{
+		return 11;
+	}
+
+	/******************************
+
+		Compressed Object Tag
+
+	*******************************
+	*/
+	// An ObjectTag whose children are compressed on their own, so a large part of a file that is rarely read
+	// can be compressed while the rest of the file stays uncompressed (and can be read and changed in place).
+	// The value is the name followed by the children compressed as one ZLIB stream, GZIP member, or FAST or ADAPTIVE
+	// frame. The type is found from the compressed data when it is read (see detectCompression()).
+	//
+	// ObjectDataStructure::get() only decompresses a CompressedObjectTag if the key is inside of it, all other tags
+	// skip over it. Keys inside of it cannot be changed by set(), replace() or remove() (they throw an ODSException);
+	// replace the whole tag instead.
+	// (A VectorTag can be compressed by adding it to a CompressedObjectTag.)
+	class CompressedObjectTag : public Tag<std::vector<ITag*>> {
+	private:
+		TagName name;
+		std::vector<ITag*> value;
+		CompressionType compression;
+		int level;
+
+	public:
+		// The compression can be any type except CompressionType::NONE, and the level is the deflate level (0 to 9).
+		CompressedObjectTag(std::string name, std::vector<ITag*> value, CompressionType compression = CompressionType::GZIP, int level = MZ_DEFAULT_LEVEL);
+		CompressedObjectTag(std::string name, CompressionType compression = CompressionType::GZIP, int level = MZ_DEFAULT_LEVEL);
+		CompressedObjectTag(TagName name, CompressionType compression = CompressionType::GZIP, int level = MZ_DEFAULT_LEVEL);
+		~CompressedObjectTag();
+
+		void setValue(std::vector<ITag*> b);
+		std::vector<ITag*> getValue();
+		void setName(std::string);
+		std::string getName();
+		TagName getTagName();
+
+		void setCompression(CompressionType compression, int level = MZ_DEFAULT_LEVEL);
+		CompressionType getCompression();
+		int getLevel();
+
+		void addTag(ITag* tag);
+		void removeTag(ITag* tag);
+		ITag* getTag(std::string name);
+		ITag* getTag(TagName name);
+		void removeAllTags();
+
+		void writeData(BinaryOutputStream& bos);
+		Tag<std::vector<ITag*>> createFromData(byte value[], int length);
+		byte getID();
+	};
+
+	inline CompressedObjectTag::CompressedObjectTag(std::string name, std::vector<ITag*> value, CompressionType compression, int level)
+	{
+		this->name = TagName(name);
+		this->value = value;
+		setCompression(compression, level);
+	}
+
+	inline CompressedObjectTag::CompressedObjectTag(std::string name, CompressionType compression, int level)
+		: CompressedObjectTag(name, std::vector<ITag*>(), compression, level)
+	{
+	}
+
+	inline CompressedObjectTag::CompressedObjectTag(TagName name, CompressionType compression, int level)
+	{
+		this->name = name;
+		setCompression(compression, level);
+	}
+
+	inline CompressedObjectTag::~CompressedObjectTag()
+	{
+		value.clear();
+	}
+
+	inline void CompressedObjectTag::setValue(std::vector<ITag*> b)
+	{
+		this->value = b;
+	}
+
+	inline std::vector<ITag*> CompressedObjectTag::getValue()
+	{
+		return value;
+	}
+
+	inline void CompressedObjectTag::setName(std::string name)
+	{
+		this->name = TagName(name);
+	}
+
+	inline std::string CompressedObjectTag::getName()
+	{
+		return name.str();
+	}
+
+	inline TagName CompressedObjectTag::getTagName()
+	{
+		return name;
+	}
+
+	inline void CompressedObjectTag::setCompression(CompressionType compression, int level)
+	{
+		if (compression == CompressionType::NONE)
+			throw ODSException("Error: A CompressedObjectTag must be compressed!");
+		if (level < 0 || level > 9)
+			throw ODSException("Error: The compression level must be from 0 to 9!");
+		this->compression = compression;
+		this->level = level;
+	}
+
+	inline CompressionType CompressedObjectTag::getCompression()
+	{
+		return compression;
+	}
+
+	inline int CompressedObjectTag::getLevel()
+	{
+		return level;
+	}
+
+	inline void CompressedObjectTag::addTag(ITag* tag)
+	{
+		value.push_back(tag);
+	}
+
+	inline void CompressedObjectTag::removeTag(ITag* tag)
+	{
+		value.erase(std::remove(value.begin(), value.end(), tag), value.end());
+	}
+
+	inline ITag* CompressedObjectTag::getTag(std::string name)
+	{
+		for (ITag* tag : value) {
+			if (tag->getTagName().str() == name)
+				return tag;
+		}
+		return NULL;
+	}
+
+	inline ITag* CompressedObjectTag::getTag(TagName name)
+	{
+		for (ITag* tag : value) {
+			if (tag->getTagName() == name)
+				return tag;
+		}
+		return NULL;
+	}
+
+	inline void CompressedObjectTag::removeAllTags()
+	{
+		value.clear();
+	}
+
+	inline void CompressedObjectTag::writeData(BinaryOutputStream& bos)
+	{
+		bos.writeByte(getID());
+		// Memory only stream
+		BinaryOutputStream tempBOS = bos.child();
+		tempBOS.writeName(name);
+
+		// The children are written in the format of the stream (with the same name dictionary), and then compressed.
+		BinaryOutputStream body = bos.child();
+		for (ITag* tag : this->value) {
+			tag->writeData(body);
+		}
+		std::vector<byte> compressed = compressBytes(compression, body.getArray(), body.length(), defaultCompressionThreshold, level);
+		tempBOS.writeByte(compressed.data(), (int)compressed.size());
+
+		bos.writeLength(tempBOS.length());
+		bos.writeByte(tempBOS.getArray(), tempBOS.length());
+		tempBOS.close();
+	}
+
+
+	inline Tag<std::vector<ITag*>> CompressedObjectTag::createFromData(byte /*value*/[], int /*length*/)
+	{
+		throw ODSException("NOT IMPLEMENTED");
+	}
+
+
+	inline byte CompressedObjectTag::getID()
+	{
+		return 12;
+	}
+
+
+	/*
+	===========================================
+
+	Integer Sequences
+
+	===========================================
+	*/
+	// A VectorTag of IntTags or LongTags can be written as an integer sequence (tag id 15, see Document::sequence()).
+	// Its value is the id of the elements, the number of elements (a length), the encoding, and the encoded values:
+	//
+	// PACKED: a zigzag varint with the smallest value, the bit width, and then every value minus the smallest, packed.
+	// DELTA: zigzag varints with the first value and the smallest difference between neighbours, the bit width,
+	//        and then every difference minus the smallest, packed. (For sorted values such as timestamps.)
+	//        The width is only 0 if all of the values are equal, so a range like 1, 2, 3... is packed with 1 bit.
+	// RUNS: a varint with the number of runs, and then the value (a zigzag varint) and length (a varint) of every run.
+	//
+	// Packed values are width bits each. Widths of up to 32 bits are packed in blocks of 128 values made of four
+	// 32 bit lanes (value i of a block is in lane i % 4), so all four lanes are unpacked with the same shifts.
+	// The values after the last whole block, and values wider than 32 bits, are packed one after the other
+	// starting from the lowest bit. Everything that is packed is little endian.
+	enum class SequenceEncoding {
+		PACKED = 0,
+		DELTA = 1,
+		RUNS = 2
+	};
+
+	const int sequenceBlockSize = 128;
+
+	// The encoding that planSequence() chose for a sequence.
+	struct SequencePlan {
+		SequenceEncoding encoding;
+		// The smallest value (PACKED) or the first value (DELTA).
+		long long base;
+		// The smallest difference between neighbours (DELTA).
+		long long step;
+		int width;
+		// The number of bytes after the encoding.
+		long long size;
+	};
+
+	// The number of bits needed to store value.
+	inline int bitWidth(unsigned long long value)
+	{
+		int width = 0;
+		while (value != 0) {
+			value >>= 1;
+			width++;
+		}
+		return width;
+	}
+
+	// The number of bytes that count values of width bits are packed into.
+	inline long long packedSize(unsigned long long count, int width)
+	{
+		if (width > 32)
+			return ((long long)count * width + 7) / 8;
+		return (long long)(count / sequenceBlockSize) * 16 * width + ((long long)(count % sequenceBlockSize) * width + 7) / 8;
+	}
+
+	// Pack count values of width bits to the end of out.
+	inline void packValues(const unsigned long long* values, size_t count, int width, std::vector<byte>& out)
+	{
+		size_t i = 0;
+		if (width <= 32) {
+			for (; i + sequenceBlockSize <= count; i += sequenceBlockSize) {
+				unsigned int lanes[32][4] = {};
+				for (int k = 0; k < 32; k++) {
+					int word = (k * width) >> 5;
+					int shift = (k * width) & 31;
+					for (int j = 0; j < 4; j++) {
+						unsigned long long value = values[i + 4 * k + j];
+						lanes[word][j] |= (unsigned int)(value << shift);
+						if (shift + width > 32)
+							lanes[word + 1][j] |= (unsigned int)(value >> (32 - shift));
+					}
+				}
+				for (int word = 0; word < width; word++) {
+					for (int j = 0; j < 4; j++) {
+						for (int b = 0; b < 32; b += 8)
+							out.push_back((byte)(lanes[word][j] >> b));
+					}
+				}
+			}
+		}
+		unsigned long long buffer = 0;
+		int bits = 0;
+		for (; i < count; i++) {
+			unsigned long long value = values[i];
+			// At most 32 bits are added at a time, so the buffer never has more than 39 bits.
+			for (int remaining = width; remaining > 0;) {
+				int take = std::min(remaining, 32);
+				buffer |= (value & ((1ULL << take) - 1)) << bits;
+				value >>= take;
+				bits += take;
+				remaining -= take;
+				for (; bits >= 8; bits -= 8) {
+					out.push_back((byte)buffer);
+					buffer >>= 8;
+				}
+			}
+		}
+		if (bits > 0)
+			out.push_back((byte)buffer);
+	}
+
+	// Unpack a block of 128 values of width bits (1 to 32).
+	inline void unpackBlock(const byte* data, int width, unsigned long long* out)
+	{
+#ifdef ODS_SSE2
+		const __m128i* in = reinterpret_cast<const __m128i*>(data);
+		const __m128i mask = _mm_set1_epi32(width == 32 ? -1 : (int)((1u << width) - 1));
+		const __m128i zero = _mm_setzero_si128();
+		__m128i word = _mm_loadu_si128(in++);
+		int shift = 0;
+		for (int k = 0; k < 32; k++) {
+			// Four values at once: one from every lane.
+			__m128i value = _mm_srl_epi32(word, _mm_cvtsi32_si128(shift));
+			shift += width;
+			if (shift >= 32 && k < 31) {
+				shift -= 32;
+				word = _mm_loadu_si128(in++);
+				if (shift > 0)
+					value = _mm_or_si128(value, _mm_sll_epi32(word, _mm_cvtsi32_si128(width - shift)));
+			}
+			value = _mm_and_si128(value, mask);
+			_mm_storeu_si128(reinterpret_cast<__m128i*>(out + 4 * k), _mm_unpacklo_epi32(value, zero));
+			_mm_storeu_si128(reinterpret_cast<__m128i*>(out + 4 * k + 2), _mm_unpackhi_epi32(value, zero));
+		}
+#else
+		const unsigned char* b = reinterpret_cast<const unsigned char*>(data);
+		auto lane = [b](int word, int j) {
+			const unsigned char* p = b + (word * 4 + j) * 4;
+			return (unsigned long long)p[0] | ((unsigned long long)p[1] << 8) | ((unsigned long long)p[2] << 16) | ((unsigned long long)p[3] << 24);
+		};
+		unsigned long long mask = (1ULL << width) - 1;
+		for (int k = 0; k < 32; k++) {
+			int word = (k * width) >> 5;
+			int shift = (k * width) & 31;
+			for (int j = 0; j < 4; j++) {
+				unsigned long long value = lane(word, j) >> shift;
+				if (shift + width > 32)
+					value |= lane(word + 1, j) << (32 - shift);
+				out[4 * k + j] = value & mask;
+			}
+		}
+#endif
+	}
+
+	// Unpack count values of width bits from data, which must have packedSize(count, width) bytes.
+	inline void unpackValues(const byte* data, size_t count, int width, unsigned long long* out)
+	{
+		if (width == 0) {
+			std::fill(out, out + count, 0);
+			return;
+		}
+		size_t i = 0;
+		if (width <= 32) {
+			for (; i + sequenceBlockSize <= count; i += sequenceBlockSize) {
+				unpackBlock(data, width, out + i);
+				data += 16 * width;
+			}
+		}
+		const unsigned char* b = reinterpret_cast<const unsigned char*>(data);
+		unsigned long long buffer = 0;
+		int bits = 0;
+		for (; i < count; i++) {
+			unsigned long long value = 0;
+			for (int done = 0; done < width;) {
+				int take = std::min(width - done, 32);
+				for (; bits < take; bits += 8)
+					buffer |= (unsigned long long)*b++ << bits;
+				value |= (buffer & ((1ULL << take) - 1)) << done;
+				buffer >>= take;
+				bits -= take;
+				done += take;
+			}
+			out[i] = value;
+		}
+	}
+
+	// Choose the encoding that writes values in the fewest bytes. (values must not be empty.)
+	// The differences are calculated with unsigned math so that they wrap around instead of overflowing.
+	inline SequencePlan planSequence(const std::vector<long long>& values)
+	{
+		size_t count = values.size();
+		long long low = values[0];
+		long long high = values[0];
+		long long lowStep = 0;
+		long long highStep = 0;
+		long long runsSize = 0;
+		unsigned long long runs = 0;
+		size_t runStart = 0;
+		for (size_t i = 1; i < count; i++) {
+			low = std::min(low, values[i]);
+			high = std::max(high, values[i]);
+			long long step = (long long)((unsigned long long)values[i] - (unsigned long long)values[i - 1]);
+			lowStep = i == 1 ? step : std::min(lowStep, step);
+			highStep = i == 1 ? step : std::max(highStep, step);
+			if (values[i] != values[runStart]) {
+				runsSize += varintSize(zigzagEncode(values[runStart])) + varintSize(i - runStart);
+				runs++;
+				runStart = i;
+			}
+		}
+		runsSize += varintSize(zigzagEncode(values[runStart])) + varintSize(count - runStart);
+		runsSize += varintSize(runs + 1);
+
+		SequencePlan plan = SequencePlan();
+		plan.encoding = SequenceEncoding::PACKED;
+		plan.base = low;
+		plan.width = bitWidth((unsigned long long)high - (unsigned long long)low);
+		plan.size = varintSize(zigzagEncode(low)) + 1 + packedSize(count, plan.width);
+		if (count > 1) {
+			// A width of 0 is only used if all of the values are equal. Any other range is packed with at least 1 bit,
+			// so a corrupt count cannot make a reader create more than 8 values for every byte.
+			int width = std::max(bitWidth((unsigned long long)highStep - (unsigned long long)lowStep), lowStep != 0 ? 1 : 0);
+			long long size = varintSize(zigzagEncode(values[0])) + varintSize(zigzagEncode(lowStep)) + 1 + packedSize(count - 1, width);
+			if (size < plan.size)
+				plan = SequencePlan{ SequenceEncoding::DELTA, values[0], lowStep, width, size };
+		}
+		if (runsSize < plan.size)
+			plan = SequencePlan{ SequenceEncoding::RUNS, 0, 0, 0, runsSize };
+		return plan;
+	}
+
+	// Write values with the encoding of plan. (Everything after the encoding byte.)
+	inline void encodeSequence(BinaryOutputStream& bos, const std::vector<long long>& values, const SequencePlan& plan)
+	{
+		size_t count = values.size();
+		std::vector<unsigned long long> offsets;
+		std::vector<byte> packed;
+		switch (plan.encoding) {
+		case SequenceEncoding::PACKED:
+			bos.writeVarint(zigzagEncode(plan.base));
+			bos.writeByte((byte)plan.width);
+			offsets.resize(count);
+			for (size_t i = 0; i < count; i++)
+				offsets[i] = (unsigned long long)values[i] - (unsigned long long)plan.base;
+			packValues(offsets.data(), count, plan.width, packed);
+			break;
+		case SequenceEncoding::DELTA:
+			bos.writeVarint(zigzagEncode(plan.base));
+			bos.writeVarint(zigzagEncode(plan.step));
+			bos.writeByte((byte)plan.width);
+			offsets.resize(count - 1);
+			for (size_t i = 1; i < count; i++)
+				offsets[i - 1] = (unsigned long long)values[i] - (unsigned long long)values[i - 1] - (unsigned long long)plan.step;
+			packValues(offsets.data(), count - 1, plan.width, packed);
+			break;
+		case SequenceEncoding::RUNS: {
+			std::vector<size_t> starts;
+			for (size_t i = 0; i < count; i++) {
+				if (i == 0 || values[i] != values[i - 1])
+					starts.push_back(i);
+			}
+			bos.writeVarint(starts.size());
+			for (size_t i = 0; i < starts.size(); i++) {
+				bos.writeVarint(zigzagEncode(values[starts[i]]));
+				bos.writeVarint((i + 1 < starts.size() ? starts[i + 1] : count) - starts[i]);
+			}
+			break;
+		}
+		}
+		if (!packed.empty())
+			bos.writeByte(packed.data(), (int)packed.size());
+	}
+
+	// Check that the encoded values of a sequence of count values (count must be at least 1) are exactly size bytes.
+	inline bool checkSequence(SequenceEncoding encoding, const byte* data, long size, unsigned long long count)
+	{
+		long position = 0;
+		unsigned long long value;
+		auto varint = [&]() {
+			int varintSize = decodeVarint(data + position, size - position, value);
+			position += varintSize;
+			return varintSize != 0;
+		};
+		switch (encoding) {
+		case SequenceEncoding::PACKED:
+		case SequenceEncoding::DELTA: {
+			if (!varint() || (encoding == SequenceEncoding::DELTA && !varint()) || position >= size)
+				return false;
+			// A DELTA sequence of width 0 is only valid if all of its values are equal (see planSequence()).
+			long long step = zigzagDecode(value);
+			int width = (unsigned char)data[position++];
+			unsigned long long packed = encoding == SequenceEncoding::DELTA ? count - 1 : count;
+			if (encoding == SequenceEncoding::DELTA && width == 0 && count > 1 && step != 0)
+				return false;
+			return width <= 64 && packedSize(packed, width) == size - position;
+		}
+		case SequenceEncoding::RUNS: {
+			if (!varint())
+				return false;
+			unsigned long long runs = value;
+			unsigned long long total = 0;
+			for (unsigned long long i = 0; i < runs; i++) {
+				if (!varint() || !varint() || value == 0 || value > count - total)
+					return false;
+				total += value;
+			}
+			return total == count && position == size;
+		}
+		default:
+			return false;
+		}
+	}
+
+	// Decode a sequence that checkSequence() accepted into out, which must have room for count values.
+	inline void decodeSequence(SequenceEncoding encoding, const byte* data, long size, size_t count, long long* out)
+	{
+		long position = 0;
+		unsigned long long value;
+		auto varint = [&]() {
+			position += decodeVarint(data + position, size - position, value);
+			return value;
+		};
+		// The values are unpacked in place, long long and unsigned long long can point to the same memory.
+		unsigned long long* values = reinterpret_cast<unsigned long long*>(out);
+		switch (encoding) {
+		case SequenceEncoding::PACKED: {
+			unsigned long long base = (unsigned long long)zigzagDecode(varint());
+			int width = (unsigned char)data[position++];
+			unpackValues(data + position, count, width, values);
+			for (size_t i = 0; i < count; i++)
+				values[i] += base;
+			break;
+		}
+		case SequenceEncoding::DELTA: {
+			unsigned long long first = (unsigned long long)zigzagDecode(varint());
+			unsigned long long step = (unsigned long long)zigzagDecode(varint());
+			int width = (unsigned char)data[position++];
+			unpackValues(data + position, count - 1, width, values + 1);
+			values[0] = first;
+			for (size_t i = 1; i < count; i++)
+				values[i] += values[i - 1] + step;
+			break;
+		}
+		case SequenceEncoding::RUNS: {
+			unsigned long long runs = varint();
+			size_t i = 0;
+			for (unsigned long long run = 0; run < runs; run++) {
+				long long runValue = zigzagDecode(varint());
+				size_t length = (size_t)varint();
+				std::fill(out + i, out + i + length, runValue);
+				i += length;
+			}
+			break;
+		}
+		}
+	}
+
+	/*
+	===========================================
+
+	Float Series
+
+	===========================================
+	*/
+	// A VectorTag of FloatTags or DoubleTags can be written as a float series (tag id 16, see Document::series()).
+	// Its value is the id of the elements, the number of elements (a length), and then the values as a bit stream
+	// (highest bit first) using the XOR encoding of Facebook's Gorilla:
+	//
+	// The first value is written whole (32 or 64 bits). Every other value is XORed with the one before it. Then:
+	// '0' if the XOR is 0 (the same value),
+	// '10' and the meaningful bits if they fit inside of the meaningful bits of the last XOR that used '11',
+	// '11', the number of leading zeros (5 bits, at most 31), the number of meaningful bits minus 1
+	//       (5 bits for floats, 6 for doubles), and then the meaningful bits.
+	// The meaningful bits are the bits between the leading and trailing zeros of the XOR.
+	// Neighbouring values in a series usually share the sign, exponent and the top of the mantissa, so most XORs are short.
+
+	// Writes bits to a stream highest bit first.
+	class SeriesWriter {
+	public:
+		// out can be NULL to only count the bytes.
+		SeriesWriter(std::vector<byte>* out) : out(out), buffer(0), bits(0), total(0) {}
+
+		// Write the lowest count bits (up to 64) of value.
+		void write(unsigned long long value, int count)
+		{
+			if (count > 32) {
+				write(value >> 32, count - 32);
+				count = 32;
+			}
+			total += count;
+			if (out == NULL)
+				return;
+			// At most 32 bits are added to the 7 bits that are left, so nothing is lost from the buffer.
+			buffer = (buffer << count) | (value & ((1ULL << count) - 1));
+			bits += count;
+			for (; bits >= 8; bits -= 8)
+				out->push_back((byte)(buffer >> (bits - 8)));
+		}
+
+		// The number of bytes, including the last partial byte. (The rest of it is written as 0.)
+		long long finish()
+		{
+			if (out != NULL && bits > 0)
+				out->push_back((byte)(buffer << (8 - bits)));
+			bits = 0;
+			return (total + 7) / 8;
+		}
+
+	private:
+		std::vector<byte>* out;
+		unsigned long long buffer;
+		int bits;
+		long long total;
+	};
+
+	// Reads bits that a SeriesWriter wrote. Bits past the end are read as 0, check overrun() when done.
+	class SeriesReader {
+	public:
+		SeriesReader(const byte* data, long size)
+			: data(reinterpret_cast<const unsigned char*>(data)), size(size), position(0), window(0), bits(0), total(0) {}
+
+		// Read count bits (up to 64).
+		unsigned long long read(int count)
+		{
+			if (count > 32) {
+				unsigned long long high = read(count - 32);
+				return (high << 32) | read(32);
+			}
+			if (count == 0)
+				return 0;
+			if (bits < count)
+				refill();
+			unsigned long long value = window >> (64 - count);
+			window <<= count;
+			bits -= count;
+			total += count;
+			return value;
+		}
+
+		// Whether more bits were read than there are.
+		bool overrun() const { return total > (long long)size * 8; }
+		// The number of bytes that were read, including the last partial byte.
+		long long used() const { return (total + 7) / 8; }
+
+	private:
+		// The bits are kept at the top of the window, so a read is a single shift.
+		// A refill happens when fewer than 32 bits are left, so 4 more bytes always fit.
+		void refill()
+		{
+			if (size - position >= 4) {
+				unsigned long long word = ((unsigned long long)data[position] << 24) | ((unsigned long long)data[position + 1] << 16)
+					| ((unsigned long long)data[position + 2] << 8) | (unsigned long long)data[position + 3];
+				window |= word << (32 - bits);
+				position += 4;
+				bits += 32;
+				return;
+			}
+			for (; bits <= 56; bits += 8)
+				window |= (unsigned long long)(position < size ? data[position++] : 0) << (56 - bits);
+		}
+
+		const unsigned char* data;
+		long size;
+		long position;
+		unsigned long long window;
+		int bits;
+		long long total;
+	};
+
+	// Encode values, the bits of floats (width 32) or doubles (width 64). Returns the number of bytes.
+	// out can be NULL to only count the bytes.
+	inline long long encodeSeries(const std::vector<unsigned long long>& values, int width, std::vector<byte>* out)
+	{
+		SeriesWriter writer = SeriesWriter(out);
+		int lengthBits = width == 64 ? 6 : 5;
+		// There is no window until the first '11'.
+		int leading = width;
+		int trailing = 0;
+		writer.write(values[0], width);
+		for (size_t i = 1; i < values.size(); i++) {
+			unsigned long long value = values[i] ^ values[i - 1];
+			if (value == 0) {
+				writer.write(0, 1);
+				continue;
+			}
+			int valueLeading = std::min(countLeadingZeros(value) - (64 - width), 31);
+			int valueTrailing = countTrailingZeros(value);
+			if (leading != width && valueLeading >= leading && valueTrailing >= trailing) {
+				writer.write(2, 2);
+				writer.write(value >> trailing, width - leading - trailing);
+				continue;
+			}
+			leading = valueLeading;
+			trailing = valueTrailing;
+			int length = width - leading - trailing;
+			writer.write(3, 2);
+			writer.write(leading, 5);
+			writer.write(length - 1, lengthBits);
+			writer.write(value >> trailing, length);
+		}
+		return writer.finish();
+	}
+
+	// Decode count values (count must be at least 1) of width bits from a series that is exactly size bytes.
+	// out can be NULL to only check the series. Returns false if the series is malformed.
+	inline bool decodeSeries(const byte* data, long size, size_t count, int width, unsigned long long* out)
+	{
+		SeriesReader reader = SeriesReader(data, size);
+		int lengthBits = width == 64 ? 6 : 5;
+		int leading = width;
+		int trailing = 0;
+		unsigned long long value = reader.read(width);
+		if (out != NULL)
+			out[0] = value;
+		for (size_t i = 1; i < count; i++) {
+			if (reader.read(1) != 0) {
+				if (reader.read(1) != 0) {
+					leading = (int)reader.read(5);
+					int length = (int)reader.read(lengthBits) + 1;
+					if (leading + length > width)
+						return false;
+					trailing = width - leading - length;
+				}
+				else if (leading == width) {
+					return false;
+				}
+				value ^= reader.read(width - leading - trailing) << trailing;
+			}
+			if (out != NULL)
+				out[i] = value;
+			// A corrupt count can only make the loop run until the bits run out.
+			if (reader.overrun())
+				return false;
+		}
+		return !reader.overrun() && reader.used() == size;
+	}
+
+	/*
+	===========================================
+
+	String Dictionaries
+
+	===========================================
+	*/
+	// A VectorTag of StringTags can be written as a string sequence (tag id 17, see Document::strings()), and the
+	// string fields of a columnar vector are written the same way. Repeated strings are only stored once:
+	// a varint with the number of distinct strings, every distinct string (a varint length and the bytes),
+	// the bit width of the indices, and then the index of every string into the dictionary, packed like the values
+	// of an integer sequence (see SequenceEncoding). The width is at least 1 bit, so a corrupt count cannot make a
+	// reader create more than 8 strings for every byte.
+
+	// Write the dictionary of values to the end of out.
+	inline void encodeStrings(const std::vector<std::string_view>& values, std::vector<byte>& out)
+	{
+		std::unordered_map<std::string_view, unsigned long long> indices;
+		std::vector<unsigned long long> packed(values.size());
+		std::vector<std::string_view> distinct;
+		for (size_t i = 0; i < values.size(); i++) {
+			auto found = indices.emplace(values[i], distinct.size());
+			if (found.second)
+				distinct.push_back(values[i]);
+			packed[i] = found.first->second;
+		}
+		byte varint[10];
+		out.insert(out.end(), varint, varint + encodeVarint(varint, distinct.size()));
+		for (std::string_view value : distinct) {
+			out.insert(out.end(), varint, varint + encodeVarint(varint, value.size()));
+			out.insert(out.end(), value.begin(), value.end());
+		}
+		int width = std::max(bitWidth(distinct.size() - 1), 1);
+		out.push_back((byte)width);
+		packValues(packed.data(), packed.size(), width, out);
+	}
+
+	// Decode a dictionary of count strings (count must be at least 1) that is exactly size bytes.
+	// The views in dictionary point into data. dictionary and indices can be NULL to only check it.
+	// Returns false if it is malformed.
+	inline bool decodeStrings(const byte* data, long size, size_t count, std::vector<std::string_view>* dictionary, unsigned int* indices)
+	{
+		long position = 0;
+		unsigned long long distinct;
+		int varintSize = decodeVarint(data, size, distinct);
+		// Every distinct string is at least one byte (its length).
+		if (varintSize == 0 || distinct == 0 || distinct > (unsigned long long)(size - varintSize))
+			return false;
+		position += varintSize;
+		if (dictionary != NULL) {
+			dictionary->clear();
+			dictionary->reserve((size_t)distinct);
+		}
+		for (unsigned long long i = 0; i < distinct; i++) {
+			unsigned long long length;
+			varintSize = decodeVarint(data + position, size - position, length);
+			if (varintSize == 0 || length > (unsigned long long)(size - position - varintSize))
+				return false;
+			position += varintSize;
+			if (dictionary != NULL)
+				dictionary->emplace_back(data + position, (size_t)length);
+			position += (long)length;
+		}
+		if (position >= size)
+			return false;
+		int width = (unsigned char)data[position++];
+		if (width != std::max(bitWidth(distinct - 1), 1) || packedSize(count, width) != size - position)
+			return false;
+		// The indices are unpacked a few blocks at a time, so checking them does not need memory for all of them.
+		const size_t chunk = 8 * sequenceBlockSize;
+		unsigned long long unpacked[chunk];
+		for (size_t i = 0; i < count; i += chunk) {
+			size_t length = std::min(chunk, count - i);
+			// Only the last chunk has values that are not in a whole block, so every chunk starts on a block.
+			unpackValues(data + position + (i / sequenceBlockSize) * 16 * width, length, width, unpacked);
+			for (size_t j = 0; j < length; j++) {
+				if (unpacked[j] >= distinct)
+					return false;
+				if (indices != NULL)
+					indices[i + j] = (unsigned int)unpacked[j];
+			}
+		}
+		return true;
+	}
+
+	/*
+	===========================================
+
+	Document
+
+	===========================================
+	*/
+	// A Node is the compact, non virtual form of a tag that is stored inside of a Document.
+	// The id is the same id that the matching ITag returns from getID().
+	//
+	// For ObjectTags and VectorTags, first is the index of the first child and count is the number of children.
+	// The children of a node are always stored next to each other in the Document.
+	// For StringTags, first and count are the start and length of the string in the Document (see Document::string()).
+	// CompressedObjectTags are containers like ObjectTags, and value.compression is how they are compressed when written.
+	// (The level of a CompressedObjectTag that was read is not known, so it is MZ_DEFAULT_LEVEL.)
+	// (Columnar vectors, integer sequences, float series and string sequences, tag ids 14 to 17, are only ways of
+	// writing a VectorTag. They are read as normal VectorTag nodes.)
+	struct Node {
+		byte id;
+		// The index of the name in the Document's names (see Document::name()). 0 is always the empty name.
+		unsigned int name;
+		unsigned int first;
+		unsigned int count;
+		union {
+			byte b;
+			char c;
+			int i;
+			long long l;
+			float f;
+			double d;
+			struct {
+				CompressionType type;
+				byte level;
+			} compression;
+		} value;
+
+		bool isContainer() const { return id == 9 || id == 11 || id == 12; }
+	};
+
+	// A Document stores a tree of tags as a single vector of Nodes.
+	// The nodes are stored in breadth first order so the children of every container form one contiguous range,
+	// which makes walking the tree cache friendly and avoids an allocation per tag.
+	//
+	// A Document can be created from ITags (and turned back into them), or read straight from bytes.
+	// Every distinct name is stored once per Document, and the nodes hold its index. Names that are read are
+	// transient (see TagName::transient()), so they leave the NameTable with the last Document or tag that uses them.
+	// Note: InvalidTags cannot be stored in a Document.
+	class Document {
+	public:
+		Document();
+		Document(std::vector<ITag*> tags);
+		Document(std::vector<std::shared_ptr<ITag>> tags);
+
+		// Read every tag from the current index of the stream until the end of the stream.
+		// If the stream is at the header of a compact file, the header is read first (see BinaryInputStream::readFormat()).
+		// (Encoded vectors, such as runs of the same integer, can hold many values in a few bytes, so the number
+		// of nodes is limited by BinaryInputStream::getValueLimit() rather than by the size of the data.)
+		// CompressedObjectTags are decompressed as they are read.
+		static Document read(BinaryInputStream& bis);
+
+		size_t size() const;
+		// The number of bytes the document uses in memory. (Interned names are counted as well, although they
+		// belong to the NameTable.)
+		size_t memorySize() const;
+		// The top level nodes are always the first rootCount() nodes.
+		unsigned int rootCount() const;
+		const Node& getNode(unsigned int index) const;
+		const Node* children(const Node& node) const;
+		// The value of a StringTag node. The view stays valid as long as the Document does not change.
+		// (Strings that were dictionary encoded are only stored once, so every node of the same string shares it.)
+		std::string_view string(const Node& node) const;
+		const TagName& name(const Node& node) const;
+
+		// Find a child of a container by name. (Returns NULL if it does not exist.)
+		const Node* find(const Node& parent, TagName name) const;
+		// Find a node using a key. (Example: "Player.Stats.Health")
+		const Node* find(std::string key) const;
+
+		// Convert the document back into tags.
+		// The children of an ObjectTag are allocated with new, just like when creating an ObjectTag normally.
+		std::vector<std::shared_ptr<ITag>> toTags() const;
+		std::shared_ptr<ITag> toTag(const Node& node) const;
+
+		// Write every top level node to the stream in the format of the stream.
+		void writeData(BinaryOutputStream& bos) const;
+
+		// Whether the node is a VectorTag that is written by column when the stream is columnar
+		// (see BinaryOutputStream::setColumnar()). The vector must have at least two unnamed ObjectTags
+		// that all have the same fields (by id and name, in the same order), and every field must be a single value.
+		//
+		// A columnar vector (tag id 14) has the same name as the vector, and then its value is:
+		// the number of rows and fields (lengths), the id and name of every field, and then every field's column:
+		// the length of the column followed by the value of the field in every row. (String fields are written as
+		// a dictionary of the distinct strings instead, see encodeStrings().)
+		// The rows come back as normal ObjectTags when the vector is read.
+		bool columnar(const Node& node) const;
+		// Whether the node is a VectorTag that is written as an integer sequence (tag id 15, see SequenceEncoding)
+		// when the stream encodes sequences (see BinaryOutputStream::setSequenceEncoding()).
+		// The vector must have at least two unnamed IntTags, or at least two unnamed LongTags.
+		bool sequence(const Node& node) const;
+		// Whether the node is a VectorTag that is written as a float series (tag id 16, see encodeSeries()) when
+		// the stream encodes sequences. The vector must have at least two unnamed FloatTags, or at least two unnamed DoubleTags.
+		bool series(const Node& node) const;
+		// Whether the node is a VectorTag that is written as a string sequence (tag id 17, see encodeStrings()) when
+		// the stream encodes sequences. The vector must have at least two unnamed StringTags.
+		bool strings(const Node& node) const;
+		// The id that node is written with to bos: 14 for columnar vectors, 15 for integer sequences,
+		// 16 for float series, 17 for string sequences, and the id of the node for everything else.
+		byte writtenId(const Node& node, BinaryOutputStream& bos) const;
+
+	private:
+		// The id of rows of a columnar vector while the document is being read. (Their fields are already read.)
+		static const byte columnRow = -11;
+
+		void addNode(ITag* tag);
+		// The index of a name in names, which is added if the document does not have it yet.
+		unsigned int addName(std::string_view name);
+		unsigned int addName(const TagName& name);
+		const Node* find(const Node& parent, unsigned int name) const;
+		// Read the tags of the stream from the current index, and then the children of every container.
+		void readBody(BinaryInputStream& bis);
+		void readTags(BinaryInputStream& bis, long start, long end);
+		void readCompressed(BinaryInputStream& bis, unsigned int index);
+		// Whether count more nodes stay within the value limit of the stream (see BinaryInputStream::setValueLimit()).
+		bool withinLimit(BinaryInputStream& bis, unsigned long long count) const;
+		void readColumns(BinaryInputStream& bis, unsigned int index);
+		void readSequence(BinaryInputStream& bis, unsigned int index);
+		void readSeries(BinaryInputStream& bis, unsigned int index);
+		void readStrings(BinaryInputStream& bis, unsigned int index);
+		bool readStrings(const byte* data, long size, Node* target, size_t count, size_t stride);
+		static bool readValue(BinaryInputStream& bis, Node& node, long end);
+		ITag* createTag(const Node& node) const;
+		static int valueLength(const Node& node, Format format);
+		// The compressed children of CompressedObjectTag nodes, made by dataLength() for writeNode().
+		typedef std::unordered_map<const Node*, std::vector<byte>> CompressedBodies;
+		int dataLength(const Node& node, std::vector<int>& lengths, CompressedBodies& compressed, BinaryOutputStream& bos) const;
+		void writeValue(BinaryOutputStream& bos, const Node& node) const;
+		void writeNode(BinaryOutputStream& bos, const Node& node, const std::vector<int>& lengths, const CompressedBodies& compressed) const;
+		void writeColumns(BinaryOutputStream& bos, const Node& node) const;
+		std::vector<long long> sequenceValues(const Node& node) const;
+		std::vector<unsigned long long> seriesValues(const Node& node) const;
+		// The dictionary of the strings of a string sequence, or of a string field of a columnar vector.
+		std::vector<byte> stringValues(const Node& node, unsigned int field) const;
+
+		std::vector<Node> nodes;
+		unsigned int roots;
+		// The values of every StringTag node.
+		std::string stringData;
+		// Every distinct name of the nodes, and the index of every name by its string (for names that are read,
+		// and keys) and by its NameTable id (for TagNames). (The keys point into the strings of names, which never move.)
+		std::vector<TagName> names;
+		std::unordered_map<std::string_view, unsigned int> nameIndices;
+		std::unordered_map<unsigned int, unsigned int> nameIds;
+	};
+
+	inline Document::Document()
+	{
+		roots = 0;
+		addName(TagName());
+	}
+
+	inline Document::Document(std::vector<ITag*> tags) : Document()
+	{
+		roots = (unsigned int)tags.size();
+		// The source tag of every node, so the children can be added in breadth first order.
+		std::vector<ITag*> sources = tags;
+		for (ITag* tag : tags) {
+			addNode(tag);
+		}
+		for (size_t i = 0; i < sources.size(); i++) {
+			ITag* tag = sources[i];
+			if (!nodes[i].isContainer())
+				continue;
+			nodes[i].first = (unsigned int)nodes.size();
+			if (tag->getID() == 9) {
+				for (std::shared_ptr<ITag>& child : static_cast<VectorTag*>(tag)->getValue()) {
+					addNode(child.get());
+					sources.push_back(child.get());
+				}
+			}
+			else if (tag->getID() == 12) {
+				for (ITag* child : static_cast<CompressedObjectTag*>(tag)->getValue()) {
+					addNode(child);
+					sources.push_back(child);
+				}
+			}
+			else {
+				for (ITag* child : static_cast<ObjectTag*>(tag)->getValue()) {
+					addNode(child);
+					sources.push_back(child);
+				}
+			}
+			nodes[i].count = (unsigned int)nodes.size() - nodes[i].first;
+		}
+	}
+
+	inline Document::Document(std::vector<std::shared_ptr<ITag>> tags)
+		: Document([&tags]() {
+			std::vector<ITag*> raw;
+			for (std::shared_ptr<ITag>& tag : tags)
+				raw.push_back(tag.get());
+			return raw;
+		}())
+	{
+	}
+
+	inline void Document::addNode(ITag* tag)
+	{
+		Node node = Node();
+		node.id = tag->getID();
+		node.name = addName(tag->getTagName());
+		switch (node.id) {
+		// The values are read through Tag<T>, since a FixedTag has the same id as the tag of its type.
+		case 2: node.value.i = static_cast<Tag<int>*>(tag)->getValue(); break;
+		case 3: node.value.f = static_cast<Tag<float>*>(tag)->getValue(); break;
+		case 4: node.value.d = static_cast<Tag<double>*>(tag)->getValue(); break;
+		case 6: {
+			// (A LongTag is a Tag<long>, but a FixedTag can be either.)
+			Tag<long>* longTag = dynamic_cast<Tag<long>*>(tag);
+			node.value.l = longTag != NULL ? longTag->getValue() : static_cast<Tag<long long>*>(tag)->getValue();
+			break;
+		}
+		case 7: node.value.c = static_cast<Tag<char>*>(tag)->getValue(); break;
+		case 8: node.value.b = static_cast<Tag<byte>*>(tag)->getValue(); break;
+		case 1: {
+			std::string value = static_cast<Tag<std::string>*>(tag)->getValue();
+			node.first = (unsigned int)stringData.size();
+			node.count = (unsigned int)value.size();
+			stringData += value;
+			break;
+		}
+		case 12:
+			node.value.compression.type = static_cast<CompressedObjectTag*>(tag)->getCompression();
+			node.value.compression.level = (byte)static_cast<CompressedObjectTag*>(tag)->getLevel();
+			break;
+		case 11:
+			// The fields of a FixedTag of a struct are not tags.
+			if (dynamic_cast<ObjectTag*>(tag) == NULL)
+				throw ODSException("Error: This tag cannot be stored in a Document!");
+			break;
+		case 9:
+			break;
+		default:
+			throw ODSException("Error: This tag cannot be stored in a Document!");
+		}
+		nodes.push_back(node);
+	}
+
+	inline unsigned int Document::addName(std::string_view name)
+	{
+		auto it = nameIndices.find(name);
+		if (it != nameIndices.end())
+			return it->second;
+		return addName(TagName::transient(name));
+	}
+
+	inline unsigned int Document::addName(const TagName& name)
+	{
+		auto it = nameIds.find(name.index());
+		if (it != nameIds.end())
+			return it->second;
+		unsigned int index = (unsigned int)names.size();
+		names.push_back(name);
+		nameIndices.emplace(names.back().str(), index);
+		nameIds.emplace(name.index(), index);
+		return index;
+	}
+
+	inline Document Document::read(BinaryInputStream& bis)
+	{
+		Document doc;
+		bis.readFormat();
+		doc.readBody(bis);
+		return doc;
+	}
+
+	inline void Document::readBody(BinaryInputStream& bis)
+	{
+		readTags(bis, bis.getIndex(), bis.length());
+		roots = (unsigned int)nodes.size();
+		// CompressedObjectTags are decompressed last, since their children are added already read.
+		std::vector<unsigned int> compressed;
+		for (unsigned int i = 0; i < nodes.size(); i++) {
+			if (nodes[i].id == 14) {
+				readColumns(bis, i);
+				continue;
+			}
+			if (nodes[i].id == 15) {
+				readSequence(bis, i);
+				continue;
+			}
+			if (nodes[i].id == 16) {
+				readSeries(bis, i);
+				continue;
+			}
+			if (nodes[i].id == 17) {
+				readStrings(bis, i);
+				continue;
+			}
+			if (nodes[i].id == 12) {
+				compressed.push_back(i);
+				continue;
+			}
+			if (nodes[i].id == columnRow) {
+				nodes[i].id = 11;
+				continue;
+			}
+			if (!nodes[i].isContainer())
+				continue;
+			// Until the children are read, first and count hold the byte range of the container's body.
+			long start = nodes[i].first;
+			long end = start + nodes[i].count;
+			unsigned int first = (unsigned int)nodes.size();
+			readTags(bis, start, end);
+			nodes[i].first = first;
+			nodes[i].count = (unsigned int)nodes.size() - first;
+		}
+		for (unsigned int index : compressed)
+			readCompressed(bis, index);
+		bis.setIndex(bis.length());
+	}
+
+	// Decompress the children of the CompressedObjectTag at index and add them to the end of the document.
+	inline void Document::readCompressed(BinaryInputStream& bis, unsigned int index)
+	{
+		Node& node = nodes[index];
+		const byte* data = bis.getPointer() - bis.getIndex() + node.first;
+		if (!detectCompression(data, node.count, node.value.compression.type))
+			throw ODSException("Error: The compression of a CompressedObjectTag is unknown!");
+		node.value.compression.level = MZ_DEFAULT_LEVEL;
+		std::vector<byte> body = decompressBytes(node.value.compression.type, data, node.count);
+		// The children are read as a document of their own, in the same format and with the same name dictionary,
+		// and then moved to the end of this one.
+		BinaryInputStream stream = BinaryInputStream(body.data(), (long)body.size());
+		stream.setFormat(bis.getFormat());
+		stream.setNameDictionary(bis.getNameDictionary());
+		stream.setValueLimit(bis.getValueLimit() - std::min(nodes.size(), bis.getValueLimit()));
+		Document children;
+		children.readBody(stream);
+		unsigned int first = (unsigned int)nodes.size();
+		unsigned int stringStart = (unsigned int)stringData.size();
+		for (Node& child : children.nodes) {
+			child.name = addName(children.names[child.name]);
+			if (child.isContainer())
+				child.first += first;
+			else if (child.id == 1)
+				child.first += stringStart;
+			nodes.push_back(child);
+		}
+		stringData += children.stringData;
+		nodes[index].first = first;
+		nodes[index].count = children.roots;
+	}
+
+	// Read every tag between start and end and add them to the end of the document.
+	inline void Document::readTags(BinaryInputStream& bis, long start, long end)
+	{
+		bis.setIndex(start);
+		while (bis.getIndex() < end) {
+			Node node = Node();
+			short nameLength;
+			// The tag is checked once here, so the value can be read without any more checks.
+			long tagEnd = bis.readTagHeader(end, node.id, nameLength);
+			// The checksum footer (see Checksums) is not a tag.
+			if (node.id == 13) {
+				bis.setIndex(tagEnd);
+				continue;
+			}
+			node.name = addName(bis.readTagNameView(nameLength));
+			int size = tagValueSize(node.id, bis.getFormat());
+			if (size >= 0 && tagEnd - bis.getIndex() != size)
+				throw ODSException("Error: The value of a tag is the wrong size!");
+			// (The compressed children of a CompressedObjectTag are read by readCompressed().)
+			if (node.isContainer() || (node.id >= 14 && node.id <= 17)) {
+				node.first = (unsigned int)bis.getIndex();
+				node.count = (unsigned int)(tagEnd - bis.getIndex());
+			}
+			else if (node.id == 1) {
+				node.first = (unsigned int)stringData.size();
+				node.count = (unsigned int)(tagEnd - bis.getIndex());
+				stringData.append(bis.getPointer(), node.count);
+			}
+			else {
+				if (!readValue(bis, node, tagEnd))
+					throw ODSException("Error: Unknown tag id!");
+				// (Varint values must fill the tag exactly as well.)
+				if (bis.getIndex() != tagEnd)
+					throw ODSException("Error: The value of a tag is the wrong size!");
+			}
+			nodes.push_back(node);
+			bis.setIndex(tagEnd);
+		}
+	}
+
+	// Read the value of a ByteTag, IntTag, etc. that ends at end. Returns false if the node is not one of them.
+	inline bool Document::readValue(BinaryInputStream& bis, Node& node, long end)
+	{
+		switch (node.id) {
+		case 2: node.value.i = bis.readIntValue(end); return true;
+		case 3: node.value.f = bis.readFloat(); return true;
+		case 4: node.value.d = bis.readDouble(); return true;
+		case 6: node.value.l = bis.readLongValue(end); return true;
+		case 7: node.value.c = bis.readByte(); return true;
+		case 8: node.value.b = bis.readByte(); return true;
+		default: return false;
+		}
+	}
+
+	inline bool Document::withinLimit(BinaryInputStream& bis, unsigned long long count) const
+	{
+		return nodes.size() + count <= bis.getValueLimit();
+	}
+
+	// Turn the columnar vector at index into a VectorTag node (see columnar()).
+	// The rows and all of their fields are added at once, so the rows are marked as columnRow until read() reaches them.
+	inline void Document::readColumns(BinaryInputStream& bis, unsigned int index)
+	{
+		long end = (long)nodes[index].first + (long)nodes[index].count;
+		bis.setIndex(nodes[index].first);
+		int rows = bis.readLength(end);
+		int fields = bis.readLength(end);
+		if (rows < 2 || fields < 1 || fields > end - bis.getIndex())
+			throw ODSException("Error: The columns of a vector are corrupt!");
+		std::vector<Node> schema(fields);
+		int valueFields = 0;
+		for (Node& field : schema) {
+			if (bis.getIndex() >= end)
+				throw ODSException("Error: The columns of a vector are corrupt!");
+			field.id = bis.readByte();
+			field.name = addName(bis.readName(end));
+			if (field.id != 1 && tagValueSize(field.id) < 0)
+				throw ODSException("Error: The columns of a vector are corrupt!");
+			if (field.id != 1)
+				valueFields++;
+		}
+		// Every value that is not a string is at least one byte, and every string is at least one bit of its column
+		// (see encodeStrings()), which limits how many nodes a corrupt vector can add.
+		if ((long long)rows * valueFields + (valueFields < fields ? rows / 8 : 0) > end - bis.getIndex()
+			|| !withinLimit(bis, (unsigned long long)rows * (fields + 1)))
+			throw ODSException("Error: The columns of a vector are corrupt!");
+		unsigned int first = (unsigned int)nodes.size();
+		unsigned int values = first + rows;
+		nodes.resize(values + (size_t)rows * fields);
+		for (int row = 0; row < rows; row++) {
+			Node& node = nodes[first + row];
+			node.id = columnRow;
+			node.first = values + row * fields;
+			node.count = fields;
+		}
+		for (int field = 0; field < fields; field++) {
+			int size = bis.readLength(end);
+			long columnEnd = bis.getIndex() + size;
+			int valueSize = tagValueSize(schema[field].id, bis.getFormat());
+			if (size > end - bis.getIndex() || (valueSize >= 0 && (long long)valueSize * rows != size))
+				throw ODSException("Error: The columns of a vector are corrupt!");
+			if (schema[field].id == 1) {
+				for (int row = 0; row < rows; row++)
+					nodes[values + row * fields + field] = schema[field];
+				if (!readStrings(bis.getPointer(), size, &nodes[values + field], rows, fields))
+					throw ODSException("Error: The columns of a vector are corrupt!");
+				bis.setIndex(columnEnd);
+				continue;
+			}
+			for (int row = 0; row < rows; row++) {
+				Node& node = nodes[values + row * fields + field];
+				node = schema[field];
+				readValue(bis, node, columnEnd);
+			}
+			if (bis.getIndex() != columnEnd)
+				throw ODSException("Error: The columns of a vector are corrupt!");
+		}
+		if (bis.getIndex() != end)
+			throw ODSException("Error: The columns of a vector are corrupt!");
+		nodes[index].id = 9;
+		nodes[index].first = first;
+		nodes[index].count = rows;
+	}
+
+	// Turn the integer sequence at index into a VectorTag node (see sequence()).
+	inline void Document::readSequence(BinaryInputStream& bis, unsigned int index)
+	{
+		long end = (long)nodes[index].first + (long)nodes[index].count;
+		bis.setIndex(nodes[index].first);
+		if (end - bis.getIndex() < 1)
+			throw ODSException("Error: An integer sequence is corrupt!");
+		byte id = bis.readByte();
+		int count = bis.readLength(end);
+		if (bis.getIndex() >= end)
+			throw ODSException("Error: An integer sequence is corrupt!");
+		SequenceEncoding encoding = (SequenceEncoding)(unsigned char)bis.readByte();
+		const byte* data = bis.getPointer();
+		long size = end - bis.getIndex();
+		if ((id != 2 && id != 6) || count < 1 || !checkSequence(encoding, data, size, count))
+			throw ODSException("Error: An integer sequence is corrupt!");
+		if (!withinLimit(bis, count))
+			throw ODSException("Error: An integer sequence has more values than the value limit!");
+		std::vector<long long> values(count);
+		decodeSequence(encoding, data, size, count, values.data());
+		unsigned int first = (unsigned int)nodes.size();
+		nodes.resize(first + (size_t)count);
+		for (int i = 0; i < count; i++) {
+			Node& node = nodes[first + i];
+			node.id = id;
+			if (id == 2)
+				node.value.i = (int)values[i];
+			else
+				node.value.l = values[i];
+		}
+		bis.setIndex(end);
+		nodes[index].id = 9;
+		nodes[index].first = first;
+		nodes[index].count = count;
+	}
+
+	// Turn the float series at index into a VectorTag node (see series()).
+	inline void Document::readSeries(BinaryInputStream& bis, unsigned int index)
+	{
+		long end = (long)nodes[index].first + (long)nodes[index].count;
+		bis.setIndex(nodes[index].first);
+		if (end - bis.getIndex() < 1)
+			throw ODSException("Error: A float series is corrupt!");
+		byte id = bis.readByte();
+		int count = bis.readLength(end);
+		int width = id == 3 ? 32 : 64;
+		// Every value after the first is at least one bit, which limits how many nodes a corrupt series can add.
+		if ((id != 3 && id != 4) || count < 1 || (count - 1) / 8 > end - bis.getIndex())
+			throw ODSException("Error: A float series is corrupt!");
+		if (!withinLimit(bis, count))
+			throw ODSException("Error: A float series has more values than the value limit!");
+		std::vector<unsigned long long> values(count);
+		if (!decodeSeries(bis.getPointer(), end - bis.getIndex(), count, width, values.data()))
+			throw ODSException("Error: A float series is corrupt!");
+		unsigned int first = (unsigned int)nodes.size();
+		nodes.resize(first + (size_t)count);
+		for (int i = 0; i < count; i++) {
+			Node& node = nodes[first + i];
+			node.id = id;
+			if (id == 3) {
+				unsigned int bits = (unsigned int)values[i];
+				memcpy(&node.value.f, &bits, 4);
+			}
+			else {
+				memcpy(&node.value.d, &values[i], 8);
+			}
+		}
+		bis.setIndex(end);
+		nodes[index].id = 9;
+		nodes[index].first = first;
+		nodes[index].count = count;
+	}
+
+	// Turn the string sequence at index into a VectorTag node (see strings()).
+	inline void Document::readStrings(BinaryInputStream& bis, unsigned int index)
+	{
+		long end = (long)nodes[index].first + (long)nodes[index].count;
+		bis.setIndex(nodes[index].first);
+		int count = bis.readLength(end);
+		// The count is checked before any nodes are added for it.
+		if (count < 1 || !decodeStrings(bis.getPointer(), end - bis.getIndex(), count, NULL, NULL))
+			throw ODSException("Error: A string sequence is corrupt!");
+		if (!withinLimit(bis, count))
+			throw ODSException("Error: A string sequence has more values than the value limit!");
+		unsigned int first = (unsigned int)nodes.size();
+		Node node = Node();
+		node.id = 1;
+		nodes.resize(first + (size_t)count, node);
+		readStrings(bis.getPointer(), end - bis.getIndex(), &nodes[first], count, 1);
+		bis.setIndex(end);
+		nodes[index].id = 9;
+		nodes[index].first = first;
+		nodes[index].count = count;
+	}
+
+	// Set the values of count StringTag nodes (every stride nodes, starting at target) from a dictionary that is size bytes.
+	// Every distinct string is copied once, and the nodes of the same string share it.
+	inline bool Document::readStrings(const byte* data, long size, Node* target, size_t count, size_t stride)
+	{
+		std::vector<std::string_view> dictionary;
+		std::vector<unsigned int> indices(count);
+		if (!decodeStrings(data, size, count, &dictionary, indices.data()))
+			return false;
+		std::vector<unsigned int> offsets(dictionary.size());
+		for (size_t i = 0; i < dictionary.size(); i++) {
+			offsets[i] = (unsigned int)stringData.size();
+			stringData.append(dictionary[i]);
+		}
+		for (size_t i = 0; i < count; i++) {
+			Node& node = target[i * stride];
+			node.first = offsets[indices[i]];
+			node.count = (unsigned int)dictionary[indices[i]].size();
+		}
+		return true;
+	}
+
+	inline size_t Document::size() const
+	{
+		return nodes.size();
+	}
+
+	inline size_t Document::memorySize() const
+	{
+		size_t size = sizeof(Document) + nodes.capacity() * sizeof(Node) + stringData.capacity() + names.capacity() * sizeof(TagName);
+		// (Roughly the node and bucket of every entry of nameIndices and nameIds.)
+		size += nameIndices.size() * (sizeof(std::string_view) + 4 * sizeof(void*));
+		size += nameIds.size() * (2 * sizeof(unsigned int) + 4 * sizeof(void*));
+		for (const TagName& name : names)
+			size += sizeof(std::string) + name.str().capacity();
+		return size;
+	}
+
+	inline unsigned int Document::rootCount() const
+	{
+		return roots;
+	}
+
+	inline const Node& Document::getNode(unsigned int index) const
+	{
+		return nodes[index];
+	}
+
+	inline const Node* Document::children(const Node& node) const
+	{
+		return nodes.data() + node.first;
+	}
+
+	inline std::string_view Document::string(const Node& node) const
+	{
+		return std::string_view(stringData).substr(node.first, node.count);
+	}
+
+	inline const TagName& Document::name(const Node& node) const
+	{
+		return names[node.name];
+	}
+
+	inline const Node* Document::find(const Node& parent, TagName name) const
+	{
+		auto it = nameIds.find(name.index());
+		return it == nameIds.end() ? NULL : find(parent, it->second);
+	}
+
+	// The names of a document are only stored once, so the children are compared by the index of their name.
+	inline const Node* Document::find(const Node& parent, unsigned int name) const
+	{
+		if (!parent.isContainer())
+			return NULL;
+		const Node* child = children(parent);
+		for (unsigned int i = 0; i < parent.count; i++) {
+			if (child[i].name == name)
+				return &child[i];
+		}
+		return NULL;
+	}
+
+	inline const Node* Document::find(std::string key) const
+	{
+		// Use a fake container around the top level nodes so they can be searched like any other children.
+		Node parent = Node();
+		parent.id = 11;
+		parent.first = 0;
+		parent.count = roots;
+		const Node* current = &parent;
+		size_t start = 0;
+		while (current != NULL) {
+			size_t end = key.find('.', start);
+			auto it = nameIndices.find(std::string_view(key).substr(start, end - start));
+			if (it == nameIndices.end())
+				return NULL;
+			current = find(*current, it->second);
+			if (end == std::string::npos)
+				return current;
+			start = end + 1;
+		}
+		return NULL;
+	}
+
+	inline std::vector<std::shared_ptr<ITag>> Document::toTags() const
+	{
+		std::vector<std::shared_ptr<ITag>> tags;
+		for (unsigned int i = 0; i < roots; i++) {
+			tags.push_back(toTag(nodes[i]));
+		}
+		return tags;
+	}
+
+	inline std::shared_ptr<ITag> Document::toTag(const Node& node) const
+	{
+		return std::shared_ptr<ITag>(createTag(node));
+	}
+
+	inline ITag* Document::createTag(const Node& node) const
+	{
+		const TagName& name = names[node.name];
+		switch (node.id) {
+		case 2: return new IntTag(name, node.value.i);
+		case 3: return new FloatTag(name, node.value.f);
+		case 4: return new DoubleTag(name, node.value.d);
+		case 6: return new LongTag(name, (long)node.value.l);
+		case 7: return new CharTag(name, node.value.c);
+		case 8: return new ByteTag(name, node.value.b);
+		case 1: return new StringTag(name, std::string(string(node)));
+		case 9: {
+			VectorTag* tag = new VectorTag(name, std::vector<std::shared_ptr<ITag>>());
+			const Node* child = children(node);
+			for (unsigned int i = 0; i < node.count; i++)
+				tag->addTag(std::shared_ptr<ITag>(createTag(child[i])));
+			return tag;
+		}
+		case 11: {
+			ObjectTag* tag = new ObjectTag(name);
+			const Node* child = children(node);
+			for (unsigned int i = 0; i < node.count; i++)
+				tag->addTag(createTag(child[i]));
+			return tag;
+		}
+		case 12: {
+			CompressedObjectTag* tag = new CompressedObjectTag(name, node.value.compression.type, node.value.compression.level);
+			const Node* child = children(node);
+			for (unsigned int i = 0; i < node.count; i++)
+				tag->addTag(createTag(child[i]));
+			return tag;
+		}
+		default:
+			throw ODSException("Error: Unknown tag id!");
+		}
+	}
+
+	inline bool Document::columnar(const Node& node) const
+	{
+		if (node.id != 9 || node.count < 2)
+			return false;
+		const Node* row = children(node);
+		if (row[0].id != 11 || row[0].count == 0)
+			return false;
+		const Node* schema = children(row[0]);
+		for (unsigned int i = 0; i < node.count; i++) {
+			if (row[i].id != 11 || row[i].name != 0 || row[i].count != row[0].count)
+				return false;
+			const Node* field = children(row[i]);
+			for (unsigned int j = 0; j < row[i].count; j++) {
+				if (field[j].isContainer() || field[j].id != schema[j].id || field[j].name != schema[j].name)
+					return false;
+			}
+		}
+		return true;
+	}
+
+	inline bool Document::sequence(const Node& node) const
+	{
+		if (node.id != 9 || node.count < 2)
+			return false;
+		const Node* child = children(node);
+		for (unsigned int i = 0; i < node.count; i++) {
+			if ((child[i].id != 2 && child[i].id != 6) || child[i].id != child[0].id || child[i].name != 0)
+				return false;
+		}
+		return true;
+	}
+
+	inline bool Document::series(const Node& node) const
+	{
+		if (node.id != 9 || node.count < 2)
+			return false;
+		const Node* child = children(node);
+		for (unsigned int i = 0; i < node.count; i++) {
+			if ((child[i].id != 3 && child[i].id != 4) || child[i].id != child[0].id || child[i].name != 0)
+				return false;
+		}
+		return true;
+	}
+
+	inline bool Document::strings(const Node& node) const
+	{
+		if (node.id != 9 || node.count < 2)
+			return false;
+		const Node* child = children(node);
+		for (unsigned int i = 0; i < node.count; i++) {
+			if (child[i].id != 1 || child[i].name != 0)
+				return false;
+		}
+		return true;
+	}
+
+	inline byte Document::writtenId(const Node& node, BinaryOutputStream& bos) const
+	{
+		if (bos.isColumnar() && columnar(node))
+			return 14;
+		if (bos.isSequenceEncoding() && sequence(node))
+			return 15;
+		if (bos.isSequenceEncoding() && series(node))
+			return 16;
+		if (bos.isSequenceEncoding() && strings(node))
+			return 17;
+		return node.id;
+	}
+
+	// The values of an integer sequence (see sequence()).
+	inline std::vector<long long> Document::sequenceValues(const Node& node) const
+	{
+		std::vector<long long> values(node.count);
+		const Node* child = children(node);
+		for (unsigned int i = 0; i < node.count; i++)
+			values[i] = child[i].id == 2 ? child[i].value.i : child[i].value.l;
+		return values;
+	}
+
+	// The bits of the values of a float series (see series()).
+	inline std::vector<unsigned long long> Document::seriesValues(const Node& node) const
+	{
+		std::vector<unsigned long long> values(node.count);
+		const Node* child = children(node);
+		for (unsigned int i = 0; i < node.count; i++) {
+			if (child[i].id == 3) {
+				unsigned int bits;
+				memcpy(&bits, &child[i].value.f, 4);
+				values[i] = bits;
+			}
+			else {
+				memcpy(&values[i], &child[i].value.d, 8);
+			}
+		}
+		return values;
+	}
+
+	inline std::vector<byte> Document::stringValues(const Node& node, unsigned int field) const
+	{
+		std::vector<std::string_view> values(node.count);
+		const Node* child = children(node);
+		for (unsigned int i = 0; i < node.count; i++)
+			values[i] = string(child[i].id == 11 ? children(child[i])[field] : child[i]);
+		std::vector<byte> dictionary;
+		encodeStrings(values, dictionary);
+		return dictionary;
+	}
+
+	// The size of the value of a ByteTag, IntTag, etc.
+	inline int Document::valueLength(const Node& node, Format format)
+	{
+		switch (node.id) {
+		case 2: return format != Format::STANDARD ? varintSize(zigzagEncode(node.value.i)) : 4;
+		case 6: return format != Format::STANDARD ? varintSize(zigzagEncode(node.value.l)) : 8;
+		case 1: return (int)node.count;
+		default: return tagValueSize(node.id);
+		}
+	}
+
+	// The number of bytes after the length of a tag (the name and the value).
+	// The lengths of containers are stored in lengths so they do not need to be calculated again while writing.
+	inline int Document::dataLength(const Node& node, std::vector<int>& lengths, CompressedBodies& compressed, BinaryOutputStream& bos) const
+	{
+		int length = bos.nameSize(names[node.name]);
+		const Node* child = children(node);
+		byte id = writtenId(node, bos);
+		if (!node.isContainer()) {
+			length += valueLength(node, bos.getFormat());
+		}
+		else if (id == 15) {
+			length += 1 + bos.lengthSize(node.count) + 1 + (int)planSequence(sequenceValues(node)).size;
+		}
+		else if (id == 16) {
+			length += 1 + bos.lengthSize(node.count) + (int)encodeSeries(seriesValues(node), child[0].id == 3 ? 32 : 64, NULL);
+		}
+		else if (id == 17) {
+			length += bos.lengthSize(node.count) + (int)stringValues(node, 0).size();
+		}
+		else if (id == 14) {
+			const Node* schema = children(child[0]);
+			length += bos.lengthSize(node.count) + bos.lengthSize(child[0].count);
+			for (unsigned int i = 0; i < child[0].count; i++) {
+				int column = 0;
+				if (schema[i].id == 1)
+					column = (int)stringValues(node, i).size();
+				for (unsigned int j = 0; j < node.count && schema[i].id != 1; j++)
+					column += valueLength(children(child[j])[i], bos.getFormat());
+				length += 1 + bos.nameSize(names[schema[i].name]) + bos.lengthSize(column) + column;
+			}
+		}
+		else if (id == 12) {
+			// The size is only known once the children are written and compressed.
+			BinaryOutputStream body = bos.child();
+			for (unsigned int i = 0; i < node.count; i++) {
+				dataLength(child[i], lengths, compressed, body);
+				writeNode(body, child[i], lengths, compressed);
+			}
+			std::vector<byte>& bytes = compressed[&node];
+			bytes = compressBytes(node.value.compression.type, body.getArray(), body.length(), defaultCompressionThreshold, node.value.compression.level);
+			length += (int)bytes.size();
+		}
+		else {
+			for (unsigned int i = 0; i < node.count; i++) {
+				int childLength = dataLength(child[i], lengths, compressed, bos);
+				length += 1 + bos.lengthSize(childLength) + childLength;
+			}
+		}
+		lengths[&node - nodes.data()] = length;
+		return length;
+	}
+
+	inline void Document::writeData(BinaryOutputStream& bos) const
+	{
+		std::vector<int> lengths(nodes.size());
+		CompressedBodies compressed;
+		for (unsigned int i = 0; i < roots; i++) {
+			dataLength(nodes[i], lengths, compressed, bos);
+			writeNode(bos, nodes[i], lengths, compressed);
+			compressed.clear();
+		}
+	}
+
+	// Unlike ITag::writeData this writes straight into bos, since the length of every container is already known.
+	inline void Document::writeNode(BinaryOutputStream& bos, const Node& node, const std::vector<int>& lengths, const CompressedBodies& compressed) const
+	{
+		byte id = writtenId(node, bos);
+		bos.writeByte(id);
+		bos.writeLength(lengths[&node - nodes.data()]);
+		bos.writeName(names[node.name]);
+		if (id == 14) {
+			writeColumns(bos, node);
+		}
+		else if (id == 15) {
+			std::vector<long long> values = sequenceValues(node);
+			SequencePlan plan = planSequence(values);
+			bos.writeByte(children(node)[0].id);
+			bos.writeLength(node.count);
+			bos.writeByte((byte)plan.encoding);
+			encodeSequence(bos, values, plan);
+		}
+		else if (id == 16) {
+			std::vector<byte> series;
+			encodeSeries(seriesValues(node), children(node)[0].id == 3 ? 32 : 64, &series);
+			bos.writeByte(children(node)[0].id);
+			bos.writeLength(node.count);
+			bos.writeByte(series.data(), (int)series.size());
+		}
+		else if (id == 17) {
+			std::vector<byte> dictionary = stringValues(node, 0);
+			bos.writeLength(node.count);
+			bos.writeByte(dictionary.data(), (int)dictionary.size());
+		}
+		else if (id == 12) {
+			const std::vector<byte>& bytes = compressed.at(&node);
+			bos.writeByte(bytes.data(), (int)bytes.size());
+		}
+		else if (!node.isContainer()) {
+			writeValue(bos, node);
+		}
+		else {
+			const Node* child = children(node);
+			for (unsigned int i = 0; i < node.count; i++)
+				writeNode(bos, child[i], lengths, compressed);
+		}
+	}
+
+	inline void Document::writeValue(BinaryOutputStream& bos, const Node& node) const
+	{
+		switch (node.id) {
+		case 1: bos.writeByte(stringData.data() + node.first, (int)node.count); break;
+		case 2: bos.writeIntValue(node.value.i); break;
+		case 3: bos.writeFloat(node.value.f); break;
+		case 4: bos.writeDouble(node.value.d); break;
+		case 6: bos.writeLongValue(node.value.l); break;
+		case 7: bos.writeByte(node.value.c); break;
+		case 8: bos.writeByte(node.value.b); break;
+		}
+	}
+
+	// The value of a columnar vector (see columnar()).
+	inline void Document::writeColumns(BinaryOutputStream& bos, const Node& node) const
+	{
+		const Node* row = children(node);
+		const Node* schema = children(row[0]);
+		unsigned int fields = row[0].count;
+		bos.writeLength(node.count);
+		bos.writeLength(fields);
+		for (unsigned int i = 0; i < fields; i++) {
+			bos.writeByte(schema[i].id);
+			bos.writeName(names[schema[i].name]);
+		}
+		for (unsigned int i = 0; i < fields; i++) {
+			if (schema[i].id == 1) {
+				std::vector<byte> dictionary = stringValues(node, i);
+				bos.writeLength((int)dictionary.size());
+				bos.writeByte(dictionary.data(), (int)dictionary.size());
+				continue;
+			}
+			BinaryOutputStream column = bos.child();
+			for (unsigned int j = 0; j < node.count; j++)
+				writeValue(column, children(row[j])[i]);
+			bos.writeLength(column.length());
+			bos.writeByte(column.getArray(), column.length());
+		}
+	}
+
+	inline bool VectorTag::writeEncoded(BinaryOutputStream& bos)
+	{
+		// Only tags that a Document can store are converted, the Document checks the rest.
+		for (std::shared_ptr<ITag>& row : value) {
+			byte id = row->getID();
+			if ((id == 1 || id == 2 || id == 3 || id == 4 || id == 6) && bos.isSequenceEncoding())
+				continue;
+			// (A FixedTag of a struct also has id 11, but it is not an ObjectTag.)
+			ObjectTag* object = id == 11 ? dynamic_cast<ObjectTag*>(row.get()) : NULL;
+			if (object == NULL || !bos.isColumnar())
+				return false;
+			for (ITag* field : object->getValue()) {
+				if (field->getID() != 1 && tagValueSize(field->getID()) < 0)
+					return false;
+			}
+		}
+		Document doc = Document(std::vector<ITag*>{ this });
+		if (doc.writtenId(doc.getNode(0), bos) == 9)
+			return false;
+		doc.writeData(bos);
+		return true;
+	}
+
+	/*
+	===========================================
+
+	Document Cache
+
+	===========================================
+	*/
+	// A cache of parsed Documents that can be shared between threads.
+	//
+	// Documents are cached by file name and compression, and are loaded again when the size or modification time of
+	// the file changes. The cached documents are immutable, so every thread can use the same one at the same time.
+	// Once the documents use more than the capacity (in bytes), documents that were not used recently are removed
+	// (see evict()). (A document that is removed stays alive until every thread is done with it.)
+	//
+	// A hit only takes a shared lock on the cache and marks its entry as used with an atomic flag, so readers never
+	// wait for each other, only for a thread that is adding a document. Adding a document takes the lock exclusively,
+	// and is O(1) plus the entries it passes while evicting.
+	class DocumentCache {
+	public:
+		DocumentCache(size_t capacity = 64 * 1024 * 1024);
+
+		// The process wide cache.
+		static DocumentCache& global();
 
-		void setValue(byte b);
-		byte getValue();
-		void setName(std::string);
-		std::string getName();
+		// Get the document for a file, loading it if it is not cached or the file changed.
+		std::shared_ptr<const Document> get(const std::string& file_name, CompressionType compression = CompressionType::NONE);
 
-		void writeData(BinaryOutputStream& bos);
-		Tag<byte> createFromData(byte value[], int length);
-		byte getID();
+		void setCapacity(size_t capacity);
+		// The number of bytes used by the cached documents.
+		size_t size();
+		void clear();
+
+	private:
+		struct Entry {
+			std::string key;
+			std::shared_ptr<const Document> document;
+			long long fileSize;
+			long long fileTime;
+			size_t bytes;
+			// Set by every hit, and cleared by evict() when it passes the entry.
+			std::atomic<bool> referenced;
+		};
+
+		// Remove entries until the cache fits inside of its capacity, except for keep.
+		void evict(std::list<Entry>::iterator keep);
+		void erase(std::list<Entry>::iterator entry);
+
+		// The entries in the order that evict() goes around them, and the position of every entry by its key.
+		std::list<Entry> entries;
+		std::unordered_map<std::string, std::list<Entry>::iterator> positions;
+		// The next entry that evict() looks at. New entries are added just before it, so they are the last ones it reaches.
+		std::list<Entry>::iterator hand;
+		// Held shared to read positions and entries, and exclusively to add or remove entries.
+		std::shared_mutex mutex;
+		size_t capacity;
+		size_t used;
 	};
 
-	inline ByteTag::ByteTag(std::string name, byte value)
+	inline DocumentCache::DocumentCache(size_t capacity)
 	{
-		this->name = name;
-		this->value = value;
+		this->capacity = capacity;
+		this->used = 0;
+		this->hand = entries.end();
 	}
 
-	inline ByteTag::~ByteTag()
+	inline DocumentCache& DocumentCache::global()
 	{
+		static DocumentCache cache;
+		return cache;
 	}
 
-	inline void ByteTag::setValue(byte b)
+	inline std::shared_ptr<const Document> DocumentCache::get(const std::string& file_name, CompressionType compression)
 	{
-		this->value = b;
+		std::string key = file_name + '\n' + std::to_string((int)compression);
+		long long fileSize, fileTime;
+		if (!fileStamp(file_name, fileSize, fileTime))
+			throw ODSException("File stream not open! Does that file exist?");
+
+		{
+			std::shared_lock<std::shared_mutex> lock(mutex);
+			auto it = positions.find(key);
+			if (it != positions.end() && it->second->fileSize == fileSize && it->second->fileTime == fileTime) {
+				// (The flag is only written if it is not set yet, so hits on the same entry do not share a written cache line.)
+				if (!it->second->referenced.load(std::memory_order_relaxed))
+					it->second->referenced.store(true, std::memory_order_relaxed);
+				return it->second->document;
+			}
+		}
+
+		// Parse the file without holding the lock. (Two threads may both parse a new file, only one is kept.)
+		BinaryInputStream bis = BinaryInputStream(file_name, compression);
+		std::shared_ptr<const Document> document = std::make_shared<const Document>(Document::read(bis));
+		bis.close();
+
+		size_t bytes = document->memorySize();
+
+		std::unique_lock<std::shared_mutex> lock(mutex);
+		auto old = positions.find(key);
+		if (old != positions.end())
+			erase(old->second);
+		std::list<Entry>::iterator entry = entries.emplace(hand);
+		entry->key = key;
+		entry->document = document;
+		entry->fileSize = fileSize;
+		entry->fileTime = fileTime;
+		entry->bytes = bytes;
+		entry->referenced = false;
+		positions.emplace(key, entry);
+		used += bytes;
+		evict(entry);
+		return document;
+	}
+
+	// The CLOCK algorithm: the hand goes around the entries, clears the flag of the ones that were used since it last
+	// passed them, and removes the first one that was not. So entries that are used stay, without hits having to
+	// reorder anything. (Called with mutex held exclusively.)
+	inline void DocumentCache::evict(std::list<Entry>::iterator keep)
+	{
+		while (used > capacity && entries.size() > 1) {
+			if (hand == entries.end())
+				hand = entries.begin();
+			if (hand == keep || hand->referenced.exchange(false, std::memory_order_relaxed)) {
+				++hand;
+				continue;
+			}
+			erase(hand++);
+		}
 	}
 
-	inline byte ByteTag::getValue()
+	inline void DocumentCache::erase(std::list<Entry>::iterator entry)
 	{
-		return value;
+		if (hand == entry)
+			++hand;
+		used -= entry->bytes;
+		positions.erase(entry->key);
+		entries.erase(entry);
 	}
 
-	inline void ByteTag::setName(std::string)
+	inline void DocumentCache::setCapacity(size_t capacity)
 	{
-		this->name = name;
+		std::unique_lock<std::shared_mutex> lock(mutex);
+		this->capacity = capacity;
+		evict(entries.end());
 	}
 
-	inline std::string ByteTag::getName()
+	inline size_t DocumentCache::size()
 	{
-		return name;
+		std::shared_lock<std::shared_mutex> lock(mutex);
+		return used;
 	}
 
-	inline void ByteTag::writeData(BinaryOutputStream& bos)
+	inline void DocumentCache::clear()
 	{
-		bos.writeByte(getID());
-		// Memory only stream
-		BinaryOutputStream tempBOS = BinaryOutputStream();
-		tempBOS.writeShort(name.length());
-		tempBOS.writeString(name);
-		tempBOS.writeByte(value);
+		std::unique_lock<std::shared_mutex> lock(mutex);
+		used = 0;
+		positions.clear();
+		entries.clear();
+		hand = entries.end();
+	}
 
-		bos.writeInt(tempBOS.length());
-		bos.writeByte(tempBOS.getArray(), tempBOS.length());
-		tempBOS.close();
+	/*
+	===========================================
+
+	Validation
+
+	===========================================
+	*/
+	// Check the value of a columnar vector (see Document::columnar()) that is size bytes.
+	// names is the number of names in the name dictionary of Format::NAMED.
+	inline bool validateColumns(const byte* data, long size, Format format, unsigned long long names)
+	{
+		const unsigned char* b = reinterpret_cast<const unsigned char*>(data);
+		// Read a length (see BinaryOutputStream::writeLength()) at position.
+		auto length = [&](long& position, unsigned long long& value) {
+			if (format != Format::STANDARD) {
+				int lengthSize = decodeVarint(data + position, size - position, value);
+				position += lengthSize;
+				return lengthSize != 0 && value <= 0x7FFFFFFF;
+			}
+			if (size - position < 4)
+				return false;
+			value = ((unsigned int)b[position] << 24) | ((unsigned int)b[position + 1] << 16) | ((unsigned int)b[position + 2] << 8) | (unsigned int)b[position + 3];
+			position += 4;
+			return value <= 0x7FFFFFFF;
+		};
+		// Skip a name (see BinaryOutputStream::writeName()) at position.
+		auto name = [&](long& position) {
+			unsigned long long value;
+			if (format == Format::STANDARD) {
+				if (size - position < 2)
+					return false;
+				value = ((unsigned int)b[position] << 8) | (unsigned int)b[position + 1];
+				position += 2;
+			}
+			else {
+				int nameSize = decodeVarint(data + position, size - position, value);
+				if (nameSize == 0)
+					return false;
+				position += nameSize;
+				if (format == Format::NAMED)
+					return value <= names;
+			}
+			if (value > 0x7FFF || value > (unsigned long long)(size - position))
+				return false;
+			position += (long)value;
+			return true;
+		};
+		long position = 0;
+		unsigned long long rows, fields;
+		if (!length(position, rows) || !length(position, fields) || rows < 2 || fields < 1 || fields > (unsigned long long)(size - position))
+			return false;
+		long schema = position;
+		unsigned long long valueFields = 0;
+		for (unsigned long long i = 0; i < fields; i++) {
+			if (position >= size)
+				return false;
+			byte id = data[position++];
+			if ((id != 1 && tagValueSize(id) < 0) || !name(position))
+				return false;
+			if (id != 1)
+				valueFields++;
+		}
+		if (rows * valueFields + (valueFields < fields ? rows / 8 : 0) > (unsigned long long)(size - position))
+			return false;
+		for (unsigned long long i = 0; i < fields; i++) {
+			byte id = data[schema++];
+			name(schema);
+			unsigned long long column;
+			if (!length(position, column) || column > (unsigned long long)(size - position))
+				return false;
+			long columnEnd = position + (long)column;
+			if (id == 1) {
+				if (!decodeStrings(data + position, (long)column, rows, NULL, NULL))
+					return false;
+				position = columnEnd;
+				continue;
+			}
+			if (format == Format::STANDARD || (id != 2 && id != 6)) {
+				if ((unsigned long long)tagValueSize(id) * rows != column)
+					return false;
+				position = columnEnd;
+				continue;
+			}
+			// Every varint must be inside of the column, and the column must end with the last one.
+			for (unsigned long long j = 0; j < rows; j++) {
+				unsigned long long value;
+				int valueSize = decodeVarint(data + position, columnEnd - position, value);
+				if (valueSize == 0 || valueSize > (id == 2 ? 5 : 10))
+					return false;
+				position += valueSize;
+			}
+			if (position != columnEnd)
+				return false;
+		}
+		return position == size;
+	}
+
+	// Check the value of an integer sequence (see SequenceEncoding) that is size bytes.
+	inline bool validateSequence(const byte* data, long size, Format format)
+	{
+		if (size < 1 || (data[0] != 2 && data[0] != 6))
+			return false;
+		const unsigned char* b = reinterpret_cast<const unsigned char*>(data);
+		long position = 1;
+		unsigned long long count;
+		if (format != Format::STANDARD) {
+			int lengthSize = decodeVarint(data + position, size - position, count);
+			if (lengthSize == 0)
+				return false;
+			position += lengthSize;
+		}
+		else {
+			if (size - position < 4)
+				return false;
+			count = ((unsigned int)b[1] << 24) | ((unsigned int)b[2] << 16) | ((unsigned int)b[3] << 8) | (unsigned int)b[4];
+			position += 4;
+		}
+		if (count < 1 || count > 0x7FFFFFFF || position >= size)
+			return false;
+		return checkSequence((SequenceEncoding)b[position], data + position + 1, size - position - 1, count);
 	}
 
-	
-	inline Tag<byte> ByteTag::createFromData(byte value[], int length)
+	// Check the value of a string sequence (see encodeStrings()) that is size bytes.
+	inline bool validateStrings(const byte* data, long size, Format format)
 	{
-		this->value = value[0];
-		return *this;
+		const unsigned char* b = reinterpret_cast<const unsigned char*>(data);
+		long position = 0;
+		unsigned long long count;
+		if (format != Format::STANDARD) {
+			position = decodeVarint(data, size, count);
+			if (position == 0)
+				return false;
+		}
+		else {
+			if (size < 4)
+				return false;
+			count = ((unsigned int)b[0] << 24) | ((unsigned int)b[1] << 16) | ((unsigned int)b[2] << 8) | (unsigned int)b[3];
+			position = 4;
+		}
+		if (count < 1 || count > 0x7FFFFFFF)
+			return false;
+		return decodeStrings(data + position, size - position, count, NULL, NULL);
+	}
+
+	// Check the value of a float series (see encodeSeries()) that is size bytes.
+	inline bool validateSeries(const byte* data, long size, Format format)
+	{
+		if (size < 1 || (data[0] != 3 && data[0] != 4))
+			return false;
+		const unsigned char* b = reinterpret_cast<const unsigned char*>(data);
+		long position = 1;
+		unsigned long long count;
+		if (format != Format::STANDARD) {
+			int lengthSize = decodeVarint(data + position, size - position, count);
+			if (lengthSize == 0)
+				return false;
+			position += lengthSize;
+		}
+		else {
+			if (size - position < 4)
+				return false;
+			count = ((unsigned int)b[1] << 24) | ((unsigned int)b[2] << 16) | ((unsigned int)b[3] << 8) | (unsigned int)b[4];
+			position += 4;
+		}
+		if (count < 1 || count > 0x7FFFFFFF)
+			return false;
+		return decodeSeries(data + position, size - position, count, data[0] == 3 ? 32 : 64, NULL);
 	}
-	
 
-	inline byte ByteTag::getID()
+	// Check that data holds well formed ODS tags without creating any of them.
+	// Only the id and length headers are read, the values of tags are skipped over. Every tag must have a known id,
+	// fit inside of its parent, and the children of a container must fill the container exactly.
+	// Fixed size tags (like the IntTag) must have a value of the right size.
+	//
+	// Nothing is allocated, so this is safe to run on every file before it is loaded. (The children of a CompressedObjectTag
+	// are only checked to start like compressed data. The rest is checked when they are decompressed.)
+	// Data that starts with the compact header is checked in the compact format. In Format::NAMED the name dictionary
+	// is checked, and the name of every tag must be in it.
+	// Returns false if the data is not well formed.
+	inline bool validate(const byte* data, long size)
+	{
+		// Containers nested deeper than this are treated as corrupt.
+		const int maxDepth = 256;
+		// The ends of the containers that the current tag is inside of.
+		long ends[maxDepth];
+		int depth = 0;
+		long end = size;
+		long position = 0;
+		Format format;
+		long dictionarySize;
+		position = parseFileHeader(data, size, format, dictionarySize);
+		if (position < 0 || position > size)
+			return false;
+		unsigned long long names = 0;
+		if (format == Format::NAMED && !NameDictionary::check(data + position - dictionarySize, dictionarySize, names))
+			return false;
+		while (true) {
+			if (position == end) {
+				if (depth == 0)
+					return true;
+				end = ends[--depth];
+				continue;
+			}
+			TagHeader header;
+			if (!parseTagHeader(data + position, end - position, format, header))
+				return false;
+			// (The empty name is not counted in the dictionary.)
+			if (format == Format::NAMED && header.nameIndex > names)
+				return false;
+			byte id = header.id;
+			long tagEnd = position + header.end;
+			long valueStart = position + header.valueStart;
+			switch (id) {
+			case 9:
+			case 11:
+				if (depth == maxDepth)
+					return false;
+				ends[depth++] = end;
+				end = tagEnd;
+				position = valueStart;
+				break;
+			case 14:
+				if (!validateColumns(data + valueStart, tagEnd - valueStart, format, names))
+					return false;
+				position = tagEnd;
+				break;
+			case 15:
+				if (!validateSequence(data + valueStart, tagEnd - valueStart, format))
+					return false;
+				position = tagEnd;
+				break;
+			case 16:
+				if (!validateSeries(data + valueStart, tagEnd - valueStart, format))
+					return false;
+				position = tagEnd;
+				break;
+			case 17:
+				if (!validateStrings(data + valueStart, tagEnd - valueStart, format))
+					return false;
+				position = tagEnd;
+				break;
+			case 1:
+				// A string can be any size.
+				position = tagEnd;
+				break;
+			case 12: {
+				CompressionType type;
+				if (!detectCompression(data + valueStart, tagEnd - valueStart, type))
+					return false;
+				position = tagEnd;
+				break;
+			}
+			case 13:
+				// The checksum footer can only be at the top level.
+				if (depth != 0)
+					return false;
+				position = tagEnd;
+				break;
+			case 2:
+			case 6:
+				if (format != Format::STANDARD) {
+					// The varint must fill the value exactly.
+					unsigned long long value;
+					long valueSize = tagEnd - valueStart;
+					if (valueSize > (id == 2 ? 5 : 10) || decodeVarint(data + valueStart, valueSize, value) != valueSize)
+						return false;
+					position = tagEnd;
+					break;
+				}
+				// In the standard format they have a fixed size like the other values.
+				[[fallthrough]];
+			default: {
+				int valueSize = tagValueSize(id, format);
+				if (valueSize < 0 || tagEnd - valueStart != valueSize)
+					return false;
+				position = tagEnd;
+				break;
+			}
+			}
+		}
+	}
+
+	inline bool validate(const std::vector<byte>& data)
 	{
-		return 8;
+		return validate(data.data(), (long)data.size());
 	}
 
-	/******************************
+	/*
+	===========================================
 
-		Char Tag
-		(Doesn't have much purpose in c++, exists only to be compatible with other ODS versions.)
+	Struct Reflection
 
-	*******************************
+	===========================================
 	*/
-	class CharTag : public Tag<char> {
-	private:
-		std::string name;
-		char value;
+	// Structs can be saved and loaded without building any tags by describing their fields with ODS_SCHEMA.
+	// The struct is written in the exact same format as an ObjectTag, so it can be read back as normal tags.
+	//
+	// Example:
+	//     struct Player { int health; double x; double y; };
+	//     ODS_SCHEMA(Player, ODS_FIELD(Player, health), ODS_FIELD(Player, x), ODS_FIELD(Player, y))
+	//
+	//     ods.save("Player", player);
+	//
+	// Supported field types: byte (ByteTag), int (IntTag), float (FloatTag), double (DoubleTag),
+	// long and long long (LongTag), and other structs that have an ODS_SCHEMA (ObjectTag).
+	//
+	// ODS_SCHEMA must be used outside of any namespace.
+
+	// A field of the struct C with the type T.
+	template <class C, class T>
+	struct Field {
+		const char* name;
+		short nameLength;
+		T C::* member;
+	};
 
-	public:
-		CharTag(std::string name, byte value);
-		~CharTag();
+	template <class C, class T>
+	constexpr Field<C, T> makeField(const char* name, T C::* member)
+	{
+		return Field<C, T>{ name, (short)std::char_traits<char>::length(name), member };
+	}
 
-		void setValue(char b);
-		char getValue();
-		void setName(std::string);
-		std::string getName();
+	// The field list of a struct. This is specialized by ODS_SCHEMA.
+	template <class C>
+	struct Schema {
+		static constexpr bool reflected = false;
+	};
 
-		void writeData(BinaryOutputStream& bos);
-		Tag<char> createFromData(byte value[], int length);
-		byte getID();
+#define ODS_FIELD(Type, member) ODS::makeField(#member, &Type::member)
+#define ODS_SCHEMA(Type, ...) \
+	template <> struct ODS::Schema<Type> { \
+		static constexpr bool reflected = true; \
+		static constexpr auto fields() { return std::make_tuple(__VA_ARGS__); } \
 	};
 
-	inline CharTag::CharTag(std::string name, char value)
-	{
-		this->name = name;
-		this->value = value;
-	}
+	// How a field type is stored: the tag id, the number of bytes in the value, and how to read/write the value.
+	template <class T, class Enable = void>
+	struct FieldType;
 
-	inline CharTag::~CharTag()
-	{
-	}
+	template <> struct FieldType<byte> {
+		static constexpr byte id = 8;
+		static constexpr int size() { return 1; }
+		static void write(BinaryOutputStream& bos, byte value) { bos.writeByte(value); }
+		static void read(BinaryInputStream& bis, long /*end*/, byte& value) { value = bis.readByte(); }
+	};
 
-	inline void CharTag::setValue(char b)
-	{
-		this->value = b;
-	}
+	template <> struct FieldType<int> {
+		static constexpr byte id = 2;
+		static constexpr int size() { return 4; }
+		static void write(BinaryOutputStream& bos, int value) { bos.writeIntValue(value); }
+		static void read(BinaryInputStream& bis, long end, int& value) { value = bis.readIntValue(end); }
+	};
 
-	inline byte CharTag::getValue()
-	{
-		return value;
-	}
+	template <> struct FieldType<float> {
+		static constexpr byte id = 3;
+		static constexpr int size() { return 4; }
+		static void write(BinaryOutputStream& bos, float value) { bos.writeFloat(value); }
+		static void read(BinaryInputStream& bis, long /*end*/, float& value) { value = bis.readFloat(); }
+	};
 
-	inline void CharTag::setName(std::string)
-	{
-		this->name = name;
-	}
+	template <> struct FieldType<double> {
+		static constexpr byte id = 4;
+		static constexpr int size() { return 8; }
+		static void write(BinaryOutputStream& bos, double value) { bos.writeDouble(value); }
+		static void read(BinaryInputStream& bis, long /*end*/, double& value) { value = bis.readDouble(); }
+	};
 
-	inline std::string CharTag::getName()
-	{
-		return name;
-	}
+	template <> struct FieldType<long> {
+		static constexpr byte id = 6;
+		static constexpr int size() { return 8; }
+		static void write(BinaryOutputStream& bos, long value) { bos.writeLongValue(value); }
+		static void read(BinaryInputStream& bis, long end, long& value) { value = (long)bis.readLongValue(end); }
+	};
 
-	inline void CharTag::writeData(BinaryOutputStream& bos)
-	{
-		bos.writeByte(getID());
-		// Memory only stream
-		BinaryOutputStream tempBOS = BinaryOutputStream();
-		tempBOS.writeShort(name.length());
-		tempBOS.writeString(name);
-		tempBOS.writeByte(value);
+	template <> struct FieldType<long long> {
+		static constexpr byte id = 6;
+		static constexpr int size() { return 8; }
+		static void write(BinaryOutputStream& bos, long long value) { bos.writeLongValue(value); }
+		static void read(BinaryInputStream& bis, long end, long long& value) { value = bis.readLongValue(end); }
+	};
 
-		bos.writeInt(tempBOS.length());
-		bos.writeByte(tempBOS.getArray(), tempBOS.length());
-		tempBOS.close();
-	}
+	template <class T>
+	void writeFields(BinaryOutputStream& bos, const T& object);
+	template <class T>
+	void readFields(BinaryInputStream& bis, long end, T& object);
 
+	// Nested structs are stored as ObjectTags.
+	template <class T>
+	struct FieldType<T, typename std::enable_if<Schema<T>::reflected>::type> {
+		static constexpr byte id = 11;
+		static constexpr int size()
+		{
+			return std::apply([](auto... field) {
+				return (0 + ... + (7 + field.nameLength + FieldType<typename std::remove_reference<decltype(std::declval<T>().*(field.member))>::type>::size()));
+			}, Schema<T>::fields());
+		}
+		static void write(BinaryOutputStream& bos, const T& value) { writeFields(bos, value); }
+		static void read(BinaryInputStream& bis, long end, T& value) { readFields(bis, end, value); }
+	};
 
-	inline Tag<char> CharTag::createFromData(byte value[], int length)
+	template <class C, class T>
+	inline void writeField(BinaryOutputStream& bos, const Field<C, T>& field, const T& value)
 	{
-		this->value = value[0];
-		return *this;
+		if (bos.getFormat() != Format::STANDARD) {
+			// The size of a varint depends on the value, so the tag is written like ITag::writeData.
+			BinaryOutputStream tempBOS = bos.child();
+			if (bos.getFormat() == Format::NAMED) {
+				tempBOS.writeName(std::string(field.name, field.nameLength));
+			}
+			else {
+				tempBOS.writeVarint(field.nameLength);
+				tempBOS.writeByte(field.name, field.nameLength);
+			}
+			FieldType<T>::write(tempBOS, value);
+			bos.writeByte(FieldType<T>::id);
+			bos.writeLength(tempBOS.length());
+			bos.writeByte(tempBOS.getArray(), tempBOS.length());
+			return;
+		}
+		bos.writeByte(FieldType<T>::id);
+		bos.writeInt(2 + field.nameLength + FieldType<T>::size());
+		bos.writeShort(field.nameLength);
+		bos.writeByte(field.name, field.nameLength);
+		FieldType<T>::write(bos, value);
+	}
+
+	// Write the fields of a struct. (The body of the ObjectTag.)
+	template <class T>
+	inline void writeFields(BinaryOutputStream& bos, const T& object)
+	{
+		static_assert(Schema<T>::reflected, "The struct must have an ODS_SCHEMA.");
+		std::apply([&](auto... field) {
+			(writeField(bos, field, object.*(field.member)), ...);
+		}, Schema<T>::fields());
+	}
+
+	// Write a struct as an ObjectTag called name.
+	template <class T>
+	inline void writeObject(BinaryOutputStream& bos, const std::string& name, const T& object)
+	{
+		if (bos.getFormat() != Format::STANDARD) {
+			BinaryOutputStream tempBOS = bos.child();
+			tempBOS.writeName(name);
+			writeFields(tempBOS, object);
+			bos.writeByte(11);
+			bos.writeLength(tempBOS.length());
+			bos.writeByte(tempBOS.getArray(), tempBOS.length());
+			return;
+		}
+		bos.writeByte(11);
+		bos.writeInt(2 + (int)name.length() + FieldType<T>::size());
+		bos.writeShort((short)name.length());
+		bos.writeByte(name.c_str(), (int)name.length());
+		writeFields(bos, object);
+	}
+
+	// Write a tag called name that holds a single value (an int, double, etc).
+	template <class T>
+	inline void writeValue(BinaryOutputStream& bos, const std::string& name, const T& value)
+	{
+		BinaryOutputStream tempBOS = bos.child();
+		tempBOS.writeName(name);
+		FieldType<T>::write(tempBOS, value);
+		bos.writeByte(FieldType<T>::id);
+		bos.writeLength(tempBOS.length());
+		bos.writeByte(tempBOS.getArray(), tempBOS.length());
 	}
 
-
-	inline byte CharTag::getID()
+	template <class C, class T>
+	inline void readField(BinaryInputStream& bis, byte id, std::string_view name, long end, const Field<C, T>& field, T& value, bool& matched)
 	{
-		return 7;
+		if (matched || id != FieldType<T>::id || name.length() != (size_t)field.nameLength)
+			return;
+		if (memcmp(name.data(), field.name, field.nameLength) != 0)
+			return;
+		// Nested structs check their own tags, everything else must be exactly the size of the field.
+		// (Varints are checked once they are read.)
+		if (FieldType<T>::id != 11 && bis.getFormat() == Format::STANDARD && end - bis.getIndex() != FieldType<T>::size())
+			return;
+		T read = value;
+		FieldType<T>::read(bis, end, read);
+		if (FieldType<T>::id != 11 && bis.getIndex() != end)
+			return;
+		value = read;
+		matched = true;
+	}
+
+	// Read the fields of a struct from an ObjectTag body that ends at end.
+	// Tags that do not match a field (by name and id) are skipped, and fields without a tag are left unchanged.
+	template <class T>
+	inline void readFields(BinaryInputStream& bis, long end, T& object)
+	{
+		static_assert(Schema<T>::reflected, "The struct must have an ODS_SCHEMA.");
+		while (bis.getIndex() < end) {
+			byte id;
+			short nameLength;
+			long tagEnd = bis.readTagHeader(end, id, nameLength);
+			std::string_view name = bis.readTagNameView(nameLength);
+			bool matched = false;
+			std::apply([&](auto... field) {
+				(readField(bis, id, name, tagEnd, field, object.*(field.member), matched), ...);
+			}, Schema<T>::fields());
+			bis.setIndex(tagEnd);
+		}
 	}
 
 	/******************************
 
-		Double Tag
+		Fixed Tag
+		(A tag whose name is known at compile time.)
 
 	*******************************
 	*/
-	class DoubleTag : public Tag<double> {
+	// Since the name and the size of the value never change, the id, length, and name of a FixedTag are
+	// built into a constexpr byte array. Writing the tag is a single copy of the header followed by the value.
+	//
+	// Name must be a constexpr char array declared outside of a function:
+	//     static constexpr char healthName[] = "Health";
+	//     FixedTag<healthName, int>::write(bos, 20);
+	//
+	// T can be any type supported by ODS_SCHEMA.
+	template <const char* Name, class T>
+	class FixedTag : public Tag<T> {
 	private:
-		std::string name;
-		double value;
+		T value;
+
+		// (Defined in the class, since header needs it while the class is being defined.)
+		static constexpr std::array<byte, 7 + std::char_traits<char>::length(Name)> createHeader()
+		{
+			std::array<byte, 7 + std::char_traits<char>::length(Name)> header = {};
+			int nameLength = (int)std::char_traits<char>::length(Name);
+			int length = 2 + nameLength + FieldType<T>::size();
+			header[0] = FieldType<T>::id;
+			header[1] = (byte)(length >> 24);
+			header[2] = (byte)(length >> 16);
+			header[3] = (byte)(length >> 8);
+			header[4] = (byte)length;
+			header[5] = (byte)(nameLength >> 8);
+			header[6] = (byte)nameLength;
+			for (int i = 0; i < nameLength; i++)
+				header[7 + i] = Name[i];
+			return header;
+		}
 
 	public:
-		DoubleTag(std::string name, double value);
-		~DoubleTag();
+		// The id, length, name length and name of the tag.
+		static constexpr std::array<byte, 7 + std::char_traits<char>::length(Name)> header = createHeader();
 
-		void setValue(double b);
-		double getValue();
-		void setName(std::string);
+		FixedTag(T value);
+		~FixedTag();
+
+		void setValue(T b);
+		T getValue();
+		// The name of a FixedTag cannot be changed.
+		void setName(std::string name);
 		std::string getName();
+		TagName getTagName();
 
 		void writeData(BinaryOutputStream& bos);
-		Tag<double> createFromData(byte value[], int length);
 		byte getID();
+
+		// Write a tag without constructing a FixedTag.
+		// (The prebuilt header is only for the standard format. In the compact format the length depends on the value.)
+		static void write(BinaryOutputStream& bos, const T& value);
 	};
 
-	inline DoubleTag::DoubleTag(std::string name, double value)
+	template <const char* Name, class T>
+	inline FixedTag<Name, T>::FixedTag(T value)
 	{
-		this->name = name;
 		this->value = value;
 	}
 
-	inline DoubleTag::~DoubleTag()
+	template <const char* Name, class T>
+	inline FixedTag<Name, T>::~FixedTag()
 	{
 	}
 
-	inline void DoubleTag::setValue(double b)
+	template <const char* Name, class T>
+	inline void FixedTag<Name, T>::setValue(T b)
 	{
 		this->value = b;
 	}
 
-	inline double DoubleTag::getValue()
+	template <const char* Name, class T>
+	inline T FixedTag<Name, T>::getValue()
 	{
 		return value;
 	}
 
-	inline void DoubleTag::setName(std::string)
+	template <const char* Name, class T>
+	inline void FixedTag<Name, T>::setName(std::string /*name*/)
 	{
-		this->name = name;
+		throw ODSException("Error: Cannot change the name of a FixedTag!");
 	}
 
-	inline std::string DoubleTag::getName()
+	template <const char* Name, class T>
+	inline std::string FixedTag<Name, T>::getName()
 	{
-		return name;
+		return std::string(Name);
 	}
 
-	inline void DoubleTag::writeData(BinaryOutputStream& bos)
+	template <const char* Name, class T>
+	inline TagName FixedTag<Name, T>::getTagName()
 	{
-		bos.writeByte(getID());
-		// Memory only stream
-		BinaryOutputStream tempBOS = BinaryOutputStream();
-		tempBOS.writeShort(name.length());
-		tempBOS.writeString(name);
-		tempBOS.writeDouble(value);
-
-		bos.writeInt(tempBOS.length());
-		bos.writeByte(tempBOS.getArray(), tempBOS.length());
-		tempBOS.close();
+		static const TagName name = TagName(Name);
+		return name;
 	}
 
-
-	inline Tag<double> DoubleTag::createFromData(byte value[], int length)
+	template <const char* Name, class T>
+	inline void FixedTag<Name, T>::writeData(BinaryOutputStream& bos)
 	{
-		this->value = *reinterpret_cast<double*>(*value);
-		return *this;
+		write(bos, value);
 	}
 
+	template <const char* Name, class T>
+	inline byte FixedTag<Name, T>::getID()
+	{
+		return FieldType<T>::id;
+	}
 
-	inline byte DoubleTag::getID()
+	template <const char* Name, class T>
+	inline void FixedTag<Name, T>::write(BinaryOutputStream& bos, const T& value)
 	{
-		return 4;
+		if (bos.getFormat() != Format::STANDARD) {
+			static const TagName name = TagName(Name);
+			BinaryOutputStream tempBOS = bos.child();
+			tempBOS.writeName(name);
+			FieldType<T>::write(tempBOS, value);
+			bos.writeByte(FieldType<T>::id);
+			bos.writeLength(tempBOS.length());
+			bos.writeByte(tempBOS.getArray(), tempBOS.length());
+			return;
+		}
+		bos.writeByte(header.data(), (int)header.size());
+		FieldType<T>::write(bos, value);
 	}
 
-	/******************************
+	/*
+	===========================================
 
-		Float Tag
+	Tag Locator
 
-	*******************************
+	===========================================
 	*/
-	class FloatTag : public Tag<float> {
-	private:
-		std::string name;
-		float value;
+	// Where a tag is inside of a file or a buffer.
+	struct TagLocation {
+		byte id;
+		// The position of the id.
+		long start;
+		// The position right after the length.
+		long lengthEnd;
+		// The position right after the name (where the value or the children start).
+		long valueStart;
+		// The position right after the tag.
+		long end;
+	};
 
+	// A source for the TagLocator that reads from a seekable stream (such as a std::fstream).
+	class StreamSource {
 	public:
-		FloatTag(std::string name, float value);
-		~FloatTag();
+		StreamSource(std::istream& stream);
 
-		void setValue(float b);
-		float getValue();
-		void setName(std::string);
-		std::string getName();
+		bool read(long position, byte* out, int size);
+		long length();
 
-		void writeData(BinaryOutputStream& bos);
-		Tag<float> createFromData(byte value[], int length);
-		byte getID();
+	private:
+		std::istream* stream;
+		long size;
 	};
 
-	inline FloatTag::FloatTag(std::string name, float value)
+	inline StreamSource::StreamSource(std::istream& stream)
 	{
-		this->name = name;
-		this->value = value;
+		this->stream = &stream;
+		stream.seekg(0, stream.end);
+		size = (long)stream.tellg();
 	}
 
-	inline FloatTag::~FloatTag()
+	inline bool StreamSource::read(long position, byte* out, int size)
 	{
+		if (position < 0 || position + size > this->size)
+			return false;
+		stream->seekg(position);
+		stream->read(out, size);
+		return (bool)*stream;
 	}
 
-	inline void FloatTag::setValue(float b)
+	inline long StreamSource::length()
 	{
-		this->value = b;
+		return size;
 	}
 
-	inline float FloatTag::getValue()
+	// A source for the TagLocator that reads from bytes in memory.
+	class BufferSource {
+	public:
+		BufferSource(const byte* data, long size);
+
+		bool read(long position, byte* out, int size);
+		long length();
+
+	private:
+		const byte* data;
+		long size;
+	};
+
+	inline BufferSource::BufferSource(const byte* data, long size)
 	{
-		return value;
+		this->data = data;
+		this->size = size;
 	}
 
-	inline void FloatTag::setName(std::string)
+	inline bool BufferSource::read(long position, byte* out, int size)
 	{
-		this->name = name;
+		if (position < 0 || position + size > this->size)
+			return false;
+		memcpy(out, data + position, size);
+		return true;
 	}
 
-	inline std::string FloatTag::getName()
+	inline long BufferSource::length()
 	{
-		return name;
+		return size;
 	}
 
-	inline void FloatTag::writeData(BinaryOutputStream& bos)
-	{
-		bos.writeByte(getID());
-		// Memory only stream
-		BinaryOutputStream tempBOS = BinaryOutputStream();
-		tempBOS.writeShort(name.length());
-		tempBOS.writeString(name);
-		tempBOS.writeFloat(value);
+	// The TagLocator finds a tag by its key (Example: "Player.Stats.Health") using only the tag headers.
+	// Tags that are not on the path are skipped using their length, so their contents are never read.
+	//
+	// The Source can be a StreamSource, a BufferSource, or any class with the same read() and length() methods.
+	class TagLocator {
+	public:
+		// Find the tag at key. path is filled with the location of every tag on the path,
+		// from the top level tag to the tag itself. Returns false if the tag does not exist.
+		template <class Source>
+		static bool locate(Source& source, const std::string& key, std::vector<TagLocation>& path);
+
+		// Find several tags while reading the source once. Only the tags that are on the path to a key are entered,
+		// everything else is skipped. locations[i] is the location of keys[i], or has a start of -1 if it does not exist.
+		template <class Source>
+		static void locateMany(Source& source, const std::vector<std::string>& keys, std::vector<TagLocation>& locations);
+
+		// Read the header of the tag at position. Returns false if the header does not fit inside of end.
+		// nameLength is set to the length of the name, which ends at location.valueStart.
+		template <class Source>
+		static bool readHeader(Source& source, long position, long end, TagLocation& location, short& nameLength, Format format = Format::STANDARD);
+
+		// Read the file header of the source (if there is one). Returns the position of the first tag.
+		// If names is not NULL it is set to the name dictionary of Format::NAMED.
+		template <class Source>
+		static long readFormat(Source& source, Format& format, std::shared_ptr<const NameDictionary>* names = NULL);
+
+		// Read the name of the tag at location into name. (names is the name dictionary of Format::NAMED, or NULL.)
+		template <class Source>
+		static void readName(Source& source, const TagLocation& location, short nameLength, const NameDictionary* names, std::string& name);
+	};
 
-		bos.writeInt(tempBOS.length());
-		bos.writeByte(tempBOS.getArray(), tempBOS.length());
-		tempBOS.close();
+	template <class Source>
+	inline bool TagLocator::readHeader(Source& source, long position, long end, TagLocation& location, short& nameLength, Format format)
+	{
+		// The largest header is an id and two varints of 10 bytes.
+		byte bytes[21];
+		int size = (int)std::min<long>(end - position, sizeof(bytes));
+		if (size <= 0 || !source.read(position, bytes, size))
+			return false;
+		TagHeader header;
+		if (!parseTagHeader(bytes, end - position, format, header))
+			return false;
+		nameLength = header.nameLength;
+		location.id = header.id;
+		location.start = position;
+		location.lengthEnd = position + header.lengthEnd;
+		location.valueStart = position + header.valueStart;
+		location.end = position + header.end;
+		return true;
+	}
+
+	template <class Source>
+	inline long TagLocator::readFormat(Source& source, Format& format, std::shared_ptr<const NameDictionary>* names)
+	{
+		// The header and the varint size of the name dictionary.
+		byte header[compactHeaderSize + 10];
+		int size = (int)std::min<long>(source.length(), sizeof(header));
+		format = Format::STANDARD;
+		if (size < compactHeaderSize || !source.read(0, header, size))
+			return 0;
+		long dictionarySize;
+		long start = parseFileHeader(header, size, format, dictionarySize);
+		if (start < 0 || start > source.length())
+			throw ODSException("Error: The file header is corrupt or from a newer version of ODS!");
+		if (format == Format::NAMED && names != NULL) {
+			std::vector<byte> dictionary(dictionarySize);
+			if (dictionarySize > 0 && !source.read(start - dictionarySize, dictionary.data(), dictionarySize))
+				throw ODSException("Error: The name dictionary is corrupt!");
+			*names = NameDictionary::read(dictionary.data(), dictionarySize);
+			if (*names == NULL)
+				throw ODSException("Error: The name dictionary is corrupt!");
+		}
+		return start;
 	}
 
-
-	inline Tag<float> FloatTag::createFromData(byte value[], int length)
+	template <class Source>
+	inline void TagLocator::readName(Source& source, const TagLocation& location, short nameLength, const NameDictionary* names, std::string& name)
 	{
-		this->value = *reinterpret_cast<float*>(*value);
-		return *this;
+		name.resize(nameLength);
+		if (nameLength > 0)
+			source.read(location.valueStart - nameLength, &name[0], nameLength);
+		if (names != NULL) {
+			unsigned long long index;
+			if (decodeVarint(name.data(), nameLength, index) != nameLength)
+				throw ODSException("Error: Invalid tag length!");
+			name = names->get(index).str();
+		}
 	}
 
+	// A trie of the keys that locateMany() is looking for.
+	struct KeyTrieNode {
+		std::unordered_map<std::string, int> children;
+		// The indices of the keys that end at this node.
+		std::vector<int> keys;
+	};
 
-	inline byte FloatTag::getID()
+	template <class Source>
+	inline void TagLocator::locateMany(Source& source, const std::vector<std::string>& keys, std::vector<TagLocation>& locations)
+	{
+		TagLocation missing = TagLocation();
+		missing.start = -1;
+		locations.assign(keys.size(), missing);
+
+		std::vector<KeyTrieNode> trie(1);
+		for (size_t i = 0; i < keys.size(); i++) {
+			int node = 0;
+			size_t start = 0;
+			while (true) {
+				size_t end = keys[i].find('.', start);
+				std::string part = keys[i].substr(start, end == std::string::npos ? std::string::npos : end - start);
+				auto it = trie[node].children.find(part);
+				int child;
+				if (it == trie[node].children.end()) {
+					child = (int)trie.size();
+					trie[node].children.emplace(part, child);
+					trie.emplace_back();
+				}
+				else {
+					child = it->second;
+				}
+				node = child;
+				if (end == std::string::npos)
+					break;
+				start = end + 1;
+			}
+			trie[node].keys.push_back((int)i);
+		}
+
+		// The containers that are being read: the trie node they match and the end of their body.
+		struct Level {
+			int node;
+			long end;
+		};
+		std::vector<Level> stack;
+		stack.push_back(Level{ 0, source.length() });
+		Format format;
+		std::shared_ptr<const NameDictionary> names;
+		long position = readFormat(source, format, &names);
+		size_t remaining = keys.size();
+		std::string name;
+		while (!stack.empty() && remaining > 0) {
+			Level& level = stack.back();
+			if (position >= level.end) {
+				stack.pop_back();
+				continue;
+			}
+			TagLocation location;
+			short nameLength;
+			if (!readHeader(source, position, level.end, location, nameLength, format))
+				throw ODSException("Error: Invalid tag length!");
+			readName(source, location, nameLength, names.get(), name);
+			position = location.end;
+			auto it = trie[level.node].children.find(name);
+			if (it == trie[level.node].children.end())
+				continue;
+			KeyTrieNode& match = trie[it->second];
+			for (int key : match.keys) {
+				// Keep the first tag with the name, the same as locate().
+				if (locations[key].start == -1) {
+					locations[key] = location;
+					remaining--;
+				}
+			}
+			// Only ObjectTags have named children.
+			if (!match.children.empty() && location.id == 11) {
+				stack.push_back(Level{ it->second, location.end });
+				position = location.valueStart;
+			}
+		}
+	}
+
+	template <class Source>
+	inline bool TagLocator::locate(Source& source, const std::string& key, std::vector<TagLocation>& path)
 	{
-		return 3;
+		path.clear();
+		Format format;
+		std::shared_ptr<const NameDictionary> names;
+		long position = readFormat(source, format, &names);
+		long end = source.length();
+		size_t keyStart = 0;
+		std::string name;
+		while (true) {
+			size_t keyEnd = key.find('.', keyStart);
+			std::string part = key.substr(keyStart, keyEnd == std::string::npos ? std::string::npos : keyEnd - keyStart);
+			bool found = false;
+			TagLocation location;
+			short nameLength;
+			while (position < end) {
+				if (!readHeader(source, position, end, location, nameLength, format))
+					throw ODSException("Error: Invalid tag length!");
+				if (names != NULL || nameLength == (short)part.length()) {
+					readName(source, location, nameLength, names.get(), name);
+					if (name == part) {
+						found = true;
+						break;
+					}
+				}
+				position = location.end;
+			}
+			if (!found)
+				return false;
+			path.push_back(location);
+			if (keyEnd == std::string::npos)
+				return true;
+			// Only ObjectTags have named children.
+			if (location.id != 11)
+				return false;
+			position = location.valueStart;
+			end = location.end;
+			keyStart = keyEnd + 1;
+		}
 	}
 
-	/******************************
+	/*
+	===========================================
 
-		Int Tag
+	Checksums
 
-	*******************************
+	===========================================
 	*/
-	class IntTag : public Tag<int> {
-	private:
-		std::string name;
-		int value;
+	// The CRC32C of the top level tag between offset and offset + length.
+	struct ChecksumEntry {
+		long long offset;
+		int length;
+		unsigned int crc;
+	};
 
+	// The optional checksum footer of a file. It is a tag with the id 13 and no name that is written after the last top level tag:
+	//     int count, count * (long offset, int length, int crc), int size of the footer tag, "ODSC"
+	// The size and magic at the very end allow the footer to be found by reading only the end of the file.
+	// Document::read() and the TagLocator skip over the footer like any other tag that does not match.
+	//
+	// Every top level tag has its own checksum, so a single tag can be checked without reading the rest of the file.
+	class Checksums {
 	public:
-		IntTag(std::string name, int value);
-		~IntTag();
-
-		void setValue(int b);
-		int getValue();
-		void setName(std::string);
-		std::string getName();
-
-		void writeData(BinaryOutputStream& bos);
-		Tag<int> createFromData(byte value[], int length);
-		byte getID();
+		static const byte id = 13;
+
+		// Find the footer at the end of the source and read its entries.
+		// Returns where the footer starts (the end of the tags), or the length of the source if there is no footer.
+		template <class Source>
+		static long find(Source& source, std::vector<ChecksumEntry>& entries);
+		// Add an entry for every top level tag between start and end.
+		template <class Source>
+		static void calculate(Source& source, long start, long end, std::vector<ChecksumEntry>& entries, Format format);
+		// Add an entry for every top level tag of a file, from the file header (if there is one) to end.
+		template <class Source>
+		static void calculate(Source& source, long end, std::vector<ChecksumEntry>& entries);
+		// The CRC32C of the bytes between start and end.
+		template <class Source>
+		static unsigned int crc(Source& source, long start, long end);
+		// Check every top level tag against the footer. Throws an ODSException if there is no footer.
+		template <class Source>
+		static bool verify(Source& source);
+
+		static void write(BinaryOutputStream& bos, const std::vector<ChecksumEntry>& entries);
+		// Add a footer for all of the tags in the stream.
+		static void append(BinaryOutputStream& bos);
+		static void append(std::vector<byte>& bytes);
+		// Remove the footer from the end of bytes. Returns false if there was no footer.
+		static bool strip(std::vector<byte>& bytes);
+		// The position of the entry at index inside of the footer of a file that is length bytes long.
+		static long entryPosition(long length, size_t count, size_t index);
 	};
 
-	inline IntTag::IntTag(std::string name, int value)
-	{
-		this->name = name;
-		this->value = value;
-	}
-
-	inline IntTag::~IntTag()
-	{
+	template <class Source>
+	inline long Checksums::find(Source& source, std::vector<ChecksumEntry>& entries)
+	{
+		entries.clear();
+		long length = source.length();
+		byte trailer[8];
+		// The smallest footer is the compact header (3 bytes), the count (4 bytes) and the trailer (8 bytes).
+		if (length < 15 || !source.read(length - 8, trailer, 8) || memcmp(trailer + 4, "ODSC", 4) != 0)
+			return length;
+		const unsigned char* t = reinterpret_cast<const unsigned char*>(trailer);
+		long size = (long)(((unsigned int)t[0] << 24) | ((unsigned int)t[1] << 16) | ((unsigned int)t[2] << 8) | (unsigned int)t[3]);
+		if (size < 15 || size > length)
+			return length;
+		std::vector<byte> footer(size);
+		if (!source.read(length - size, footer.data(), (int)size))
+			return length;
+		// The header of the footer is in the format of the file.
+		Format format;
+		TagLocator::readFormat(source, format);
+		TagHeader header;
+		if (!parseTagHeader(footer.data(), size, format, header) || header.id != id || header.end != size)
+			return length;
+		// (In Format::NAMED the empty name is index 0 of the name dictionary.)
+		if (format == Format::NAMED ? header.nameIndex != 0 : header.nameLength != 0)
+			return length;
+		BinaryInputStream bis = BinaryInputStream(footer.data(), size);
+		bis.setIndex(header.valueStart);
+		int count = bis.readInt();
+		if (count < 0 || (long)count * 16 != size - header.valueStart - 12)
+			return length;
+		entries.resize(count);
+		for (ChecksumEntry& entry : entries) {
+			entry.offset = bis.readLong();
+			entry.length = bis.readInt();
+			entry.crc = (unsigned int)bis.readInt();
+		}
+		return length - size;
 	}
 
-	inline void IntTag::setValue(int b)
+	template <class Source>
+	inline void Checksums::calculate(Source& source, long end, std::vector<ChecksumEntry>& entries)
 	{
-		this->value = b;
+		Format format;
+		long start = TagLocator::readFormat(source, format);
+		calculate(source, start, end, entries, format);
 	}
 
-	inline int IntTag::getValue()
+	template <class Source>
+	inline void Checksums::calculate(Source& source, long start, long end, std::vector<ChecksumEntry>& entries, Format format)
 	{
-		return value;
+		long position = start;
+		while (position < end) {
+			TagLocation location;
+			short nameLength;
+			if (!TagLocator::readHeader(source, position, end, location, nameLength, format))
+				throw ODSException("Error: The tags are corrupt, checksums cannot be calculated!");
+			ChecksumEntry entry;
+			entry.offset = location.start;
+			entry.length = (int)(location.end - location.start);
+			entry.crc = crc(source, location.start, location.end);
+			entries.push_back(entry);
+			position = location.end;
+		}
 	}
 
-	inline void IntTag::setName(std::string)
+	template <class Source>
+	inline unsigned int Checksums::crc(Source& source, long start, long end)
 	{
-		this->name = name;
+		byte buffer[65536];
+		unsigned int result = 0;
+		while (start < end) {
+			int size = (int)std::min<long>(end - start, sizeof(buffer));
+			if (!source.read(start, buffer, size))
+				throw ODSException("Error: Unable to read the bytes of a checksum!");
+			result = crc32c(result, buffer, size);
+			start += size;
+		}
+		return result;
+	}
+
+	template <class Source>
+	inline bool Checksums::verify(Source& source)
+	{
+		std::vector<ChecksumEntry> entries;
+		long end = find(source, entries);
+		if (end == source.length())
+			throw ODSException("Error: The file does not have checksums!");
+		// The entries must cover every top level tag, in order.
+		Format format;
+		long long position = TagLocator::readFormat(source, format);
+		for (ChecksumEntry& entry : entries) {
+			if (entry.offset != position || entry.length < 0 || entry.offset + entry.length > end)
+				return false;
+			if (crc(source, (long)entry.offset, (long)(entry.offset + entry.length)) != entry.crc)
+				return false;
+			position += entry.length;
+		}
+		return position == end;
+	}
+
+	inline void Checksums::write(BinaryOutputStream& bos, const std::vector<ChecksumEntry>& entries)
+	{
+		// The value is the count, the entries, and the trailer.
+		int valueSize = 4 + 16 * (int)entries.size() + 8;
+		bool compact = bos.getFormat() != Format::STANDARD;
+		int length = (compact ? 1 : 2) + valueSize;
+		int size = 1 + (compact ? varintSize(length) : 4) + length;
+		bos.writeByte(id);
+		bos.writeLength(length);
+		bos.writeName("");
+		bos.writeInt((int)entries.size());
+		for (const ChecksumEntry& entry : entries) {
+			bos.writeLong(entry.offset);
+			bos.writeInt(entry.length);
+			bos.writeInt((int)entry.crc);
+		}
+		bos.writeInt(size);
+		bos.writeByte("ODSC", 4);
 	}
 
-	inline std::string IntTag::getName()
+	inline void Checksums::append(BinaryOutputStream& bos)
 	{
-		return name;
+		std::vector<ChecksumEntry> entries;
+		BufferSource source = BufferSource(bos.getArray(), bos.length());
+		calculate(source, bos.length(), entries);
+		write(bos, entries);
 	}
 
-	inline void IntTag::writeData(BinaryOutputStream& bos)
+	inline void Checksums::append(std::vector<byte>& bytes)
 	{
-		bos.writeByte(getID());
-		// Memory only stream
-		BinaryOutputStream tempBOS = BinaryOutputStream();
-		tempBOS.writeShort(name.length());
-		tempBOS.writeString(name);
-		tempBOS.writeInt(value);
-
-		bos.writeInt(tempBOS.length());
-		bos.writeByte(tempBOS.getArray(), tempBOS.length());
-		tempBOS.close();
+		BinaryOutputStream bos = BinaryOutputStream();
+		std::vector<ChecksumEntry> entries;
+		BufferSource source = BufferSource(bytes.data(), (long)bytes.size());
+		Format format;
+		TagLocator::readFormat(source, format);
+		bos.setFormat(format);
+		calculate(source, (long)bytes.size(), entries);
+		write(bos, entries);
+		bytes.insert(bytes.end(), bos.getArray(), bos.getArray() + bos.length());
 	}
 
-
-	inline Tag<int> IntTag::createFromData(byte value[], int length)
+	inline bool Checksums::strip(std::vector<byte>& bytes)
 	{
-		this->value = *reinterpret_cast<int*>(*value);
-		return *this;
+		std::vector<ChecksumEntry> entries;
+		BufferSource source = BufferSource(bytes.data(), (long)bytes.size());
+		long end = find(source, entries);
+		if (end == (long)bytes.size())
+			return false;
+		bytes.resize(end);
+		return true;
 	}
 
-
-	inline byte IntTag::getID()
+	inline long Checksums::entryPosition(long length, size_t count, size_t index)
 	{
-		return 2;
+		// The entries are right before the trailer.
+		return length - 8 - 16 * (long)(count - index);
 	}
 
-	/******************************
+	/*
+	===========================================
 
-		Invalid Tag
+	Journal
 
-	*******************************
+	===========================================
 	*/
-	class InvalidTag : public Tag<byte*> {
-	private:
-		std::string name;
-		byte* value;
+	enum class JournalOperation : byte {
+		SET = 1,
+		APPEND = 2,
+		REMOVE = 3,
+		REPLACE = 4
+	};
+
+	struct JournalRecord {
+		JournalOperation operation;
+		std::string key;
+		// The bytes of the tag (or tags) for SET, APPEND and REPLACE.
+		std::vector<byte> data;
+	};
 
+	// The write ahead journal used by ObjectDataStructure's journaled mode.
+	//
+	// The journal starts with "ODSJ" and the size and modification time the main file had when the journal was
+	// started. A journal is only applied if the main file still matches, so a journal that was already compacted
+	// (but not deleted before a crash) is not applied twice.
+	//
+	// Each record is: operation (byte), key length (int), key, data length (int), data, and a CRC32 of everything
+	// before it in the record.
+	class Journal {
 	public:
-		InvalidTag(std::string name, byte* value);
-		~InvalidTag();
+		Journal(std::string file_name);
 
-		void setValue(byte* b);
-		byte* getValue();
-		void setName(std::string);
-		std::string getName();
+		// Add a record and flush it to the disk. If the record cannot be written the journal is cut back to the end of
+		// the last record (see appendFile()) and an ODSException is thrown.
+		void record(JournalOperation operation, const std::string& key, const byte* data, int size);
+		// Read every complete record. Returns false if the journal does not belong to the current main file.
+		bool read(std::vector<JournalRecord>& records);
 
-		void writeData(BinaryOutputStream& bos);
-		Tag<byte*> createFromData(byte value[], int length);
-		byte getID();
-	};
+		bool exists();
+		long long size();
+		void remove();
+		// The size of the journal (-1 if there is none), and the size and modification time of the main file.
+		// They change whenever either file is written, so they tell whether records that were read are still current.
+		std::array<long long, 3> state();
 
-	inline InvalidTag::InvalidTag(std::string name, byte* value)
-	{
-		this->name = name;
-		this->value = value;
-	}
+	private:
+		void fileState(long long& size, long long& time);
 
-	inline InvalidTag::~InvalidTag()
-	{
-	}
+		std::string file_name;
+		std::string journal_name;
+	};
 
-	inline void InvalidTag::setValue(byte* b)
+	inline Journal::Journal(std::string file_name)
 	{
-		this->value = b;
+		this->file_name = file_name;
+		this->journal_name = file_name + ".journal";
 	}
 
-	inline byte* InvalidTag::getValue()
+	inline void Journal::fileState(long long& size, long long& time)
 	{
-		return value;
+		std::error_code error;
+		size = -1;
+		time = 0;
+		if (std::filesystem::exists(file_name, error)) {
+			size = (long long)std::filesystem::file_size(file_name, error);
+			time = (long long)std::filesystem::last_write_time(file_name, error).time_since_epoch().count();
+		}
 	}
 
-	inline void InvalidTag::setName(std::string)
+	inline void Journal::record(JournalOperation operation, const std::string& key, const byte* data, int size)
 	{
-		this->name = name;
+		BinaryOutputStream bos = BinaryOutputStream();
+		if (!exists()) {
+			long long fileSize, fileTime;
+			fileState(fileSize, fileTime);
+			bos.writeString("ODSJ");
+			bos.writeLong(fileSize);
+			bos.writeLong(fileTime);
+		}
+		int recordStart = bos.length();
+		bos.writeByte((byte)operation);
+		bos.writeInt((int)key.length());
+		bos.writeString(key);
+		bos.writeInt(size);
+		bos.writeByte(data, size);
+		bos.writeInt((int)mz_crc32(MZ_CRC32_INIT, (const unsigned char*)bos.getArray() + recordStart, bos.length() - recordStart));
+
+		bool created = !exists();
+		appendFile(journal_name, bos.getArray(), bos.length(), SyncPolicy::DATA);
+		if (created)
+			syncDirectory(journal_name);
+	}
+
+	inline bool Journal::read(std::vector<JournalRecord>& records)
+	{
+		BinaryInputStream bis = BinaryInputStream(journal_name);
+		const long headerSize = 20;
+		long long fileSize, fileTime;
+		fileState(fileSize, fileTime);
+		if (bis.length() < headerSize || memcmp(bis.getPointer(), "ODSJ", 4) != 0) {
+			bis.close();
+			return false;
+		}
+		bis.setIndex(4);
+		if (bis.readLong() != fileSize || bis.readLong() != fileTime) {
+			bis.close();
+			return false;
+		}
+		while (bis.length() - bis.getIndex() >= 13) {
+			long start = bis.getIndex();
+			JournalRecord record;
+			record.operation = (JournalOperation)bis.readByte();
+			int keyLength = bis.readInt();
+			if (keyLength < 0 || bis.length() - bis.getIndex() < (long)keyLength + 8)
+				break;
+			record.key = bis.readString(keyLength);
+			int dataLength = bis.readInt();
+			if (dataLength < 0 || bis.length() - bis.getIndex() < (long)dataLength + 4)
+				break;
+			record.data.assign(bis.getPointer(), bis.getPointer() + dataLength);
+			bis.setIndex(bis.getIndex() + dataLength);
+			long end = bis.getIndex();
+			unsigned int crc = (unsigned int)bis.readInt();
+			bis.setIndex(start);
+			// A record that does not match its checksum was only partly written, so it and everything after it is ignored.
+			if (crc != (unsigned int)mz_crc32(MZ_CRC32_INIT, (const unsigned char*)bis.getPointer(), end - start))
+				break;
+			bis.setIndex(end + 4);
+			records.push_back(record);
+		}
+		bis.close();
+		return true;
 	}
 
-	inline std::string InvalidTag::getName()
+	inline bool Journal::exists()
 	{
-		return name;
+		return std::filesystem::exists(journal_name);
 	}
 
-	inline void InvalidTag::writeData(BinaryOutputStream& bos)
+	inline long long Journal::size()
 	{
-		throw ODSException("Error: Cannot write an Invalid Tag!");
+		std::error_code error;
+		return (long long)std::filesystem::file_size(journal_name, error);
 	}
 
-
-	inline Tag<byte*> InvalidTag::createFromData(byte value[], int length)
+	inline void Journal::remove()
 	{
-		this->value = reinterpret_cast<byte*>(value);
-		return *this;
+		std::error_code error;
+		std::filesystem::remove(journal_name, error);
 	}
 
-
-	inline byte InvalidTag::getID()
+	inline std::array<long long, 3> Journal::state()
 	{
-		return 0;
+		std::array<long long, 3> result;
+		result[0] = size();
+		fileState(result[1], result[2]);
+		return result;
 	}
 
-	/******************************
-
-		Vector Tag
-		(Replaces this ListTag of the C# and Java versions).
+	/*
+	===========================================
+	
+	Object Data Structure Class
 
-	*******************************
+	===========================================
 	*/
-	class VectorTag : public Tag<std::vector<std::shared_ptr <ITag>>> {
+
+	class ObjectDataStructure {
 	private:
-		std::string name;
-		std::vector<std::shared_ptr <ITag>> value;
+		std::string file_name;
+		CompressionType compression;
+		double compressionThreshold;
+
+		SyncPolicy syncPolicy;
+		Journal journal;
+		bool journaled;
+		long long journalLimit;
+		// The top level tags that the journal changes, by name, as they will be once it is compacted. Every top level
+		// tag of a name (from the file and then the appended records) is kept in one buffer, after the header of
+		// Format::COMPACT, so a key finds the same tag in it as in the compacted file.
+		std::unordered_map<std::string, std::vector<byte>> journalIndex;
+		// The start and end of every top level tag of the file by name, so the tags of journalIndex can be read
+		// without going through the whole file every time. (Read when journalIndex first needs them.)
+		std::unordered_map<std::string, std::vector<std::pair<long, long>>> fileTags;
+		bool fileTagsRead;
+		// The Journal::state() that journalIndex was built for.
+		std::array<long long, 3> journalState;
+		bool checksummed;
+		Format format;
+		bool columnar;
+		bool sequenceEncoding;
+		// The name dictionary of the file that tagStream() last read. (Format::NAMED only.)
+		std::shared_ptr<NameDictionary> names;
+
+		bool splice(std::string key, const byte* data, int size);
+		static bool spliceBuffer(std::vector<byte>& bytes, std::string key, const byte* data, int size);
+		bool setData(std::string key, const byte* data, int size);
+		void appendData(const byte* data, int size);
+		void checksumFile(long offset);
+		// Write data over the bytes of the file at position (set() changes files in place), and sync it as the SyncPolicy says.
+		void writeInPlace(long position, const byte* data, int size);
+		template <class Source> void checkFormat(Source& source);
+		// A memory stream for tags that are added to the file. In Format::NAMED it uses the name dictionary of the file.
+		BinaryOutputStream tagStream();
+		bool updateNamed(JournalOperation operation, const std::string& key, const byte* data, int size);
+		// The bytes of the file with the records applied (and without its checksum footer).
+		std::vector<byte> journaledBytes(const std::vector<JournalRecord>& records, bool& footer);
+		// Bring journalIndex up to date with the journal. It is built again if the journal or the file changed since
+		// (by compact(), save(), or another ObjectDataStructure). A journal for an older version of the file is deleted.
+		void indexJournal();
+		void clearJournalIndex();
+		void indexRecord(JournalOperation operation, const std::string& key, const byte* data, int size);
+		// The buffer of journalIndex for the top level tags called name. They are read from the file the first time.
+		std::vector<byte>& journalTags(const std::string& name);
+		// Add the top level tags of the file (the source) that are called name to the end of out.
+		// fileTags is filled the first time.
+		template <class Source> void readFileTags(Source& source, const std::string& name, std::vector<byte>& out);
+		// The buffer of journalIndex that key is in, or NULL if the journal does not change the top level tag of the key.
+		// (Call indexJournal() first.)
+		std::vector<byte>* journalOverlay(const std::string& key);
+		// Locate key in the file as it will be once the journal is compacted. Returns false if no tag exists at key.
+		bool locateJournaled(const std::string& key, std::vector<TagLocation>& path);
+		bool recordJournal(JournalOperation operation, const std::string& key, const byte* data, int size);
+		// getMany() without the journal.
+		std::vector<std::shared_ptr<ITag>> readMany(const std::vector<std::string>& keys);
 
 	public:
-		VectorTag(std::string name, std::vector<std::shared_ptr <ITag>> value);
-		~VectorTag();
-
-		void setValue(std::vector<std::shared_ptr <ITag>> b);
-		std::vector<std::shared_ptr <ITag>> getValue();
-		void setName(std::string);
-		std::string getName();
+		ObjectDataStructure(std::string file_name);
+		ObjectDataStructure(std::string file_name, CompressionType compression);
+		~ObjectDataStructure();
+		
+		void save(std::vector< std::shared_ptr<ITag>> tags);
+		void save(std::vector<ITag*> tags);
 
-		void addTag(std::shared_ptr <ITag> tag);
-		void removeTag(std::shared_ptr <ITag> tag);
-		std::shared_ptr <ITag> getTag(int i);
-		void removeAllTags();
-		int indexOf(std::shared_ptr <ITag> tag);
+		// Add tags to the end of the file without rewriting the tags that are already in it.
+		// (The file is created if it does not exist.) If the tags cannot be written, for example because the disk is full,
+		// the file is left as it was and an ODSException is thrown.
+		void append(ITag* tag);
+		void appendAll(std::vector<std::shared_ptr<ITag>> tags);
+		void appendAll(std::vector<ITag*> tags);
+
+		// Save a struct that has an ODS_SCHEMA as an ObjectTag. (The file is overwritten.)
+		template <class T> void save(std::string name, const T& object);
+		// Load the top level ObjectTag called name into a struct that has an ODS_SCHEMA.
+		// Returns false if the tag does not exist.
+		template <class T> bool load(std::string name, T& object);
+
+		// Overwrite the tag at key inside of the file without rewriting the rest of the file.
+		// Only the headers along the path are read, so this costs O(path length) I/O instead of O(file size).
+		// The new tag must be the same size as the old one once written (e.g. an IntTag replacing an IntTag), and its
+		// name must be the last part of key. (An ODSException is thrown otherwise.)
+		// This only works on uncompressed files. (In Format::NAMED the whole file is written again, like replace().)
+		// Returns false if no tag exists at key. Keys inside of a CompressedObjectTag throw an ODSException.
+		bool set(std::string key, ITag* tag);
+		// Overwrite the value of the IntTag, DoubleTag, etc at key. The tag must already have the matching type.
+		// (In the compact format the file is rewritten if the new value does not have the same size as the old one.)
+		// Keys inside of a CompressedObjectTag throw an ODSException, as in set() above.
+		template <class T, class = typename std::enable_if<std::is_arithmetic<T>::value>::type>
+		bool set(std::string key, T value);
+
+		// Get the tag at key. (Returns NULL if it does not exist.)
+		std::shared_ptr<ITag> get(std::string key);
+		// Get the tags at many keys while reading the file only once. The tags are returned in the same order as keys,
+		// with NULL for keys that do not exist.
+		std::vector<std::shared_ptr<ITag>> getMany(std::vector<std::string> keys);
+
+		// Remove the tag at key. Returns false if no tag exists at key.
+		// Keys inside of a CompressedObjectTag throw an ODSException (remove or replace the whole tag instead).
+		bool remove(std::string key);
+		// Replace the tag at key with a tag of any size. Returns false if no tag exists at key.
+		// Keys inside of a CompressedObjectTag throw an ODSException.
+		bool replace(std::string key, ITag* tag);
+
+		// In journaled mode set(), append(), appendAll(), remove() and replace() only add a record to a journal
+		// file (file_name + ".journal") and flush it to the disk. The records are applied to the file by compact(),
+		// which happens automatically once the journal is larger than compactSize bytes.
+		// The top level tags that the journal changes are kept in memory as they will be once it is compacted, so
+		// get(), getMany() and load() see the changes right away, and set(), remove() and replace() return false or
+		// throw like they do without the journal. Keys in other tags are read from the file.
+		// Journaled mode cannot be used with Format::NAMED, since every change can add names to the start of the file.
+		//
+		// If a journal is left behind (for example the program was killed), it is compacted when the
+		// ObjectDataStructure is created. Records that were only partly written are ignored.
+		void setJournaled(bool journaled, long long compactSize = 4 * 1024 * 1024);
+		bool isJournaled();
+		// Apply the journal to the file and delete the journal.
+		void compact();
+
+		// How long saving waits for the file to reach the disk. Files are always replaced atomically,
+		// so this only matters if the system crashes. (SyncPolicy::NONE by default.)
+		void setSyncPolicy(SyncPolicy policy);
+		SyncPolicy getSyncPolicy();
+
+		// The fraction of a block that CompressionType::ADAPTIVE must save for the block to be stored compressed.
+		// Raise it to spend less time on data that only compresses a little. (0.05 by default. Must be at least 0 and less than 1.)
+		void setCompressionThreshold(double threshold);
+		double getCompressionThreshold();
+
+		// The format that the file is saved in. (Format::STANDARD by default.)
+		// Existing files are always read in their own format, but changes to a file in another format throw an ODSException.
+		// (The format of a compressed file is not checked by append(), since that would need the whole file.)
+		//
+		// In Format::NAMED, append(), set() and replace() write the whole file again with the new name dictionary,
+		// so it is best for files that are saved once and read many times. remove(), and set() of a value that does
+		// not change size, work the same as in the other formats.
+		void setFormat(Format format);
+		Format getFormat();
+
+		// Write VectorTags of ObjectTags that all have the same fields by column, with the names and ids of
+		// the fields written once (see Document::columnar()). They are read back as normal VectorTags. Off by default.
+		void setColumnar(bool columnar);
+		bool isColumnar();
+
+		// Write VectorTags of IntTags or LongTags as integer sequences: packed into the fewest bits, as the differences
+		// between neighbours, or as runs of the same value, whichever is smallest (see SequenceEncoding).
+		// VectorTags of FloatTags or DoubleTags are written as float series, which XOR every value with the one
+		// before it (see encodeSeries()). VectorTags of StringTags are written with every distinct string stored once
+		// (see encodeStrings()). They are read back as normal VectorTags. Off by default.
+		void setSequenceEncoding(bool sequenceEncoding);
+		bool isSequenceEncoding();
+
+		// In checksummed mode a footer with the CRC32C of every top level tag is written to the end of the file
+		// (see Checksums). The footer of a file that already has one is always kept up to date, even when
+		// checksummed mode is off. (Except when appending to a compressed file, which would have to be rewritten.)
+		void setChecksummed(bool checksummed);
+		bool isChecksummed();
+		// Check every top level tag against its checksum. Returns false if any of them are corrupt.
+		// Throws an ODSException if the file does not have checksums.
+		bool verify();
+		// Check only the top level tag that contains key. For uncompressed files only that tag is read.
+		// Returns false if the tag is corrupt or does not exist.
+		bool verify(std::string key);
+	};
 
-		void writeData(BinaryOutputStream& bos);
-		Tag<std::vector<std::shared_ptr <ITag>>> createFromData(byte value[], int length);
-		byte getID();
+	inline ObjectDataStructure::ObjectDataStructure(std::string file_name) : ObjectDataStructure(file_name, CompressionType::NONE)
+	{
+	}
 
-		VectorTag& operator+=(ITag* tag) {
-			value.push_back((std::shared_ptr <ITag>) tag);
-			return *this;
+	inline ObjectDataStructure::ObjectDataStructure(std::string file_name, CompressionType compression) : journal(file_name)
+	{
+		this->file_name = file_name;
+		this->compression = compression;
+		this->compressionThreshold = defaultCompressionThreshold;
+		this->syncPolicy = SyncPolicy::NONE;
+		this->journaled = false;
+		this->journalLimit = 0;
+		this->fileTagsRead = false;
+		this->journalState = { -2, -2, -2 };
+		this->checksummed = false;
+		this->format = Format::STANDARD;
+		this->columnar = false;
+		this->sequenceEncoding = false;
+		// Recover the changes from a journal that was left behind. The records were checked against the file, so they
+		// are in the format of the file, which is not known yet.
+		if (journal.exists()) {
+			if (std::filesystem::exists(file_name)) {
+				BinaryInputStream bis = BinaryInputStream(file_name, compression);
+				BufferSource source = BufferSource(bis.getPointer(), bis.length());
+				TagLocator::readFormat(source, this->format);
+				bis.close();
+			}
+			compact();
+			this->format = Format::STANDARD;
 		}
-	};
+	}
 
-	inline VectorTag::VectorTag(std::string name, std::vector<std::shared_ptr <ITag>> value)
+	inline ObjectDataStructure::~ObjectDataStructure()
 	{
-		this->name = name;
-		this->value = value;
 	}
 
-	inline VectorTag::~VectorTag()
+	inline void ObjectDataStructure::save(std::vector<std::shared_ptr<ITag>> tags)
 	{
-		value.clear();
+		BinaryOutputStream bos = BinaryOutputStream(file_name, compression);
+		bos.setSyncPolicy(syncPolicy);
+		bos.setCompressionThreshold(compressionThreshold);
+		bos.setFormat(format);
+		bos.setColumnar(columnar);
+		bos.setSequenceEncoding(sequenceEncoding);
+		for (std::shared_ptr <ITag> &tag : tags) {
+			tag->writeData(bos);
+		}
+		bos.writeHeader();
+		if (checksummed)
+			Checksums::append(bos);
+		bos.close();
+		// Saving replaces every change in the journal.
+		journal.remove();
+		clearJournalIndex();
 	}
 
-	inline void VectorTag::setValue(std::vector<std::shared_ptr <ITag>> b)
+	inline void ObjectDataStructure::save(std::vector<ITag*> tags)
 	{
-		this->value = b;
+		BinaryOutputStream bos = BinaryOutputStream(file_name, compression);
+		bos.setSyncPolicy(syncPolicy);
+		bos.setCompressionThreshold(compressionThreshold);
+		bos.setFormat(format);
+		bos.setColumnar(columnar);
+		bos.setSequenceEncoding(sequenceEncoding);
+		for (ITag* tag : tags) {
+			tag->writeData(bos);
+		}
+		bos.writeHeader();
+		if (checksummed)
+			Checksums::append(bos);
+		bos.close();
+		// Saving replaces every change in the journal.
+		journal.remove();
+		clearJournalIndex();
 	}
 
-	inline std::vector<std::shared_ptr <ITag>> VectorTag::getValue()
+	inline void ObjectDataStructure::append(ITag* tag)
 	{
-		return value;
+		BinaryOutputStream bos = tagStream();
+		tag->writeData(bos);
+		appendData(bos.getArray(), bos.length());
 	}
 
-	inline void VectorTag::setName(std::string)
+	inline void ObjectDataStructure::appendAll(std::vector<std::shared_ptr<ITag>> tags)
 	{
-		this->name = name;
+		BinaryOutputStream bos = tagStream();
+		for (std::shared_ptr<ITag>& tag : tags) {
+			tag->writeData(bos);
+		}
+		appendData(bos.getArray(), bos.length());
 	}
 
-	inline std::string VectorTag::getName()
+	inline void ObjectDataStructure::appendAll(std::vector<ITag*> tags)
 	{
-		return name;
+		BinaryOutputStream bos = tagStream();
+		for (ITag* tag : tags) {
+			tag->writeData(bos);
+		}
+		appendData(bos.getArray(), bos.length());
 	}
 
-	inline void VectorTag::addTag(std::shared_ptr <ITag> tag)
+	inline void ObjectDataStructure::appendData(const byte* data, int size)
 	{
-		value.push_back(tag);
+		if (journaled) {
+			recordJournal(JournalOperation::APPEND, "", data, size);
+			return;
+		}
+		if (format == Format::NAMED) {
+			updateNamed(JournalOperation::APPEND, "", data, size);
+			return;
+		}
+		if (compression == CompressionType::NONE) {
+			std::vector<ChecksumEntry> entries;
+			long end = 0;
+			bool footer = false;
+			std::vector<byte> oldFooter;
+			if (std::filesystem::exists(file_name)) {
+				std::ifstream in(file_name, std::ios::in | std::ios::binary);
+				StreamSource source = StreamSource(in);
+				checkFormat(source);
+				end = Checksums::find(source, entries);
+				footer = end != source.length();
+				if (footer) {
+					oldFooter.resize(source.length() - end);
+					source.read(end, oldFooter.data(), (int)oldFooter.size());
+				}
+				if (!footer && checksummed)
+					Checksums::calculate(source, end, entries);
+			}
+			BinaryOutputStream bos = BinaryOutputStream(file_name, compression);
+			bos.setSyncPolicy(syncPolicy);
+			bos.setCompressionThreshold(compressionThreshold);
+			bos.setFormat(format);
+			// A new file starts with the header of the format.
+			if (end == 0)
+				bos.writeHeader();
+			long start = end + bos.length();
+			bos.writeByte(data, size);
+			if (footer || checksummed) {
+				size_t first = entries.size();
+				BufferSource added = BufferSource(data, size);
+				Checksums::calculate(added, 0, size, entries, format);
+				for (size_t i = first; i < entries.size(); i++)
+					entries[i].offset += start;
+				Checksums::write(bos, entries);
+			}
+			if (!footer) {
+				bos.appendToFile();
+				return;
+			}
+			// The new tags are written over the old footer, followed by a footer that includes them.
+			// If they cannot be written the old footer is put back, so the file is left as it was.
+			std::filesystem::resize_file(file_name, end);
+			try {
+				bos.appendToFile();
+			}
+			catch (ODSException&) {
+				appendFile(file_name, oldFooter.data(), oldFooter.size(), syncPolicy);
+				throw;
+			}
+			return;
+		}
+		if (checksummed) {
+			// The footer must stay at the end of the tags, so the compressed file is rewritten.
+			std::vector<byte> bytes;
+			if (std::filesystem::exists(file_name)) {
+				BinaryInputStream bis = BinaryInputStream(file_name, compression);
+				bytes.assign(bis.getPointer(), bis.getPointer() + bis.length());
+				bis.close();
+			}
+			BufferSource source = BufferSource(bytes.data(), (long)bytes.size());
+			checkFormat(source);
+			if (bytes.empty() && format == Format::COMPACT)
+				bytes.assign(compactHeader, compactHeader + compactHeaderSize);
+			Checksums::strip(bytes);
+			bytes.insert(bytes.end(), data, data + size);
+			Checksums::append(bytes);
+			BinaryOutputStream bos = BinaryOutputStream(file_name, compression);
+			bos.setSyncPolicy(syncPolicy);
+			bos.setCompressionThreshold(compressionThreshold);
+			bos.writeByte(bytes.data(), (int)bytes.size());
+			bos.close();
+			return;
+		}
+		BinaryOutputStream bos = BinaryOutputStream(file_name, compression);
+		bos.setSyncPolicy(syncPolicy);
+		bos.setCompressionThreshold(compressionThreshold);
+		bos.setFormat(format);
+		if (!std::filesystem::exists(file_name))
+			bos.writeHeader();
+		bos.writeByte(data, size);
+		bos.appendToFile();
+	}
+
+	template <class Source>
+	inline void ObjectDataStructure::checkFormat(Source& source)
+	{
+		Format fileFormat;
+		TagLocator::readFormat(source, fileFormat);
+		if (source.length() > 0 && fileFormat != format)
+			throw ODSException("Error: The file is not in the format of the ObjectDataStructure!");
+	}
+
+	inline BinaryOutputStream ObjectDataStructure::tagStream()
+	{
+		BinaryOutputStream bos = BinaryOutputStream();
+		if (format == Format::NAMED) {
+			// New names are added to the end of the dictionary, so the indices of the names in the file do not change.
+			std::shared_ptr<const NameDictionary> fileNames;
+			Format fileFormat;
+			if (compression == CompressionType::NONE) {
+				std::ifstream in(file_name, std::ios::in | std::ios::binary);
+				if (in.is_open()) {
+					StreamSource source = StreamSource(in);
+					TagLocator::readFormat(source, fileFormat, &fileNames);
+				}
+			}
+			else if (std::filesystem::exists(file_name)) {
+				BinaryInputStream bis = BinaryInputStream(file_name, compression);
+				BufferSource source = BufferSource(bis.getPointer(), bis.length());
+				TagLocator::readFormat(source, fileFormat, &fileNames);
+				bis.close();
+			}
+			names = fileNames == NULL ? std::make_shared<NameDictionary>() : std::make_shared<NameDictionary>(*fileNames);
+			bos.setNameDictionary(names);
+		}
+		bos.setFormat(format);
+		bos.setColumnar(columnar);
+		bos.setSequenceEncoding(sequenceEncoding);
+		return bos;
+	}
+
+	// Make a change to a file in Format::NAMED. The file is changed in memory and written again, since names that
+	// are new to the file change the name dictionary at the start of it. (data is from tagStream().)
+	inline bool ObjectDataStructure::updateNamed(JournalOperation operation, const std::string& key, const byte* data, int size)
+	{
+		std::vector<byte> bytes;
+		if (std::filesystem::exists(file_name)) {
+			BinaryInputStream bis = BinaryInputStream(file_name, compression);
+			bytes.assign(bis.getPointer(), bis.getPointer() + bis.length());
+			bis.close();
+		}
+		BufferSource source = BufferSource(bytes.data(), (long)bytes.size());
+		checkFormat(source);
+		Format fileFormat;
+		long start = TagLocator::readFormat(source, fileFormat);
+		bool footer = Checksums::strip(bytes);
+		// Replace the header with one that has the names of data.
+		BinaryOutputStream header = BinaryOutputStream();
+		header.setNameDictionary(names);
+		header.setFormat(format);
+		header.writeHeader();
+		bytes.erase(bytes.begin(), bytes.begin() + start);
+		bytes.insert(bytes.begin(), header.getArray(), header.getArray() + header.length());
+		if (operation == JournalOperation::APPEND)
+			bytes.insert(bytes.end(), data, data + size);
+		else if (!spliceBuffer(bytes, key, data, size))
+			return false;
+		if (footer || checksummed)
+			Checksums::append(bytes);
+		BinaryOutputStream bos = BinaryOutputStream(file_name, compression);
+		bos.setSyncPolicy(syncPolicy);
+		bos.setCompressionThreshold(compressionThreshold);
+		bos.writeByte(bytes.data(), (int)bytes.size());
+		bos.close();
+		return true;
+	}
+
+	// Update the checksum of the top level tag at offset after it was changed in place. (Uncompressed files only.)
+	// A footer is added to files without one when checksummed mode is on.
+	inline void ObjectDataStructure::checksumFile(long offset)
+	{
+		std::ifstream stream(file_name, std::ios::in | std::ios::binary);
+		if (!stream.is_open())
+			throw ODSException("File stream not open! Does that file exist?");
+		StreamSource source = StreamSource(stream);
+		std::vector<ChecksumEntry> entries;
+		long end = Checksums::find(source, entries);
+		Format fileFormat;
+		TagLocator::readFormat(source, fileFormat);
+		BinaryOutputStream bos = BinaryOutputStream();
+		bos.setFormat(fileFormat);
+		if (end == source.length()) {
+			if (!checksummed)
+				return;
+			Checksums::calculate(source, end, entries);
+			Checksums::write(bos, entries);
+			stream.close();
+			writeInPlace(end, bos.getArray(), bos.length());
+			return;
+		}
+		for (size_t i = 0; i < entries.size(); i++) {
+			if (entries[i].offset != offset)
+				continue;
+			bos.writeInt((int)Checksums::crc(source, offset, offset + entries[i].length));
+			stream.close();
+			writeInPlace(Checksums::entryPosition(source.length(), entries.size(), i) + 12, bos.getArray(), 4);
+			return;
+		}
 	}
 
-	inline void VectorTag::removeTag(std::shared_ptr <ITag> tag)
+	inline void ObjectDataStructure::writeInPlace(long position, const byte* data, int size)
 	{
-		int i = 0;
-		for (std::shared_ptr <ITag> t : value) {
-			if (t == tag)
-				break;
-			i++;
-		}
-		value.erase(value.begin() + i);
+		FILE* file = fopen(file_name.c_str(), "r+b");
+		if (file == NULL)
+			throw ODSException("File stream not open! Does that file exist?");
+		bool failed = fseek(file, position, SEEK_SET) != 0 || fwrite(data, 1, size, file) != (size_t)size;
+		failed = failed || !syncFile(file, syncPolicy);
+		failed = fclose(file) != 0 || failed;
+		if (failed)
+			throw ODSException("Error: Failed to write the file!");
 	}
 
-	inline std::shared_ptr <ITag> VectorTag::getTag(int i)
+	template <class T>
+	inline void ObjectDataStructure::save(std::string name, const T& object)
 	{
-		return value[i];
+		BinaryOutputStream bos = BinaryOutputStream(file_name, compression);
+		bos.setSyncPolicy(syncPolicy);
+		bos.setCompressionThreshold(compressionThreshold);
+		bos.setFormat(format);
+		bos.setColumnar(columnar);
+		bos.setSequenceEncoding(sequenceEncoding);
+		writeObject(bos, name, object);
+		bos.writeHeader();
+		if (checksummed)
+			Checksums::append(bos);
+		bos.close();
+		// Saving replaces every change in the journal.
+		journal.remove();
+		clearJournalIndex();
 	}
 
-	inline void VectorTag::removeAllTags()
+	// Throw if TagLocator::locate() stopped at a CompressedObjectTag on the path to the key (see locateCompressed()).
+	// get() can read the tags inside of one, but they cannot be changed in place.
+	inline void checkCompressedPath(const std::vector<TagLocation>& path)
 	{
-		value.clear();
+		if (!path.empty() && path.back().id == 12)
+			throw ODSException("Error: Keys inside of a CompressedObjectTag cannot be modified in place!");
 	}
 
-	inline int VectorTag::indexOf(std::shared_ptr <ITag> tag)
+	inline bool ObjectDataStructure::set(std::string key, ITag* tag)
 	{
-		int i = 0;
-		for (std::shared_ptr <ITag> t : value) {
-			if (t == tag)
-				break;
-			i++;
-		}
-		return i;
+		// The whole tag is written, so a tag with another name of the same length would rename the tag at key.
+		if (tag->getName() != key.substr(key.rfind('.') + 1))
+			throw ODSException("Error: The name of the tag must match the last part of the key!");
+		BinaryOutputStream bos = tagStream();
+		tag->writeData(bos);
+		return setData(key, bos.getArray(), bos.length());
 	}
 
-	inline void VectorTag::writeData(BinaryOutputStream& bos)
+	// Overwrite the tag at key with data (a whole tag).
+	inline bool ObjectDataStructure::setData(std::string key, const byte* data, int size)
 	{
-		bos.writeByte(getID());
-		// Memory only stream
-		BinaryOutputStream tempBOS = BinaryOutputStream();
-		tempBOS.writeShort(name.length());
-		tempBOS.writeString(name);
-		
-		for (std::shared_ptr <ITag> tag : this->value) {
-			tag->setName("");
-			tag->writeData(tempBOS);
+		if (journaled) {
+			std::vector<TagLocation> path;
+			if (!locateJournaled(key, path))
+				return false;
+			if (size != path.back().end - path.back().start)
+				throw ODSException("Error: The new tag must be the same size as the old tag!");
+			return recordJournal(JournalOperation::SET, key, data, size);
 		}
-
-		bos.writeInt(tempBOS.length());
-		bos.writeByte(tempBOS.getArray(), tempBOS.length());
-		tempBOS.close();
+		if (format == Format::NAMED)
+			return updateNamed(JournalOperation::SET, key, data, size);
+		if (compression != CompressionType::NONE)
+			throw ODSException("Error: Tags can only be set in place in uncompressed files!");
+		std::ifstream stream(file_name, std::ios::in | std::ios::binary);
+		if (!stream.is_open())
+			throw ODSException("File stream not open! Does that file exist?");
+		StreamSource source = StreamSource(stream);
+		checkFormat(source);
+		std::vector<TagLocation> path;
+		if (!TagLocator::locate(source, key, path)) {
+			checkCompressedPath(path);
+			return false;
+		}
+		if (size != path.back().end - path.back().start)
+			throw ODSException("Error: The new tag must be the same size as the old tag!");
+		stream.close();
+		writeInPlace(path.back().start, data, size);
+		checksumFile(path.front().start);
+		return true;
+	}
+
+	inline std::shared_ptr<ITag> ObjectDataStructure::get(std::string key)
+	{
+		return getMany(std::vector<std::string>{ key })[0];
+	}
+
+	// Turn the bytes of a single tag into an ITag. If key is not empty, the tag is a CompressedObjectTag
+	// and the ITag is the tag at key inside of it (the key starts with the name of the CompressedObjectTag).
+	inline std::shared_ptr<ITag> readTagData(byte* data, long size, Format format, std::shared_ptr<const NameDictionary> names, const std::string& key = "")
+	{
+		BinaryInputStream bis = BinaryInputStream(data, size);
+		bis.setFormat(format);
+		bis.setNameDictionary(names);
+		Document doc = Document::read(bis);
+		if (key.empty())
+			return doc.toTag(doc.getNode(0));
+		const Node* node = doc.find(key);
+		return node == NULL ? NULL : doc.toTag(*node);
+	}
+
+	// Find a key that was not found by TagLocator::locateMany() inside of a CompressedObjectTag. If the key goes through
+	// one, location is set to it and the rest of the key (starting with its name) is returned. Otherwise returns "".
+	template <class Source>
+	inline std::string locateCompressed(Source& source, const std::string& key, TagLocation& location)
+	{
+		std::vector<TagLocation> path;
+		// locate() stops at the first tag on the path that is not an ObjectTag.
+		if (key.find('.') == std::string::npos || TagLocator::locate(source, key, path) || path.empty() || path.back().id != 12)
+			return "";
+		size_t start = 0;
+		for (size_t i = 1; i < path.size(); i++)
+			start = key.find('.', start) + 1;
+		location = path.back();
+		return key.substr(start);
+	}
+
+	// Read the tags at keys from bytes (a whole file). Keys that do not exist are NULL.
+	inline std::vector<std::shared_ptr<ITag>> readTags(byte* bytes, long size, const std::vector<std::string>& keys)
+	{
+		std::vector<std::shared_ptr<ITag>> tags(keys.size());
+		std::vector<TagLocation> locations;
+		BufferSource source = BufferSource(bytes, size);
+		TagLocator::locateMany(source, keys, locations);
+		Format format;
+		std::shared_ptr<const NameDictionary> names;
+		TagLocator::readFormat(source, format, &names);
+		for (size_t i = 0; i < keys.size(); i++) {
+			std::string rest;
+			if (locations[i].start != -1 || !(rest = locateCompressed(source, keys[i], locations[i])).empty())
+				tags[i] = readTagData(bytes + locations[i].start, locations[i].end - locations[i].start, format, names, rest);
+		}
+		return tags;
+	}
+
+	inline std::vector<std::shared_ptr<ITag>> ObjectDataStructure::getMany(std::vector<std::string> keys)
+	{
+		if (!journaled)
+			return readMany(keys);
+		// Keys in the top level tags that the journal changes are read from journalIndex, the rest from the file.
+		indexJournal();
+		std::vector<std::shared_ptr<ITag>> tags(keys.size());
+		std::vector<std::string> fileKeys;
+		std::vector<size_t> fileIndices;
+		for (size_t i = 0; i < keys.size(); i++) {
+			std::vector<byte>* journaledTags = journalOverlay(keys[i]);
+			if (journaledTags != NULL) {
+				tags[i] = readTags(journaledTags->data(), (long)journaledTags->size(), std::vector<std::string>{ keys[i] })[0];
+				continue;
+			}
+			fileKeys.push_back(keys[i]);
+			fileIndices.push_back(i);
+		}
+		if (!fileKeys.empty()) {
+			std::vector<std::shared_ptr<ITag>> fileTags = readMany(fileKeys);
+			for (size_t i = 0; i < fileKeys.size(); i++)
+				tags[fileIndices[i]] = fileTags[i];
+		}
+		return tags;
+	}
+
+	inline std::vector<std::shared_ptr<ITag>> ObjectDataStructure::readMany(const std::vector<std::string>& keys)
+	{
+		std::vector<std::shared_ptr<ITag>> tags(keys.size());
+		std::vector<TagLocation> locations;
+		if (compression == CompressionType::NONE) {
+			// Uncompressed files are not loaded, only the headers and the tags that were asked for are read.
+			std::ifstream in(file_name, std::ios::in | std::ios::binary);
+			if (!in.is_open())
+				throw ODSException("File stream not open! Does that file exist?");
+			StreamSource source = StreamSource(in);
+			TagLocator::locateMany(source, keys, locations);
+			Format format;
+			std::shared_ptr<const NameDictionary> names;
+			TagLocator::readFormat(source, format, &names);
+			std::vector<byte> data;
+			for (size_t i = 0; i < keys.size(); i++) {
+				std::string rest;
+				if (locations[i].start == -1 && (rest = locateCompressed(source, keys[i], locations[i])).empty())
+					continue;
+				data.resize(locations[i].end - locations[i].start);
+				source.read(locations[i].start, data.data(), (int)data.size());
+				tags[i] = readTagData(data.data(), (long)data.size(), format, names, rest);
+			}
+			return tags;
+		}
+		BinaryInputStream bis = BinaryInputStream(file_name, compression);
+		tags = readTags(const_cast<byte*>(bis.getPointer()), bis.length(), keys);
+		bis.close();
+		return tags;
 	}
 
-
-	inline Tag<std::vector<std::shared_ptr <ITag>>> VectorTag::createFromData(byte value[], int length)
+	inline bool ObjectDataStructure::remove(std::string key)
 	{
-		// TODO Implement this when I make ObjectDataStructure.getListData(value, length);
-		throw ODSException("NOT IMPLEMENTED");
+		if (journaled) {
+			std::vector<TagLocation> path;
+			if (!locateJournaled(key, path))
+				return false;
+			return recordJournal(JournalOperation::REMOVE, key, NULL, 0);
+		}
+		return splice(key, NULL, 0);
 	}
 
-
-	inline byte VectorTag::getID()
+	inline bool ObjectDataStructure::replace(std::string key, ITag* tag)
 	{
-		return 9;
+		BinaryOutputStream bos = tagStream();
+		tag->writeData(bos);
+		if (journaled) {
+			std::vector<TagLocation> path;
+			if (!locateJournaled(key, path))
+				return false;
+			return recordJournal(JournalOperation::REPLACE, key, bos.getArray(), bos.length());
+		}
+		return splice(key, bos.getArray(), bos.length());
 	}
 
-	/******************************
-
-		Long Tag
-
-	*******************************
-	*/
-	class LongTag : public Tag<long> {
-	private:
-		std::string name;
-		long value;
-
-	public:
-		LongTag(std::string name, long value);
-		~LongTag();
-
-		void setValue(long b);
-		long getValue();
-		void setName(std::string);
-		std::string getName();
-
-		void writeData(BinaryOutputStream& bos);
-		Tag<long> createFromData(byte value[], int length);
-		byte getID();
-	};
-
-	inline LongTag::LongTag(std::string name, long value)
+	inline void ObjectDataStructure::setJournaled(bool journaled, long long compactSize)
 	{
-		this->name = name;
-		this->value = value;
+		if (journaled && format == Format::NAMED)
+			throw ODSException("Error: Journaled mode cannot be used with a name dictionary!");
+		if (this->journaled && !journaled)
+			compact();
+		this->journaled = journaled;
+		this->journalLimit = compactSize;
 	}
 
-	inline LongTag::~LongTag()
+	inline bool ObjectDataStructure::isJournaled()
 	{
+		return journaled;
 	}
 
-	inline void LongTag::setValue(long b)
+	inline void ObjectDataStructure::setSyncPolicy(SyncPolicy policy)
 	{
-		this->value = b;
+		syncPolicy = policy;
 	}
 
-	inline long LongTag::getValue()
+	inline SyncPolicy ObjectDataStructure::getSyncPolicy()
 	{
-		return value;
+		return syncPolicy;
 	}
 
-	inline void LongTag::setName(std::string)
+	inline void ObjectDataStructure::setCompressionThreshold(double threshold)
 	{
-		this->name = name;
+		if (!(threshold >= 0 && threshold < 1))
+			throw ODSException("Error: The compression threshold must be at least 0 and less than 1!");
+		compressionThreshold = threshold;
 	}
 
-	inline std::string LongTag::getName()
+	inline double ObjectDataStructure::getCompressionThreshold()
 	{
-		return name;
+		return compressionThreshold;
 	}
 
-	inline void LongTag::writeData(BinaryOutputStream& bos)
+	inline void ObjectDataStructure::setFormat(Format format)
 	{
-		bos.writeByte(getID());
-		// Memory only stream
-		BinaryOutputStream tempBOS = BinaryOutputStream();
-		tempBOS.writeShort(name.length());
-		tempBOS.writeString(name);
-		tempBOS.writeLong(value);
-
-		bos.writeInt(tempBOS.length());
-		bos.writeByte(tempBOS.getArray(), tempBOS.length());
-		tempBOS.close();
+		if (journaled && format == Format::NAMED)
+			throw ODSException("Error: Journaled mode cannot be used with a name dictionary!");
+		this->format = format;
 	}
 
-
-	inline Tag<long> LongTag::createFromData(byte value[], int length)
+	inline Format ObjectDataStructure::getFormat()
 	{
-		this->value = reinterpret_cast<long>(value);
-		return *this;
+		return format;
 	}
 
-
-	inline byte LongTag::getID()
+	inline void ObjectDataStructure::setColumnar(bool columnar)
 	{
-		return 6;
+		this->columnar = columnar;
 	}
 
-	/******************************
-
-		Object Tag
-
-	*******************************
-	*/
-	class ObjectTag : public Tag<std::vector<ITag*>> {
-	private:
-		std::string name;
-		std::vector<ITag*> value;
-
-	public:
-		ObjectTag(std::string name, std::vector<ITag*> value);
-		ObjectTag(std::string name);
-		~ObjectTag();
-
-		void setValue(std::vector<ITag*> b);
-		std::vector<ITag*> getValue();
-		void setName(std::string);
-		std::string getName();
-
-		void addTag(ITag* tag);
-		void removeTag(ITag* tag);
-		ITag* getTag(std::string name);
-		void removeAllTags();
-
-		void writeData(BinaryOutputStream& bos);
-		Tag<std::vector<ITag*>> createFromData(byte value[], int length);
-		byte getID();
-	};
-
-	inline ObjectTag::ObjectTag(std::string name, std::vector<ITag*> value)
+	inline bool ObjectDataStructure::isColumnar()
 	{
-		this->name = name;
-		this->value = value;
-	}
-
-	inline ObjectTag::ObjectTag(std::string name) {
-		this->name = name;
-		this->value = std::vector<ITag*>();
+		return columnar;
 	}
 
-	inline ObjectTag::~ObjectTag()
+	inline void ObjectDataStructure::setSequenceEncoding(bool sequenceEncoding)
 	{
-		value.clear();
+		this->sequenceEncoding = sequenceEncoding;
 	}
 
-	inline void ObjectTag::setValue(std::vector<ITag*> b)
+	inline bool ObjectDataStructure::isSequenceEncoding()
 	{
-		this->value = b;
+		return sequenceEncoding;
 	}
 
-	inline std::vector<ITag*> ObjectTag::getValue()
+	inline void ObjectDataStructure::setChecksummed(bool checksummed)
 	{
-		return value;
+		this->checksummed = checksummed;
 	}
 
-	inline void ObjectTag::setName(std::string)
+	inline bool ObjectDataStructure::isChecksummed()
 	{
-		this->name = name;
+		return checksummed;
 	}
 
-	inline std::string ObjectTag::getName()
+	inline bool ObjectDataStructure::verify()
 	{
-		return name;
+		if (compression == CompressionType::NONE) {
+			std::ifstream in(file_name, std::ios::in | std::ios::binary);
+			if (!in.is_open())
+				throw ODSException("File stream not open! Does that file exist?");
+			StreamSource source = StreamSource(in);
+			return Checksums::verify(source);
+		}
+		BinaryInputStream bis = BinaryInputStream(file_name, compression);
+		BufferSource source = BufferSource(bis.getPointer(), bis.length());
+		bool valid = Checksums::verify(source);
+		bis.close();
+		return valid;
+	}
+
+	// Check the top level tag of key against the footer.
+	template <class Source>
+	inline bool verifyKey(Source& source, const std::string& key)
+	{
+		std::vector<ChecksumEntry> entries;
+		long end = Checksums::find(source, entries);
+		if (end == source.length())
+			throw ODSException("Error: The file does not have checksums!");
+		std::vector<TagLocation> path;
+		if (!TagLocator::locate(source, key, path) || path.front().end > end)
+			return false;
+		TagLocation& top = path.front();
+		for (ChecksumEntry& entry : entries) {
+			if (entry.offset == top.start && entry.length == top.end - top.start)
+				return Checksums::crc(source, top.start, top.end) == entry.crc;
+		}
+		return false;
 	}
 
-	inline void ObjectTag::addTag(ITag* tag)
+	inline bool ObjectDataStructure::verify(std::string key)
 	{
-		value.push_back(std::move(tag));
+		if (compression == CompressionType::NONE) {
+			std::ifstream in(file_name, std::ios::in | std::ios::binary);
+			if (!in.is_open())
+				throw ODSException("File stream not open! Does that file exist?");
+			StreamSource source = StreamSource(in);
+			return verifyKey(source, key);
+		}
+		BinaryInputStream bis = BinaryInputStream(file_name, compression);
+		BufferSource source = BufferSource(bis.getPointer(), bis.length());
+		bool valid = verifyKey(source, key);
+		bis.close();
+		return valid;
 	}
 
-	inline void ObjectTag::removeTag(ITag* tag)
+	inline void ObjectDataStructure::compact()
 	{
-		int i = 0;
-		for (ITag* t : value) {
-			if (t == tag)
+		if (!journal.exists())
+			return;
+		std::vector<JournalRecord> records;
+		// The journal belongs to an older version of the file (it was already compacted, or the file was saved over).
+		if (!journal.read(records)) {
+			journal.remove();
+			return;
+		}
+		bool footer;
+		std::vector<byte> bytes = journaledBytes(records, footer);
+		if (footer || checksummed)
+			Checksums::append(bytes);
+		// The new file is written atomically, so a crash during the compaction leaves the old file and the journal untouched.
+		// (The journal is already on the disk, so the new file must be as well before the journal is deleted.)
+		std::vector<byte> out = compressBytes(compression, bytes.data(), bytes.size(), compressionThreshold);
+		AtomicFile file = AtomicFile(file_name);
+		file.write(out.data(), out.size());
+		file.commit(SyncPolicy::FULL);
+		journal.remove();
+		clearJournalIndex();
+	}
+
+	inline std::vector<byte> ObjectDataStructure::journaledBytes(const std::vector<JournalRecord>& records, bool& footer)
+	{
+		std::vector<byte> bytes;
+		if (std::filesystem::exists(file_name)) {
+			BinaryInputStream bis = BinaryInputStream(file_name, compression);
+			bytes.assign(bis.getPointer(), bis.getPointer() + bis.length());
+			bis.close();
+		}
+		BufferSource source = BufferSource(bytes.data(), (long)bytes.size());
+		checkFormat(source);
+		if (bytes.empty() && format == Format::COMPACT)
+			bytes.assign(compactHeader, compactHeader + compactHeaderSize);
+		// The footer is removed while the records are applied so that appended tags go before it.
+		footer = Checksums::strip(bytes);
+		for (const JournalRecord& record : records) {
+			switch (record.operation) {
+			case JournalOperation::SET:
+			case JournalOperation::REPLACE:
+				spliceBuffer(bytes, record.key, record.data.data(), (int)record.data.size());
 				break;
-			i++;
+			case JournalOperation::REMOVE:
+				spliceBuffer(bytes, record.key, NULL, 0);
+				break;
+			case JournalOperation::APPEND:
+				bytes.insert(bytes.end(), record.data.begin(), record.data.end());
+				break;
+			}
 		}
-		value.erase(value.begin() + i);
+		return bytes;
 	}
 
-	inline ITag* ObjectTag::getTag(std::string name)
+	inline void ObjectDataStructure::indexJournal()
 	{
-		return NULL;
+		std::array<long long, 3> state = journal.state();
+		if (state == journalState)
+			return;
+		clearJournalIndex();
+		std::vector<JournalRecord> records;
+		if (state[0] >= 0 && !journal.read(records)) {
+			// (compact() would drop it as well. New records must not be added to it.)
+			journal.remove();
+			state = journal.state();
+		}
+		for (const JournalRecord& record : records)
+			indexRecord(record.operation, record.key, record.data.data(), (int)record.data.size());
+		journalState = state;
 	}
 
-	inline void ObjectTag::removeAllTags()
+	inline void ObjectDataStructure::clearJournalIndex()
 	{
-		value.clear();
+		journalIndex.clear();
+		fileTags.clear();
+		fileTagsRead = false;
 	}
 
-	inline void ObjectTag::writeData(BinaryOutputStream& bos)
+	// Apply a record to journalIndex the same way journaledBytes() applies it to the file.
+	inline void ObjectDataStructure::indexRecord(JournalOperation operation, const std::string& key, const byte* data, int size)
 	{
-		bos.writeByte(getID());
-		// Memory only stream
-		BinaryOutputStream tempBOS = BinaryOutputStream();
-		tempBOS.writeShort(name.length());
-		tempBOS.writeString(name);
-
-		for (ITag* tag : this->value) {
-			tag->setName("");
-			tag->writeData(tempBOS);
+		if (operation != JournalOperation::APPEND) {
+			spliceBuffer(journalTags(key.substr(0, key.find('.'))), key, data, size);
+			return;
+		}
+		// Every appended tag goes after the other tags of its name.
+		BufferSource source = BufferSource(data, size);
+		long position = 0;
+		std::string name;
+		while (position < size) {
+			TagLocation location;
+			short nameLength;
+			if (!TagLocator::readHeader(source, position, size, location, nameLength, format))
+				throw ODSException("Error: The tag header is corrupt or past the end of the data!");
+			TagLocator::readName(source, location, nameLength, NULL, name);
+			std::vector<byte>& tags = journalTags(name);
+			tags.insert(tags.end(), data + location.start, data + location.end);
+			position = location.end;
 		}
-
-		bos.writeInt(tempBOS.length());
-		bos.writeByte(tempBOS.getArray(), tempBOS.length());
-		tempBOS.close();
 	}
 
-
-	inline Tag<std::vector<ITag*>> ObjectTag::createFromData(byte value[], int length)
+	inline std::vector<byte>& ObjectDataStructure::journalTags(const std::string& name)
 	{
-		// TODO Implement this when I make ObjectDataStructure.getListData(value, length);
-		throw ODSException("NOT IMPLEMENTED");
+		auto it = journalIndex.find(name);
+		if (it != journalIndex.end())
+			return it->second;
+		std::vector<byte> tags;
+		if (format == Format::COMPACT)
+			tags.assign(compactHeader, compactHeader + compactHeaderSize);
+		if (std::filesystem::exists(file_name)) {
+			if (compression == CompressionType::NONE) {
+				std::ifstream in(file_name, std::ios::in | std::ios::binary);
+				StreamSource source = StreamSource(in);
+				readFileTags(source, name, tags);
+			}
+			else {
+				BinaryInputStream bis = BinaryInputStream(file_name, compression);
+				BufferSource source = BufferSource(bis.getPointer(), bis.length());
+				readFileTags(source, name, tags);
+				bis.close();
+			}
+		}
+		return journalIndex.emplace(name, std::move(tags)).first->second;
+	}
+
+	template <class Source>
+	inline void ObjectDataStructure::readFileTags(Source& source, const std::string& name, std::vector<byte>& out)
+	{
+		if (!fileTagsRead) {
+			checkFormat(source);
+			Format fileFormat;
+			long position = TagLocator::readFormat(source, fileFormat);
+			long end = source.length();
+			std::string tagName;
+			while (position < end) {
+				TagLocation location;
+				short nameLength;
+				if (!TagLocator::readHeader(source, position, end, location, nameLength, fileFormat))
+					throw ODSException("Error: The tag header is corrupt or past the end of the data!");
+				// (The checksum footer is not a tag of the file, it is written again by compact().)
+				if (location.id != Checksums::id) {
+					TagLocator::readName(source, location, nameLength, NULL, tagName);
+					fileTags[tagName].emplace_back(location.start, location.end);
+				}
+				position = location.end;
+			}
+			fileTagsRead = true;
+		}
+		auto it = fileTags.find(name);
+		if (it == fileTags.end())
+			return;
+		for (const std::pair<long, long>& range : it->second) {
+			size_t start = out.size();
+			out.resize(start + (size_t)(range.second - range.first));
+			if (!source.read(range.first, out.data() + start, (int)(range.second - range.first)))
+				throw ODSException("Error: Failed to read the file!");
+		}
 	}
 
+	inline std::vector<byte>* ObjectDataStructure::journalOverlay(const std::string& key)
+	{
+		auto it = journalIndex.find(key.substr(0, key.find('.')));
+		return it == journalIndex.end() ? NULL : &it->second;
+	}
 
-	inline byte ObjectTag::getID()
+	inline bool ObjectDataStructure::locateJournaled(const std::string& key, std::vector<TagLocation>& path)
 	{
-		return 11;
+		// The tag is about to be changed, so its top level tag is read into journalIndex right away.
+		indexJournal();
+		std::vector<byte>& tags = journalTags(key.substr(0, key.find('.')));
+		BufferSource source = BufferSource(tags.data(), (long)tags.size());
+		bool found = TagLocator::locate(source, key, path);
+		if (!found)
+			checkCompressedPath(path);
+		return found;
 	}
 
+	// Add a change to the journal and to journalIndex, and compact the journal once it is too large.
+	inline bool ObjectDataStructure::recordJournal(JournalOperation operation, const std::string& key, const byte* data, int size)
+	{
+		indexJournal();
+		journal.record(operation, key, data, size);
+		// (If the record cannot be applied to the index, the index is built again from the journal the next time.)
+		journalState[0] = -2;
+		indexRecord(operation, key, data, size);
+		journalState = journal.state();
+		if (journalState[0] > journalLimit)
+			compact();
+		return true;
+	}
 
-	/*
-	===========================================
-	
-	Object Data Structure Class
+	// Writes to an AtomicFile while calculating the CRC32C of the bytes written between start and end.
+	class ChecksumOutput {
+	public:
+		ChecksumOutput(AtomicFile& file, long start, long end);
 
-	===========================================
-	*/
+		void write(const byte* data, size_t size);
+		unsigned int crc();
 
-	class ObjectDataStructure {
 	private:
-		std::string file_name;
-		CompressionType compression;
-
-	public:
-		ObjectDataStructure(std::string file_name);
-		ObjectDataStructure(std::string file_name, CompressionType compression);
-		~ObjectDataStructure();
-		
-		void save(std::vector< std::shared_ptr<ITag>> tags);
-		void save(std::vector<ITag*> tags);
+		AtomicFile* file;
+		long start;
+		long end;
+		long position;
+		unsigned int result;
 	};
 
-	inline ObjectDataStructure::ObjectDataStructure(std::string file_name)
+	inline ChecksumOutput::ChecksumOutput(AtomicFile& file, long start, long end)
 	{
-		this->file_name = file_name;
-		this->compression = CompressionType::NONE;
+		this->file = &file;
+		this->start = start;
+		this->end = end;
+		position = 0;
+		result = 0;
 	}
 
-	inline ObjectDataStructure::ObjectDataStructure(std::string file_name, CompressionType compression)
+	inline void ChecksumOutput::write(const byte* data, size_t size)
 	{
-		this->file_name = file_name;
-		this->compression = compression;
+		long from = std::max(position, start);
+		long to = std::min(position + (long)size, end);
+		if (from < to)
+			result = crc32c(result, data + (from - position), to - from);
+		file->write(data, size);
+		position += (long)size;
 	}
 
-	inline ObjectDataStructure::~ObjectDataStructure()
+	inline unsigned int ChecksumOutput::crc()
 	{
+		return result;
 	}
 
-	inline void ObjectDataStructure::save(std::vector<std::shared_ptr<ITag>> tags)
+	// Copy the bytes between start and end from a stream into an AtomicFile (or ChecksumOutput).
+	// Throws an ODSException if the stream ends early (the file shrank) or fails, so a short copy is never committed.
+	template <class Output>
+	inline void copyStreamRange(std::istream& in, Output& out, long start, long end)
 	{
-		BinaryOutputStream bos = BinaryOutputStream(file_name, compression);
-		for (std::shared_ptr <ITag> &tag : tags) {
-			tag->writeData(bos);
+		byte buffer[65536];
+		in.seekg(start);
+		while (start < end) {
+			int size = (int)std::min<long>(end - start, sizeof(buffer));
+			in.read(buffer, size);
+			if (in.gcount() != size)
+				throw ODSException("Error: Failed to read the file!");
+			out.write(buffer, size);
+			start += size;
 		}
-		bos.close();
 	}
 
-	inline void ObjectDataStructure::save(std::vector<ITag*> tags)
+	// The new lengths of the tags on path (the tags that contain a tag that changes size by delta).
+	// In the compact format a length can change size as well, which changes the length of the tags around it.
+	// Returns how much the top level tag changes size by.
+	inline int spliceLengths(const std::vector<TagLocation>& path, int delta, Format format, std::vector<int>& lengths)
 	{
-		BinaryOutputStream bos = BinaryOutputStream(file_name, compression);
-		for (ITag* tag : tags) {
-			tag->writeData(bos);
+		lengths.resize(path.size());
+		for (size_t i = path.size(); i-- > 0;) {
+			int length = (int)(path[i].end - path[i].lengthEnd);
+			lengths[i] = length + delta;
+			if (format != Format::STANDARD)
+				delta += varintSize((unsigned int)lengths[i]) - varintSize((unsigned int)length);
+		}
+		return delta;
+	}
+
+	// Replace the bytes of the tag at key with data (size 0 removes the tag).
+	// Everything outside of the tag is copied as is, except for the lengths of the tags that contain it.
+	inline bool ObjectDataStructure::splice(std::string key, const byte* data, int size)
+	{
+		if (format == Format::NAMED && size > 0)
+			return updateNamed(JournalOperation::REPLACE, key, data, size);
+		std::vector<TagLocation> path;
+		if (compression == CompressionType::NONE) {
+			// Uncompressed files are streamed into a new file, so the file is never loaded into memory.
+			std::ifstream in(file_name, std::ios::in | std::ios::binary);
+			if (!in.is_open())
+				throw ODSException("File stream not open! Does that file exist?");
+			StreamSource source = StreamSource(in);
+			if (size > 0)
+				checkFormat(source);
+			if (!TagLocator::locate(source, key, path)) {
+				checkCompressedPath(path);
+				return false;
+			}
+			TagLocation target = path.back();
+			path.pop_back();
+			Format fileFormat;
+			TagLocator::readFormat(source, fileFormat);
+			std::vector<int> lengths;
+			int delta = spliceLengths(path, size - (int)(target.end - target.start), fileFormat, lengths);
+
+			// The checksum footer is written again with the entries after the tag moved by delta.
+			// Only the top level tag that holds the tag changes, its new checksum is calculated while it is written.
+			std::vector<ChecksumEntry> entries;
+			long end = Checksums::find(source, entries);
+			bool footer = end != source.length() || checksummed;
+			if (end == source.length() && checksummed)
+				Checksums::calculate(source, end, entries);
+			TagLocation top = path.empty() ? target : path.front();
+			if (path.empty() && size == 0) {
+				entries.erase(std::remove_if(entries.begin(), entries.end(), [&](const ChecksumEntry& entry) {
+					return entry.offset == top.start;
+				}), entries.end());
+			}
+			long changed = -1;
+			for (size_t i = 0; i < entries.size(); i++) {
+				if (entries[i].offset == top.start) {
+					entries[i].length += delta;
+					changed = (long)i;
+				}
+				else if (entries[i].offset > top.start) {
+					entries[i].offset += delta;
+				}
+			}
+
+			AtomicFile file = AtomicFile(file_name);
+			ChecksumOutput out = ChecksumOutput(file, top.start, top.end + delta);
+			long position = 0;
+			for (size_t i = 0; i < path.size(); i++) {
+				copyStreamRange(in, out, position, path[i].start + 1);
+				BinaryOutputStream length = BinaryOutputStream();
+				length.setFormat(fileFormat);
+				length.writeLength(lengths[i]);
+				out.write(length.getArray(), length.length());
+				position = path[i].lengthEnd;
+			}
+			copyStreamRange(in, out, position, target.start);
+			out.write(data, size);
+			copyStreamRange(in, out, target.end, end);
+			in.close();
+			if (footer) {
+				if (changed != -1)
+					entries[changed].crc = out.crc();
+				BinaryOutputStream bos = BinaryOutputStream();
+				bos.setFormat(fileFormat);
+				Checksums::write(bos, entries);
+				out.write(bos.getArray(), bos.length());
+			}
+			file.commit(syncPolicy);
+			return true;
+		}
+
+		// Compressed files are spliced in memory and compressed again.
+		BinaryInputStream bis = BinaryInputStream(file_name, compression);
+		std::vector<byte> bytes(bis.getPointer(), bis.getPointer() + bis.length());
+		bis.close();
+		if (size > 0) {
+			BufferSource source = BufferSource(bytes.data(), (long)bytes.size());
+			checkFormat(source);
 		}
+		bool footer = Checksums::strip(bytes);
+		if (!spliceBuffer(bytes, key, data, size))
+			return false;
+		if (footer || checksummed)
+			Checksums::append(bytes);
+		BinaryOutputStream bos = BinaryOutputStream(file_name, compression);
+		bos.setSyncPolicy(syncPolicy);
+		bos.setCompressionThreshold(compressionThreshold);
+		bos.writeByte(bytes.data(), (int)bytes.size());
 		bos.close();
+		return true;
+	}
+
+	// The in memory version of splice().
+	inline bool ObjectDataStructure::spliceBuffer(std::vector<byte>& bytes, std::string key, const byte* data, int size)
+	{
+		std::vector<TagLocation> path;
+		BufferSource source = BufferSource(bytes.data(), (long)bytes.size());
+		if (!TagLocator::locate(source, key, path)) {
+			checkCompressedPath(path);
+			return false;
+		}
+		TagLocation target = path.back();
+		// A tag of the same size is written over the old one, and none of the lengths change.
+		if (size == target.end - target.start && size > 0) {
+			std::copy(data, data + size, bytes.begin() + target.start);
+			return true;
+		}
+		path.pop_back();
+		Format format;
+		TagLocator::readFormat(source, format);
+		std::vector<int> lengths;
+		int delta = spliceLengths(path, size - (int)(target.end - target.start), format, lengths);
+		std::vector<byte> result;
+		result.reserve(bytes.size() + delta);
+		long position = 0;
+		for (size_t i = 0; i < path.size(); i++) {
+			result.insert(result.end(), bytes.begin() + position, bytes.begin() + path[i].start + 1);
+			BinaryOutputStream length = BinaryOutputStream();
+			length.setFormat(format);
+			length.writeLength(lengths[i]);
+			result.insert(result.end(), length.getArray(), length.getArray() + length.length());
+			position = path[i].lengthEnd;
+		}
+		result.insert(result.end(), bytes.begin() + position, bytes.begin() + target.start);
+		result.insert(result.end(), data, data + size);
+		result.insert(result.end(), bytes.begin() + target.end, bytes.end());
+		bytes.swap(result);
+		return true;
+	}
+
+	template <class T, class>
+	inline bool ObjectDataStructure::set(std::string key, T value)
+	{
+		if (journaled) {
+			std::vector<TagLocation> path;
+			if (!locateJournaled(key, path))
+				return false;
+			TagLocation& location = path.back();
+			if (location.id != FieldType<T>::id || (format == Format::STANDARD && location.end - location.valueStart != FieldType<T>::size()))
+				throw ODSException("Error: The tag at that key does not have the same type as the value!");
+			// Record the whole tag, named after the last part of the key. (In the compact format it can change size.)
+			BinaryOutputStream bos = BinaryOutputStream();
+			bos.setFormat(format);
+			writeValue(bos, key.substr(key.rfind('.') + 1), value);
+			return recordJournal(JournalOperation::SET, key, bos.getArray(), bos.length());
+		}
+		if (compression != CompressionType::NONE)
+			throw ODSException("Error: Tags can only be set in place in uncompressed files!");
+		std::ifstream stream(file_name, std::ios::in | std::ios::binary);
+		if (!stream.is_open())
+			throw ODSException("File stream not open! Does that file exist?");
+		StreamSource source = StreamSource(stream);
+		checkFormat(source);
+		std::vector<TagLocation> path;
+		if (!TagLocator::locate(source, key, path)) {
+			checkCompressedPath(path);
+			return false;
+		}
+		TagLocation& location = path.back();
+		if (location.id != FieldType<T>::id || (format == Format::STANDARD && location.end - location.valueStart != FieldType<T>::size()))
+			throw ODSException("Error: The tag at that key does not have the same type as the value!");
+		BinaryOutputStream bos = BinaryOutputStream();
+		bos.setFormat(format);
+		FieldType<T>::write(bos, value);
+		if (bos.length() != location.end - location.valueStart) {
+			// In the compact format a value can change size, in which case the whole tag is replaced.
+			stream.close();
+			BinaryOutputStream tag = tagStream();
+			writeValue(tag, key.substr(key.rfind('.') + 1), value);
+			return splice(key, tag.getArray(), tag.length());
+		}
+		stream.close();
+		writeInPlace(location.valueStart, bos.getArray(), bos.length());
+		checksumFile(path.front().start);
+		return true;
 	}
 
+	template <class T>
+	inline bool ObjectDataStructure::load(std::string name, T& object)
+	{
+		std::vector<byte>* journaledTags = NULL;
+		if (journaled) {
+			indexJournal();
+			journaledTags = journalOverlay(name);
+		}
+		BinaryInputStream bis = journaledTags != NULL ? BinaryInputStream(journaledTags->data(), (long)journaledTags->size())
+			: BinaryInputStream(file_name, compression);
+		bis.readFormat();
+		bool found = false;
+		while (!found && bis.getIndex() < bis.length()) {
+			byte id;
+			short nameLength;
+			long end = bis.readTagHeader(bis.length(), id, nameLength);
+			if (id == 11 && bis.readTagNameView(nameLength) == name) {
+				readFields(bis, end, object);
+				found = true;
+			}
+			bis.setIndex(end);
+		}
+		bis.close();
+		return found;
+	}
 
 }
 